@@ -0,0 +1,68 @@
+#!/usr/bin/env python
+# Writes mem.perf.data, the perf.data fixture of perfreadercheck: one
+# event of perf mem record sample type and seven samples, one per kind of
+# data source the reader maps, with a few other records between them.
+
+import struct
+
+PERF_SAMPLE_TYPE = (0x1 | 0x2 | 0x4 | 0x8 |  # IP, TID, TIME, ADDR
+                    0x80 | 0x100 |            # CPU, PERIOD
+                    0x4000 | 0x8000)          # WEIGHT, DATA_SRC
+
+def data_src(lvl, snoop=0, lock=0, dtlb=0, lvl_num=0):
+    op_load = 0x2
+    return (op_load | (lvl << 5) | (snoop << 19) | (lock << 24) |
+            (dtlb << 26) | (lvl_num << 33))
+
+HIT, MISS, NA = 0x2, 0x4, 0x1
+L1, L2, L3, LOC_RAM, REM_RAM1 = 0x8, 0x20, 0x40, 0x80, 0x100
+SNOOP_HITM, LOCKED, TLB_MISS = 0x10, 0x2, 0x4
+
+# Times above 2^53 and a kernel ip, which a double would round
+T0 = (1 << 53) + 1
+KERNEL_IP = 0xffffffff81001060
+
+# (ip, pid, tid, time, addr, cpu, weight, data source)
+samples = [
+    (0x401000, 100, 101, T0+1000, 0x7f0000001000, 0, 10, data_src(L1 | HIT)),
+    (0x401010, 100, 101, T0+2000, 0x7f0000002000, 1, 40, data_src(L3 | HIT)),
+    (0x401020, 100, 102, T0+3000, 0x7f0000003000, 2, 300, data_src(L3 | MISS)),
+    (0x401030, 100, 102, T0+4000, 0x7f0000004000, 3, 200,
+     data_src(LOC_RAM | HIT, snoop=SNOOP_HITM)),
+    (0x401040, 200, 201, T0+5000, 0x7f0000005000, 0, 20,
+     data_src(L2 | HIT, lock=LOCKED, dtlb=TLB_MISS)),
+    (0x401050, 200, 201, T0+6000, 0x7f0000006000, 1, 15, data_src(NA, lvl_num=2)),
+    (KERNEL_IP, 200, 202, T0+7000, 0x7f0000007000, 2, 400,
+     data_src(REM_RAM1 | HIT)),
+]
+
+def record(type, body):
+    return struct.pack('<IHH', type, 0, 8 + len(body)) + body
+
+def sample(ip, pid, tid, time, addr, cpu, weight, src):
+    return record(9, struct.pack('<QIIQQIIQQQ', ip, pid, tid, time, addr,
+                                 cpu, 0, 1, weight, src))
+
+data = b''
+for i, s in enumerate(samples):
+    data += sample(*s)
+    if i == 1:
+        data += record(3, struct.pack('<II', 100, 101) + b'memaxes\0')  # COMM
+    if i == 3:
+        data += record(12, b'')  # FINISHED_ROUND
+
+# perf_event_attr (128 bytes) followed by an empty IDs section
+attr = struct.pack('<IIQQQQ', 4, 128, 0x1cd, 1, PERF_SAMPLE_TYPE, 0)
+attr += b'\0' * (128 - len(attr)) + struct.pack('<QQ', 0, 0)
+
+header_size = 104
+attrs_offset = header_size
+data_offset = attrs_offset + len(attr)
+
+header = b'PERFILE2' + struct.pack('<QQQQQQQQ', header_size, len(attr),
+                                   attrs_offset, len(attr),
+                                   data_offset, len(data), 0, 0)
+header += b'\0' * (header_size - len(header))
+
+with open('mem.perf.data', 'wb') as f:
+    f.write(header + attr + data)
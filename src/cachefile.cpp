@@ -0,0 +1,395 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "cachefile.h"
+
+#include <iostream>
+
+#include <string.h>
+
+static const char zeros[CACHE_ALIGN] = {0};
+
+CacheWriter::CacheWriter(QString fileName)
+    : cacheFileName(fileName), offset(0), err(0), mapped(NULL)
+{
+    file.setFileName(fileName + ".tmp");
+}
+
+int CacheWriter::open()
+{
+    if(!file.open(QIODevice::ReadWrite | QIODevice::Truncate))
+        return -1;
+
+    // Header is filled in by finish()
+    CacheHeader header;
+    memset(&header,0,sizeof(header));
+    put(&header,sizeof(header));
+    align();
+
+    return err;
+}
+
+void CacheWriter::put(const void *data, qint64 bytes)
+{
+    if(err || bytes == 0)
+        return;
+
+    if(file.write((const char*)data,bytes) != bytes)
+        err = -1;
+    offset += bytes;
+}
+
+void CacheWriter::align()
+{
+    qint64 pad = (CACHE_ALIGN - offset % CACHE_ALIGN) % CACHE_ALIGN;
+    put(zeros,pad);
+}
+
+static CacheColumnHeader columnHeader(column_type t, ElemIndex n, const ColumnRange &r)
+{
+    CacheColumnHeader ch;
+    ch.type = t;
+    ch.flags = (r.integral ? CACHE_COLUMN_INTEGRAL : 0) |
+               (r.exactFloat ? CACHE_COLUMN_EXACT_FLOAT : 0);
+    ch.numValues = n;
+    ch.vmin = r.vmin;
+    ch.vmax = r.vmax;
+    return ch;
+}
+
+void CacheWriter::putColumn(const DataColumn &col)
+{
+    CacheColumnHeader ch = columnHeader(col.type(),col.size(),col.range());
+
+    put(&ch,sizeof(ch));
+    align();
+    put(col.rawData(),col.bytes());
+    align();
+}
+
+qint64 CacheWriter::reserve(qint64 bytes)
+{
+    align();
+    qint64 at = offset;
+
+    // Skipped over, the file is extended when it is mapped
+    offset += bytes;
+    if(!err && !file.seek(offset))
+        err = -1;
+    align();
+
+    return at;
+}
+
+qint64 CacheWriter::reserveColumn(column_type t, const ColumnRange &r)
+{
+    CacheColumnHeader ch = columnHeader(t,r.count,r);
+
+    put(&ch,sizeof(ch));
+    return reserve(r.count*DataColumn::typeSize(t));
+}
+
+char *CacheWriter::map()
+{
+    if(err || mapped)
+        return (char*)mapped;
+
+    if(!file.resize(offset))
+    {
+        err = -1;
+        return NULL;
+    }
+
+    mapped = file.map(0,offset);
+    if(mapped == NULL)
+        err = -1;
+
+    return (char*)mapped;
+}
+
+void CacheWriter::putDict(const StringDict &dict)
+{
+    quint32 count = dict.size();
+    QVector<quint32> offsets(count+1);
+    offsets[0] = 0;
+    for(int i=0; i<dict.size(); i++)
+        offsets[i+1] = offsets[i] + dict.length(i);
+
+    put(&count,sizeof(count));
+    put(offsets.constData(),offsets.size()*sizeof(quint32));
+    for(int i=0; i<dict.size(); i++)
+        put(dict.data(i),dict.length(i));
+    align();
+}
+
+void CacheWriter::putStringList(const QStringList &list)
+{
+    StringDict dict;
+    for(int i=0; i<list.size(); i++)
+        dict.intern(list[i]);
+
+    // Duplicate names would collapse in the dictionary
+    if(dict.size() != list.size())
+    {
+        err = -1;
+        return;
+    }
+
+    putDict(dict);
+}
+
+void CacheWriter::putReals(const QVector<qreal> &vals)
+{
+    put(vals.constData(),vals.size()*sizeof(qreal));
+    align();
+}
+
+int CacheWriter::finish(CacheHeader header)
+{
+    memcpy(header.magic,CACHE_MAGIC,sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.fileSize = offset;
+
+    if(mapped)
+    {
+        file.unmap(mapped);
+        mapped = NULL;
+    }
+
+    if(!err && !file.resize(offset))
+        err = -1;
+
+    if(!err && (!file.seek(0) || file.write((const char*)&header,sizeof(header)) != sizeof(header)))
+        err = -1;
+
+    file.close();
+
+    if(err)
+    {
+        file.remove();
+        return err;
+    }
+
+    QFile::remove(cacheFileName);
+    if(!file.rename(cacheFileName))
+    {
+        file.remove();
+        return -1;
+    }
+
+    return 0;
+}
+
+void CacheWriter::abort()
+{
+    if(mapped)
+    {
+        file.unmap(mapped);
+        mapped = NULL;
+    }
+
+    file.close();
+    file.remove();
+}
+
+CacheReader::CacheReader()
+    : data(NULL), size(0), offset(0)
+{
+}
+
+CacheReader::~CacheReader()
+{
+    close();
+}
+
+void CacheReader::close()
+{
+    if(data)
+        file.unmap((uchar*)data);
+    if(file.isOpen())
+        file.close();
+
+    data = NULL;
+    size = 0;
+    offset = 0;
+}
+
+int CacheReader::open(QString fileName, qint64 sourceSize, qint64 sourceMtime)
+{
+    close();
+
+    file.setFileName(fileName);
+    if(!file.open(QIODevice::ReadOnly))
+        return -1;
+
+    size = file.size();
+    if(size < (qint64)sizeof(CacheHeader))
+    {
+        close();
+        return -1;
+    }
+
+    data = (const char*)file.map(0,size);
+    if(data == NULL)
+    {
+        close();
+        return -1;
+    }
+
+    // Stale or from another version, the caller reparses. Every section
+    // ends aligned, so a valid file is too.
+    const CacheHeader &h = header();
+    if(memcmp(h.magic,CACHE_MAGIC,sizeof(h.magic)) != 0 ||
+       h.version != CACHE_VERSION ||
+       h.fileSize != (quint64)size ||
+       size % CACHE_ALIGN != 0 ||
+       h.sourceSize != sourceSize ||
+       h.sourceMtime != sourceMtime)
+    {
+        close();
+        return -1;
+    }
+
+    offset = sizeof(CacheHeader);
+    align();
+
+    return 0;
+}
+
+void CacheReader::align()
+{
+    offset += (CACHE_ALIGN - offset % CACHE_ALIGN) % CACHE_ALIGN;
+}
+
+// NULL if fewer than bytes are left, sizes read from the file are
+// checked here before anything points into the mapping
+const char *CacheReader::take(quint64 bytes)
+{
+    if(data == NULL || offset > size || bytes > (quint64)(size - offset))
+        return NULL;
+
+    const char *p = data + offset;
+    offset += bytes;
+    return p;
+}
+
+int CacheReader::getColumn(DataColumn &col, quint64 numValues)
+{
+    const CacheColumnHeader *ch = (const CacheColumnHeader*)take(sizeof(CacheColumnHeader));
+    if(ch == NULL || ch->type > COL_DOUBLE || ch->numValues != numValues)
+        return -1;
+    align();
+
+    column_type t = (column_type)ch->type;
+    quint64 typeSize = DataColumn::typeSize(t);
+    if(ch->numValues > (quint64)size / typeSize)
+        return -1;
+
+    const char *vals = take(ch->numValues*typeSize);
+    if(vals == NULL)
+        return -1;
+    align();
+
+    ColumnRange r;
+    r.count = ch->numValues;
+    r.vmin = ch->vmin;
+    r.vmax = ch->vmax;
+    r.integral = ch->flags & CACHE_COLUMN_INTEGRAL;
+    r.exactFloat = ch->flags & CACHE_COLUMN_EXACT_FLOAT;
+
+    col.attach(t,vals,r);
+    return 0;
+}
+
+int CacheReader::getDict(StringDict &dict)
+{
+    const quint32 *count = (const quint32*)take(sizeof(quint32));
+    if(count == NULL)
+        return -1;
+
+    quint64 n = *count;
+    const quint32 *offsets = (const quint32*)take((n+1)*sizeof(quint32));
+    if(offsets == NULL || offsets[0] != 0)
+        return -1;
+
+    // Offsets only grow, and take() bounds the last one
+    for(quint64 i=0; i<n; i++)
+    {
+        if(offsets[i+1] < offsets[i])
+            return -1;
+    }
+
+    const char *chars = take(offsets[n]);
+    if(chars == NULL)
+        return -1;
+    align();
+
+    // IDs come back in the same order they were written
+    dict.clear();
+    for(quint64 i=0; i<n; i++)
+        dict.intern(chars + offsets[i],offsets[i+1] - offsets[i]);
+
+    // Repeated strings would shift the IDs after them
+    return ((quint64)dict.size() == n) ? 0 : -1;
+}
+
+int CacheReader::getStringList(QStringList &list)
+{
+    StringDict dict;
+    int err = getDict(dict);
+    if(err)
+        return err;
+
+    list.clear();
+    for(int i=0; i<dict.size(); i++)
+        list.push_back(dict.name(i));
+
+    return 0;
+}
+
+int CacheReader::getReals(QVector<qreal> &vals, int n)
+{
+    const qreal *p = (n < 0) ? NULL : (const qreal*)take((quint64)n*sizeof(qreal));
+    if(p == NULL)
+        return -1;
+    align();
+
+    vals.resize(n);
+    memcpy(vals.data(),p,n*sizeof(qreal));
+    return 0;
+}
@@ -0,0 +1,148 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef CACHEFILE_H
+#define CACHEFILE_H
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "datacolumn.h"
+#include "stringdict.h"
+
+// Binary columnar cache (.mxc) written next to a parsed sample file.
+// A fixed header is followed by sections, each starting on a
+// CACHE_ALIGN boundary so mapped columns can be used in place.
+#define CACHE_MAGIC "MEMAXES\0"
+#define CACHE_VERSION 3
+#define CACHE_ALIGN 64
+
+struct CacheHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 numDimensions;
+    quint64 numElements;
+    qint64 sourceSize;   // size and mtime of the sample file it came from
+    qint64 sourceMtime;
+    quint64 fileSize;    // detects truncated writes
+    quint32 flags;
+    quint32 dataSourceEncoding; // of the sample file, 0 (Intel PEBS) in older caches
+};
+
+// Header flags
+#define CACHE_HAS_SORTED_LISTS 0x1
+
+struct CacheColumnHeader
+{
+    quint32 type;
+    quint32 flags;
+    quint64 numValues;
+    qreal vmin;
+    qreal vmax;
+};
+
+#define CACHE_COLUMN_INTEGRAL 0x1
+#define CACHE_COLUMN_EXACT_FLOAT 0x2
+
+// Writes to a temporary file, renamed over the cache on finish().
+// Sections can also be reserved and filled later through map(), for
+// data that is streamed in after the layout is known.
+class CacheWriter
+{
+public:
+    CacheWriter(QString fileName);
+
+    int open();
+    int finish(CacheHeader header);
+    void abort();
+
+    qint64 reserve(qint64 bytes);
+    qint64 reserveColumn(column_type t, const ColumnRange &r);
+    char *map();
+
+    void put(const void *data, qint64 bytes);
+    void putColumn(const DataColumn &col);
+    void putDict(const StringDict &dict);
+    void putStringList(const QStringList &list);
+    void putReals(const QVector<qreal> &vals);
+
+private:
+    void align();
+
+private:
+    QString cacheFileName;
+    QFile file;
+    qint64 offset;
+    int err;
+
+    uchar *mapped;
+};
+
+// Maps a cache file and reads its sections in order. Columns are
+// attached to the mapping, so the reader must outlive them.
+class CacheReader
+{
+public:
+    CacheReader();
+    ~CacheReader();
+
+    int open(QString fileName, qint64 sourceSize, qint64 sourceMtime);
+    void close();
+
+    const CacheHeader &header() const { return *(const CacheHeader*)data; }
+
+    const char *take(quint64 bytes);
+    int getColumn(DataColumn &col, quint64 numValues);
+    int getDict(StringDict &dict);
+    int getStringList(QStringList &list);
+    int getReals(QVector<qreal> &vals, int n);
+
+private:
+    void align();
+
+private:
+    QFile file;
+    const char *data;
+    qint64 size;
+    qint64 offset;
+};
+
+#endif // CACHEFILE_H
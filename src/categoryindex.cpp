@@ -0,0 +1,141 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "categoryindex.h"
+
+#include <algorithm>
+
+#define CATEGORY_DIRECT_KEYS (1<<16)
+#define CATEGORY_BLOCK_ELEMS 4096
+
+CategoryIndex::CategoryIndex()
+{
+}
+
+void CategoryIndex::clear()
+{
+    sets.clear();
+    direct.clear();
+    keySlots.clear();
+}
+
+int CategoryIndex::findSlot(qint64 key) const
+{
+    if(key >= 0 && key < CATEGORY_DIRECT_KEYS)
+        return (key < direct.size()) ? direct[key] - 1 : -1;
+    return keySlots.value(key,-1);
+}
+
+int CategoryIndex::slot(qint64 key)
+{
+    int s = findSlot(key);
+    if(s != -1)
+        return s;
+
+    s = sets.size();
+    sets.append(ElemSet());
+
+    if(key >= 0 && key < CATEGORY_DIRECT_KEYS)
+    {
+        if(key >= direct.size())
+            direct.resize(key + 1);
+        direct[key] = s + 1;
+    }
+    else
+    {
+        keySlots.insert(key,s);
+    }
+    return s;
+}
+
+void CategoryIndex::add(const DataColumn &col, ElemIndex first, ElemIndex last)
+{
+    QVector<qreal> vals(CATEGORY_BLOCK_ELEMS);
+    qint64 prevKey = 0;
+    int prevSlot = -1;
+
+    for(ElemIndex b=first; b<last; b+=CATEGORY_BLOCK_ELEMS)
+    {
+        ElemIndex n = std::min((ElemIndex)CATEGORY_BLOCK_ELEMS,last - b);
+        col.decode(b,n,vals.data());
+
+        for(ElemIndex i=0; i<n; i++)
+        {
+            qint64 k = key(vals[i]);
+            if(prevSlot == -1 || k != prevKey)
+            {
+                prevKey = k;
+                prevSlot = slot(k);
+            }
+            sets[prevSlot].insert(b + i);
+        }
+    }
+}
+
+void CategoryIndex::add(const DataColumn &major, const DataColumn &minor,
+                        ElemIndex first, ElemIndex last)
+{
+    QVector<qreal> majors(CATEGORY_BLOCK_ELEMS);
+    QVector<qreal> minors(CATEGORY_BLOCK_ELEMS);
+    qint64 prevKey = 0;
+    int prevSlot = -1;
+
+    for(ElemIndex b=first; b<last; b+=CATEGORY_BLOCK_ELEMS)
+    {
+        ElemIndex n = std::min((ElemIndex)CATEGORY_BLOCK_ELEMS,last - b);
+        major.decode(b,n,majors.data());
+        minor.decode(b,n,minors.data());
+
+        for(ElemIndex i=0; i<n; i++)
+        {
+            qint64 k = pairKey(majors[i],minors[i]);
+            if(prevSlot == -1 || k != prevKey)
+            {
+                prevKey = k;
+                prevSlot = slot(k);
+            }
+            sets[prevSlot].insert(b + i);
+        }
+    }
+}
+
+const ElemSet *CategoryIndex::find(qint64 key) const
+{
+    int s = findSlot(key);
+    return (s == -1) ? NULL : &sets[s];
+}
@@ -0,0 +1,89 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef CATEGORYINDEX_H
+#define CATEGORYINDEX_H
+
+#include <QVector>
+#include <QHash>
+
+#include "datacolumn.h"
+#include "elembitmap.h"
+
+// 2^63, the first magnitude a key cannot hold
+#define CATEGORY_KEY_LIMIT 9223372036854775808.0
+
+// Inverted index of a categorical dimension (or pair of dimensions): for
+// every value, the bitmap of the elements holding it. Small non-negative
+// keys, like IDs and CPU numbers, are found through a direct table and
+// the rest through a hash.
+class CategoryIndex
+{
+public:
+    CategoryIndex();
+
+    void clear();
+
+    // Indexes elements [first,last), by one column or by a pair of them
+    void add(const DataColumn &col, ElemIndex first, ElemIndex last);
+    void add(const DataColumn &major, const DataColumn &minor, ElemIndex first, ElemIndex last);
+
+    // The elements holding key, NULL if there are none
+    const ElemSet *find(qint64 key) const;
+
+    int size() const { return sets.size(); }
+    bool empty() const { return sets.isEmpty(); }
+
+    // val must be a whole number within +-CATEGORY_KEY_LIMIT
+    static qint64 key(qreal val) { return (qint64)val; }
+    // Both halves as 32 bit patterns, so negative values neither shift
+    // a sign nor borrow from the major half
+    static qint64 pairKey(qreal major, qreal minor)
+        { return (qint64)(((quint64)(quint32)(qint32)major << 32) | (quint32)(qint32)minor); }
+
+private:
+    int slot(qint64 key);
+    int findSlot(qint64 key) const;
+
+private:
+    QVector<ElemSet> sets;
+    QVector<int> direct;        // slot+1 of small keys, 0 if none
+    QHash<qint64,int> keySlots;    // slots of the other keys
+};
+
+#endif // CATEGORYINDEX_H
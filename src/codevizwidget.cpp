@@ -74,93 +74,181 @@ CodeViz::~CodeViz()
     closeAll();
 }
 
-int CodeViz::getFileID(QString name)
+int CodeViz::getFileID(int sourceID)
 {
-    for(int i=0; i<sourceBlocks.size(); i++)
-    {
-        if(sourceBlocks[i].name == name)
-            return i;
-    }
+    if(sourceBlockIDs[sourceID] != -1)
+        return sourceBlockIDs[sourceID];
 
     // First time we see this name, new entry
+    QString name = dataSet->sourceDict.name(sourceID);
     QString srcFile = sourceDir+"/"+name;
     QFile *src = new QFile(srcFile);
     src->open(QIODevice::ReadOnly | QIODevice::Text);
 
-    sourceBlock newBlock = {name, src, 0, QRect(), 0, QVector<lineBlock>()};
-    sourceBlocks.push_back(newBlock);
+    sourceBlock newBlock = {name, src, 0, QRect(), 0, QVector<lineBlock>(), QVector<int>(),
+                            QVector<qint64>(), QHash<int,int>()};
+    allSourceBlocks.push_back(newBlock);
 
-    return sourceBlocks.size()-1;
+    sourceBlockIDs[sourceID] = allSourceBlocks.size()-1;
+    return allSourceBlocks.size()-1;
 }
 
 int CodeViz::getLineID(sourceBlock *src, int line)
 {
-    for(int i=0; i<src->lineBlocks.size(); i++)
-    {
-        if(src->lineBlocks[i].line == line)
-            return i;
-    }
+    int id = src->lineIDs.value(line,-1);
+    if(id != -1)
+        return id;
 
     // First time we see this line, new entry
-    lineBlock newBlock = {line, 0, QRect()};
+    lineBlock newBlock = {line, 0, QRect(), QVector<qint64>()};
     src->lineBlocks.push_back(newBlock);
 
+    src->lineIDs.insert(line,src->lineBlocks.size()-1);
     return src->lineBlocks.size()-1;
 }
 
+// Adds (or with negative cycles takes) an element's cycles to its group's
+// totals of its source file and line
+void CodeViz::addCycles(ElemIndex elem, int group, qint64 cycles)
+{
+    int sourceIdx = this->getFileID(dataSet->at(elem,dataSet->sourceDim));
+    sourceBlock *src = &allSourceBlocks[sourceIdx];
+    addGroupValue(src->groupVals,group,cycles);
+
+    int lineIdx = this->getLineID(src,dataSet->at(elem,dataSet->lineDim));
+    addGroupValue(src->lineBlocks[lineIdx].groupVals,group,cycles);
+}
+
 void CodeViz::processData()
 {
     processed = false;
 
     closeAll();
 
+    allSourceBlocks.clear();
+    sourceOrder.clear();
+
+    sourceBlockIDs.resize(dataSet->sourceDict.size());
+    sourceBlockIDs.fill(-1);
+
+    // Every element counts towards its group's totals, so selection
+    // changes only move cycles between groups
+    const DataColumn &latencies = dataSet->column(dataSet->latencyDim);
+
+    for(ElemIndex elem=0; elem<dataSet->numElements; elem++)
+    {
+        // Downsampled elements stand for several samples
+        qint64 cycles = latencies.at(elem) * dataSet->weight(elem) + 0.5;
+        addCycles(elem,dataSet->selected(elem),cycles);
+    }
+
+    sortBlocks();
+
+    processed = true;
+}
+
+// The files and lines with a share of the selection, by value. Only
+// their indices are sorted, the blocks stay where they are.
+void CodeViz::sortBlocks()
+{
     sourceMaxVal = 0;
-    sourceBlocks.clear();
+    sourceOrder.clear();
 
-    // Get metric values
-    int elem = 0;
-    QVector<qreal>::Iterator p;
-    for(elem=0, p=dataSet->begin; p!=dataSet->end; elem++, p+=dataSet->numDimensions)
+    for(int i=0; i<allSourceBlocks.size(); i++)
     {
-        if(dataSet->selectionDefined() && !dataSet->selected(elem))
+        sourceBlock &src = allSourceBlocks[i];
+        src.val = shownGroupValue(src.groupVals);
+        src.lineMaxVal = 0;
+        src.lineOrder.clear();
+        if(src.val <= 0)
             continue;
 
-        int sourceIdx = this->getFileID(dataSet->fileNames[elem]);
-        sourceBlocks[sourceIdx].val += *(p+dataSet->latencyDim);
-        sourceMaxVal = std::max(sourceMaxVal,sourceBlocks[sourceIdx].val);
+        for(int j=0; j<src.lineBlocks.size(); j++)
+        {
+            lineBlock &line = src.lineBlocks[j];
+            line.val = shownGroupValue(line.groupVals);
+            if(line.val <= 0)
+                continue;
 
-        int lineIdx = this->getLineID(&sourceBlocks[sourceIdx],*(p+dataSet->lineDim));
-        sourceBlocks[sourceIdx].lineBlocks[lineIdx].val += *(p+dataSet->latencyDim);
+            src.lineOrder.push_back(j);
+            src.lineMaxVal = std::max(src.lineMaxVal,line.val);
+        }
+
+        // Negative latencies can leave a file with no line to show
+        if(src.lineOrder.empty())
+            continue;
 
-        sourceBlocks[sourceIdx].lineMaxVal = std::max(sourceBlocks[sourceIdx].lineMaxVal,
-                                                  sourceBlocks[sourceIdx].lineBlocks[lineIdx].val);
+        sourceOrder.push_back(i);
+        sourceMaxVal = std::max(sourceMaxVal,src.val);
     }
 
-    if(sourceBlocks.empty())
-    {
-        processed = true;
+    if(sourceOrder.empty())
         return;
-    }
 
     // Sort based on value
-    qSort(sourceBlocks.begin(),sourceBlocks.end());
-
-    for(int j=0; j<sourceBlocks.size(); j++)
-        qSort(sourceBlocks[j].lineBlocks.begin(),sourceBlocks[j].lineBlocks.end());
+    std::sort(sourceOrder.begin(),sourceOrder.end(),BlockOrder<sourceBlock>(allSourceBlocks));
 
-    emit sourceFileSelected(sourceBlocks[0].file);
-    emit sourceLineSelected(sourceBlocks[0].lineBlocks[0].line);
+    for(int i=0; i<sourceOrder.size(); i++)
+    {
+        sourceBlock &src = allSourceBlocks[sourceOrder[i]];
+        std::sort(src.lineOrder.begin(),src.lineOrder.end(),BlockOrder<lineBlock>(src.lineBlocks));
+    }
 
-    processed = true;
+    const sourceBlock &top = allSourceBlocks[sourceOrder[0]];
+    emit sourceFileSelected(top.file);
+    emit sourceLineSelected(top.lineBlocks[top.lineOrder[0]].line);
 }
 
 void CodeViz::selectionChangedSlot()
 {
-    if(processed)
+    if(!processed)
+        return;
+
+    const SelectionDelta &delta = dataSet->selectionDelta();
+    if(delta.full)
     {
         processData();
         needsRepaint = true;
+        return;
     }
+
+    const DataColumn &latencies = dataSet->column(dataSet->latencyDim);
+
+    for(unsigned int g=0; g<delta.changed.size(); g++)
+    {
+        for(ElemSet::const_iterator it = delta.changed[g].begin(); it != delta.changed[g].end(); it++)
+        {
+            qint64 cycles = latencies.at(*it) * dataSet->weight(*it) + 0.5;
+            addCycles(*it,g,-cycles);
+            addCycles(*it,dataSet->selected(*it),cycles);
+        }
+    }
+
+    sortBlocks();
+    needsRepaint = true;
+}
+
+// Only the new elements are added, under the group they are in
+void CodeViz::dataAppended(ElemIndex first)
+{
+    if(!processed)
+        return;
+
+    // Names first seen in the new elements
+    int numIDs = sourceBlockIDs.size();
+    sourceBlockIDs.resize(dataSet->sourceDict.size());
+    for(int i=numIDs; i<sourceBlockIDs.size(); i++)
+        sourceBlockIDs[i] = -1;
+
+    const DataColumn &latencies = dataSet->column(dataSet->latencyDim);
+    for(ElemIndex elem=first; elem<dataSet->numElements; elem++)
+    {
+        qint64 cycles = latencies.at(elem) * dataSet->weight(elem) + 0.5;
+        addCycles(elem,dataSet->selected(elem),cycles);
+    }
+
+    sortBlocks();
+    needsRepaint = true;
 }
 
 void CodeViz::drawQtPainter(QPainter *painter)
@@ -169,66 +257,72 @@ void CodeViz::drawQtPainter(QPainter *painter)
 
     painter->fillRect(drawSpace, bgColor);
 
-    if(!processed || sourceBlocks.empty())
+    if(!processed || sourceOrder.empty())
         return;
 
-    int numBlocks = std::min(numVisibleSourceBlocks,sourceBlocks.size());
+    int numBlocks = std::min(numVisibleSourceBlocks,sourceOrder.size());
     int blockHeight = drawSpace.height() / numBlocks;
     for(int i=0; i<numBlocks; i++)
     {
-        sourceBlocks[i].block.setLeft(drawSpace.left());
-        sourceBlocks[i].block.setTop(drawSpace.top()+i*blockHeight);
-        sourceBlocks[i].block.setWidth(sourceBlocks[i].val/sourceMaxVal*drawSpace.width());
-        sourceBlocks[i].block.setHeight(blockHeight);
+        sourceBlock &src = allSourceBlocks[sourceOrder[i]];
+        src.block.setLeft(drawSpace.left());
+        src.block.setTop(drawSpace.top()+i*blockHeight);
+        src.block.setWidth(src.val/sourceMaxVal*drawSpace.width());
+        src.block.setHeight(blockHeight);
 
-        painter->fillRect(sourceBlocks[i].block,Qt::lightGray);
+        painter->fillRect(src.block,Qt::lightGray);
+        drawGroupBar(painter,src.block,src.groupVals);
 
-        int numLines = std::min(numVisibleLineBlocks,sourceBlocks[i].lineBlocks.size());
-        int lineHeight = blockHeight / numLines;
+        int numLines = std::min(numVisibleLineBlocks,src.lineOrder.size());
+        int lineHeight = (numLines > 0) ? blockHeight / numLines : 0;
         for(int j=0; j<numLines; j++)
         {
-            sourceBlocks[i].lineBlocks[j].block.setLeft(drawSpace.left());
-            sourceBlocks[i].lineBlocks[j].block.setTop(sourceBlocks[i].block.top()+j*lineHeight);
-            sourceBlocks[i].lineBlocks[j].block.setWidth(sourceBlocks[i].lineBlocks[j].val/sourceBlocks[i].lineMaxVal*sourceBlocks[i].block.width());
-            sourceBlocks[i].lineBlocks[j].block.setHeight(lineHeight);
-
-            painter->fillRect(sourceBlocks[i].lineBlocks[j].block,Qt::gray);
+            lineBlock &line = src.lineBlocks[src.lineOrder[j]];
+            line.block.setLeft(drawSpace.left());
+            line.block.setTop(src.block.top()+j*lineHeight);
+            line.block.setWidth(line.val/src.lineMaxVal*src.block.width());
+            line.block.setHeight(lineHeight);
+
+            painter->fillRect(line.block,Qt::gray);
+            drawGroupBar(painter,line.block,line.groupVals);
             painter->setPen(Qt::white);
-            painter->drawText(QPoint(sourceBlocks[i].block.right(),sourceBlocks[i].lineBlocks[j].block.top())
+            painter->drawText(QPoint(src.block.right(),line.block.top())
                               +QPoint(-40,16),
-                              QString::number(sourceBlocks[i].lineBlocks[j].line));
+                              QString::number(line.line));
         }
 
         painter->setPen(Qt::black);
-        painter->drawText(sourceBlocks[i].block.topLeft()+QPoint(0,16),sourceBlocks[i].name);
+        painter->drawText(src.block.topLeft()+QPoint(0,16),src.name);
     }
 }
 
 void CodeViz::mouseReleaseEvent(QMouseEvent *e)
 {
-    for(int i=0; i<sourceBlocks.size(); i++)
+    // Only the drawn blocks, the others keep the rects of older layouts
+    int numBlocks = std::min(numVisibleSourceBlocks,sourceOrder.size());
+    for(int i=0; i<numBlocks; i++)
     {
-        QRect sourceSelectionBox(sourceBlocks[i].block.left(),
-                                 sourceBlocks[i].block.top(),
+        const sourceBlock &src = allSourceBlocks[sourceOrder[i]];
+        QRect sourceSelectionBox(src.block.left(),
+                                 src.block.top(),
                                  rect().width(),
-                                 sourceBlocks[i].block.height());
+                                 src.block.height());
         if(sourceSelectionBox.contains(e->pos()))
         {
-            for(int j=0; j<sourceBlocks[i].lineBlocks.size(); j++)
+            int numLines = std::min(numVisibleLineBlocks,src.lineOrder.size());
+            for(int j=0; j<numLines; j++)
             {
-                QRect lineSelectionBox(sourceBlocks[i].block.left(),
-                                       sourceBlocks[i].lineBlocks[j].block.top(),
+                const lineBlock &line = src.lineBlocks[src.lineOrder[j]];
+                QRect lineSelectionBox(src.block.left(),
+                                       line.block.top(),
                                        rect().width(),
-                                       sourceBlocks[i].lineBlocks[j].block.height());
+                                       line.block.height());
                 if(lineSelectionBox.contains(e->pos()))
                 {
-                    int dim = dataSet->lineDim;
-                    qreal lineval = sourceBlocks[i].lineBlocks[j].line;
-
-                    dataSet->selectByDimRange(dim,lineval-1,lineval);
+                    dataSet->selectBySourceLine(src.name,line.line);
 
-                    emit sourceFileSelected(sourceBlocks[i].file);
-                    emit sourceLineSelected(sourceBlocks[i].lineBlocks[j].line);
+                    emit sourceFileSelected(src.file);
+                    emit sourceLineSelected(line.line);
                     emit selectionChangedSig();
 
                     return;
@@ -245,8 +339,8 @@ void CodeViz::setSourceDir(QString dir)
 
 void CodeViz::closeAll()
 {
-    for(int i=0; i<sourceBlocks.size(); i++)
+    for(int i=0; i<allSourceBlocks.size(); i++)
     {
-        sourceBlocks[i].file->close();
+        allSourceBlocks[i].file->close();
     }
 }
@@ -41,11 +41,14 @@
 
 #include "vizwidget.h"
 
+#include <QHash>
+
 struct lineBlock
 {
     int line;
     qreal val;
     QRect block;
+    QVector<qint64> groupVals;
 };
 
 struct sourceBlock
@@ -57,6 +60,9 @@ struct sourceBlock
 
     qreal lineMaxVal;
     QVector<lineBlock> lineBlocks;
+    QVector<int> lineOrder; // shown lineBlocks indices, by value
+    QVector<qint64> groupVals;
+    QHash<int,int> lineIDs; // line -> lineBlocks index
 };
 
 class CodeViz : public VizWidget
@@ -73,6 +79,7 @@ signals:
 protected:
     void processData();
     void selectionChangedSlot();
+    void dataAppended(ElemIndex first);
     //void visibilityChangedSlot();
     void drawQtPainter(QPainter *painter);
 
@@ -82,8 +89,10 @@ public slots:
     void setSourceDir(QString dir);
 
 private:
-    int getFileID(QString name);
+    int getFileID(int sourceID);
     int getLineID(sourceBlock *src, int line);
+    void addCycles(ElemIndex elem, int group, qint64 cycles);
+    void sortBlocks();
     void closeAll();
 
 private:
@@ -96,7 +105,9 @@ private:
     int numVisibleLineBlocks;
 
     qreal sourceMaxVal;
-    QVector<sourceBlock> sourceBlocks;
+    QVector<int> sourceOrder; // shown allSourceBlocks indices, by value
+    QVector<sourceBlock> allSourceBlocks;
+    QVector<int> sourceBlockIDs; // dictionary ID -> allSourceBlocks index
 };
 
 #endif // CODEVIZ_H
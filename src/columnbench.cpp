@@ -0,0 +1,201 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+// Per-dimension scan benchmark: min/max and a 100 bin histogram over every
+// dimension of a sample file replicated to a given number of rows, once
+// over a strided row-major array (the old DataObject::vals layout) and
+// once over the typed columns.
+//
+//   columnbench <samples file> [rows]
+//
+// rows defaults to 100M. The row-major copy alone takes rows*dims*8
+// bytes (11.2 GB for the 14 lulesh dimensions at 100M), and it is freed
+// before the columns are built.
+
+#include <QFile>
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "sampleparser.h"
+#include "parseUtil.h"
+
+#define NUM_BINS 100
+
+static const qreal inf = std::numeric_limits<qreal>::infinity();
+
+static int readSamples(QString fileName, QVector<DataColumn> &columns, QStringList &meta)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly))
+        return -1;
+
+    const char *data = (const char*)file.map(0,file.size());
+    if(data == NULL)
+        return -1;
+    const char *end = data + file.size();
+
+    const char *eol = findLineEnd(data,end);
+    meta = QString::fromUtf8(data,trimCR(data,eol)-data).split(',');
+    int encoding = DSE_INTEL_PEBS;
+    for(int d=0; d<meta.size(); d++)
+    {
+        if(isDataSourceColumn(meta[d]))
+        {
+            encoding = findDataSourceEncoding(meta[d]);
+            meta[d] = "dataSource";
+        }
+    }
+
+    StringDict varDict;
+    StringDict sourceDict;
+    SampleParser parser(meta,encoding);
+    int err = parser.parse(nextLine(eol,end),end,columns,varDict,sourceDict);
+    meta = parser.dimensions();
+
+    file.unmap((uchar*)data);
+    return err;
+}
+
+static qreal rowMajorScan(const QVector<DataColumn> &src, ElemIndex rows)
+{
+    int numDims = src.size();
+    ElemIndex srcRows = src[0].size();
+
+    std::vector<qreal> vals(rows*numDims);
+    for(ElemIndex i=0; i<rows; i++)
+    {
+        for(int d=0; d<numDims; d++)
+            vals[i*numDims+d] = src[d].at(i % srcRows);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    qreal check = 0;
+    for(int d=0; d<numDims; d++)
+    {
+        qreal vmin = inf;
+        qreal vmax = -inf;
+        for(ElemIndex i=0; i<rows; i++)
+        {
+            qreal x = vals[i*numDims+d];
+            vmin = (x < vmin) ? x : vmin;
+            vmax = (x > vmax) ? x : vmax;
+        }
+
+        qreal range = (vmax == vmin) ? 1 : vmax - vmin;
+        qreal bins[NUM_BINS] = {0};
+        for(ElemIndex i=0; i<rows; i++)
+        {
+            int bin = floor(NUM_BINS * ((vals[i*numDims+d]-vmin) / range));
+            bin = std::min(std::max(bin,0),NUM_BINS-1);
+            bins[bin] += 1;
+        }
+        check += bins[0] + vmax;
+    }
+
+    std::cout << "row-major: " << timer.nsecsElapsed() / 1e9 << " s (" << check << ")" << std::endl;
+    return timer.nsecsElapsed() / 1e9;
+}
+
+static qreal columnScan(const QVector<DataColumn> &src, ElemIndex rows)
+{
+    int numDims = src.size();
+    ElemIndex srcRows = src[0].size();
+
+    QVector<DataColumn> columns(numDims);
+    std::vector<qreal> buf(srcRows);
+    for(int d=0; d<numDims; d++)
+    {
+        src[d].decode(0,srcRows,buf.data());
+        for(ElemIndex i=0; i<rows; i+=srcRows)
+            columns[d].append(buf.data(),std::min(srcRows,rows-i));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    qreal check = 0;
+    for(int d=0; d<numDims; d++)
+    {
+        qreal vmin = inf;
+        qreal vmax = -inf;
+        columnMinMax(columns[d],NoMask(),vmin,vmax);
+
+        qreal bins[NUM_BINS] = {0};
+        columnHistogram(columns[d],NoMask(),vmin,vmax,bins,NUM_BINS);
+        check += bins[0] + vmax;
+    }
+
+    std::cout << "columnar:  " << timer.nsecsElapsed() / 1e9 << " s (" << check << ")" << std::endl;
+    return timer.nsecsElapsed() / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: columnbench <samples file> [rows]" << std::endl;
+        return 1;
+    }
+
+    ElemIndex rows = (argc > 2) ? QString(argv[2]).toULongLong() : 100000000ULL;
+
+    QVector<DataColumn> columns;
+    QStringList meta;
+    if(readSamples(argv[1],columns,meta) != 0 || columns.isEmpty() || columns[0].empty())
+    {
+        std::cerr << "ERROR: could not read " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::cout << columns[0].size() << " samples, " << meta.size()
+              << " dimensions, replicated to " << rows << " rows" << std::endl;
+
+    qreal rowTime = rowMajorScan(columns,rows);
+    qreal colTime = columnScan(columns,rows);
+    std::cout << "speedup:   " << rowTime / colTime << "x" << std::endl;
+
+    return 0;
+}
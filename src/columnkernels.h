@@ -0,0 +1,367 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef COLUMNKERNELS_H
+#define COLUMNKERNELS_H
+
+#include <QtGlobal>
+#include <QVector>
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <string.h>
+
+#include "datacolumn.h"
+#include "elembitmap.h"
+
+// Element masks for the kernels below. NoMask compiles away, leaving
+// plain unit-stride loops the compiler can vectorize.
+struct NoMask
+{
+    bool operator()(ElemIndex) const { return true; }
+};
+
+// Element weights for the histogram kernels
+struct UnitWeight
+{
+    qreal operator()(ElemIndex) const { return 1; }
+};
+
+struct ColumnWeight
+{
+    ColumnWeight(const DataColumn &c, ElemIndex first = 0) : col(c), offset(first) {}
+    qreal operator()(ElemIndex i) const { return col.at(offset+i); }
+
+    const DataColumn &col;
+    ElemIndex offset;
+};
+
+template<typename T, typename Mask>
+void columnMinMax(const T *vals, ElemIndex n, Mask mask, qreal &vmin, qreal &vmax)
+{
+    qreal lo = vmin;
+    qreal hi = vmax;
+    for(ElemIndex i=0; i<n; i++)
+    {
+        if(!mask(i))
+            continue;
+        qreal x = vals[i];
+        lo = (x < lo) ? x : lo;
+        hi = (x > hi) ? x : hi;
+    }
+    vmin = lo;
+    vmax = hi;
+}
+
+template<typename T>
+qreal columnSum(const T *vals, ElemIndex n)
+{
+    qreal sum = 0;
+    for(ElemIndex i=0; i<n; i++)
+        sum += vals[i];
+    return sum;
+}
+
+template<typename T>
+qreal columnSquaredDeviation(const T *vals, ElemIndex n, qreal mean)
+{
+    qreal sum = 0;
+    for(ElemIndex i=0; i<n; i++)
+        sum += (vals[i]-mean)*(vals[i]-mean);
+    return sum;
+}
+
+// Adds the weight of each (masked) element into numBins equal bins over [vmin,vmax]
+template<typename T, typename Mask, typename Weight>
+void columnHistogram(const T *vals, ElemIndex n, Mask mask, Weight weight,
+                     qreal vmin, qreal vmax, qreal *bins, int numBins)
+{
+    qreal range = vmax - vmin;
+    range = (range == 0) ? 1 : range;
+
+    for(ElemIndex i=0; i<n; i++)
+    {
+        if(!mask(i))
+            continue;
+
+        int bin = floor(numBins * ((vals[i]-vmin) / range));
+        bin = std::min(std::max(bin,0),numBins-1);
+        bins[bin] += weight(i);
+    }
+}
+
+// Inserts every element with vmin <= value <= vmax
+template<typename T>
+void columnRangeScan(const T *vals, ElemIndex n, qreal vmin, qreal vmax, ElemSet &out)
+{
+    for(ElemIndex i=0; i<n; i++)
+    {
+        if(vals[i] >= vmin && vals[i] <= vmax)
+            out.insert(i);
+    }
+}
+
+// Inserts every element with vmin < value <= vmax, the same interval the
+// sorted-list range selection covers
+template<typename T>
+void columnIntervalScan(const T *vals, ElemIndex n, qreal vmin, qreal vmax, ElemSet &out)
+{
+    for(ElemIndex i=0; i<n; i++)
+    {
+        if(vals[i] > vmin && vals[i] <= vmax)
+            out.insert(i);
+    }
+}
+
+// Histograms of every selection group in one pass: adds the weight of
+// each element into bins[group*numBins + bin], groups holding one group
+// ID per element
+template<typename T, typename Weight>
+void columnGroupHistogram(const T *vals, ElemIndex n, const quint8 *groups, Weight weight,
+                          qreal vmin, qreal vmax, qreal *bins, int numBins)
+{
+    qreal range = vmax - vmin;
+    range = (range == 0) ? 1 : range;
+
+    for(ElemIndex i=0; i<n; i++)
+    {
+        int bin = floor(numBins * ((vals[i]-vmin) / range));
+        bin = std::min(std::max(bin,0),numBins-1);
+        bins[groups[i]*numBins + bin] += weight(i);
+    }
+}
+
+// Closed bounds lo <= value <= hi in T's own domain equivalent to
+// vmin < value <= vmax, so the compares need no conversions. False when
+// no value of T lies inside.
+template<typename T>
+bool intervalBounds(qreal vmin, qreal vmax, T &lo, T &hi)
+{
+    qreal tmin = std::numeric_limits<T>::min();
+    qreal tmax = std::numeric_limits<T>::max();
+    qreal l = std::floor(vmin) + 1;
+    qreal h = std::floor(vmax);
+    if(l > tmax || h < tmin || l > h)
+        return false;
+
+    lo = (l <= tmin) ? std::numeric_limits<T>::min() : (T)l;
+    hi = (h >= tmax) ? std::numeric_limits<T>::max() : (T)h;
+    return true;
+}
+
+template<>
+inline bool intervalBounds(qreal vmin, qreal vmax, double &lo, double &hi)
+{
+    lo = std::isinf(vmin) ? vmin : std::nextafter(vmin,std::numeric_limits<double>::infinity());
+    hi = vmax;
+    return lo <= hi;
+}
+
+template<>
+inline bool intervalBounds(qreal vmin, qreal vmax, float &lo, float &hi)
+{
+    const float inf = std::numeric_limits<float>::infinity();
+    lo = (float)vmin;
+    if(!std::isinf(vmin) && lo <= vmin)
+        lo = std::nextafter(lo,inf);
+    hi = (float)vmax;
+    if(hi > vmax)
+        hi = std::nextafter(hi,-inf);
+    return lo <= hi;
+}
+
+// Packs vmin < value <= vmax for n values into bits, one word per 64
+// values. With accumulate the bits are ANDed into words and words already
+// zero are skipped. The compares go to a byte per value first, which
+// vectorizes, and eight bytes at a time are then packed with a multiply.
+template<typename T>
+void columnIntervalMask(const T *vals, ElemIndex n, qreal vmin, qreal vmax,
+                        quint64 *words, bool accumulate)
+{
+    ElemIndex numWords = (n + 63) / 64;
+
+    T lo;
+    T hi;
+    if(!intervalBounds(vmin,vmax,lo,hi))
+    {
+        std::fill(words,words + numWords,0);
+        return;
+    }
+
+    for(ElemIndex w=0; w<numWords; w++)
+    {
+        if(accumulate && !words[w])
+            continue;
+
+        const T *v = vals + w*64;
+        int count = (int)std::min((ElemIndex)64,n - w*64);
+        quint8 flags[64];
+        if(count == 64)
+        {
+            for(int b=0; b<64; b++)
+                flags[b] = (v[b] >= lo) & (v[b] <= hi);
+        }
+        else
+        {
+            memset(flags,0,sizeof(flags));
+            for(int b=0; b<count; b++)
+                flags[b] = (v[b] >= lo) & (v[b] <= hi);
+        }
+
+        quint64 bits = 0;
+        for(int k=0; k<8; k++)
+        {
+            quint64 x;
+            memcpy(&x,flags + 8*k,8);
+            bits |= ((x * 0x0102040810204080ULL) >> 56) << (8*k);
+        }
+
+        words[w] = accumulate ? (words[w] & bits) : bits;
+    }
+}
+
+// Sets the bit of every element listed in idx in a flat bitmap
+template<typename T>
+void columnMarkElements(const T *idx, ElemIndex n, quint64 *words)
+{
+    for(ElemIndex i=0; i<n; i++)
+    {
+        ElemIndex e = (ElemIndex)idx[i];
+        words[e >> 6] |= 1ULL << (e & 63);
+    }
+}
+
+// The same kernels over a whole column, dispatched on its physical type
+template<typename Mask>
+void columnMinMax(const DataColumn &col, Mask mask, qreal &vmin, qreal &vmax)
+{
+    DISPATCH_COLUMN_TYPE(col, columnMinMax(col.values<T>(),col.size(),mask,vmin,vmax));
+}
+
+inline qreal columnSum(const DataColumn &col)
+{
+    DISPATCH_COLUMN_TYPE(col, return columnSum(col.values<T>(),col.size()));
+    return 0;
+}
+
+inline qreal columnSquaredDeviation(const DataColumn &col, qreal mean)
+{
+    DISPATCH_COLUMN_TYPE(col, return columnSquaredDeviation(col.values<T>(),col.size(),mean));
+    return 0;
+}
+
+template<typename Mask, typename Weight>
+void columnHistogram(const DataColumn &col, Mask mask, Weight weight,
+                     qreal vmin, qreal vmax, qreal *bins, int numBins)
+{
+    DISPATCH_COLUMN_TYPE(col, columnHistogram(col.values<T>(),col.size(),mask,weight,vmin,vmax,bins,numBins));
+}
+
+template<typename Mask>
+void columnHistogram(const DataColumn &col, Mask mask,
+                     qreal vmin, qreal vmax, qreal *bins, int numBins)
+{
+    columnHistogram(col,mask,UnitWeight(),vmin,vmax,bins,numBins);
+}
+
+// Unmasked variants over the elements [first,last) only, for data
+// appended to a column
+inline void columnMinMax(const DataColumn &col, ElemIndex first, ElemIndex last, qreal &vmin, qreal &vmax)
+{
+    DISPATCH_COLUMN_TYPE(col, columnMinMax(col.values<T>()+first,last-first,NoMask(),vmin,vmax));
+}
+
+inline qreal columnSum(const DataColumn &col, ElemIndex first, ElemIndex last)
+{
+    DISPATCH_COLUMN_TYPE(col, return columnSum(col.values<T>()+first,last-first));
+    return 0;
+}
+
+inline void columnHistogram(const DataColumn &col, ElemIndex first, ElemIndex last,
+                            qreal vmin, qreal vmax, qreal *bins, int numBins)
+{
+    DISPATCH_COLUMN_TYPE(col, columnHistogram(col.values<T>()+first,last-first,NoMask(),UnitWeight(),
+                                              vmin,vmax,bins,numBins));
+}
+
+inline void columnHistogram(const DataColumn &col, ElemIndex first, ElemIndex last, const DataColumn &weights,
+                            qreal vmin, qreal vmax, qreal *bins, int numBins)
+{
+    DISPATCH_COLUMN_TYPE(col, columnHistogram(col.values<T>()+first,last-first,NoMask(),ColumnWeight(weights,first),
+                                              vmin,vmax,bins,numBins));
+}
+
+inline void columnGroupHistogram(const DataColumn &col, ElemIndex first, ElemIndex last,
+                                 const quint8 *groups, qreal vmin, qreal vmax,
+                                 qreal *bins, int numBins)
+{
+    DISPATCH_COLUMN_TYPE(col, columnGroupHistogram(col.values<T>()+first,last-first,groups+first,UnitWeight(),
+                                                   vmin,vmax,bins,numBins));
+}
+
+inline void columnGroupHistogram(const DataColumn &col, ElemIndex first, ElemIndex last,
+                                 const quint8 *groups, const DataColumn &weights,
+                                 qreal vmin, qreal vmax, qreal *bins, int numBins)
+{
+    DISPATCH_COLUMN_TYPE(col, columnGroupHistogram(col.values<T>()+first,last-first,groups+first,
+                                                   ColumnWeight(weights,first),vmin,vmax,bins,numBins));
+}
+
+inline void columnRangeScan(const DataColumn &col, qreal vmin, qreal vmax, ElemSet &out)
+{
+    DISPATCH_COLUMN_TYPE(col, columnRangeScan(col.values<T>(),col.size(),vmin,vmax,out));
+}
+
+inline void columnIntervalScan(const DataColumn &col, qreal vmin, qreal vmax, ElemSet &out)
+{
+    DISPATCH_COLUMN_TYPE(col, columnIntervalScan(col.values<T>(),col.size(),vmin,vmax,out));
+}
+
+inline void columnIntervalMask(const DataColumn &col, ElemIndex first, ElemIndex last,
+                               qreal vmin, qreal vmax, quint64 *words, bool accumulate)
+{
+    DISPATCH_COLUMN_TYPE(col, columnIntervalMask(col.values<T>()+first,last-first,vmin,vmax,words,accumulate));
+}
+
+inline void columnMarkElements(const DataColumn &col, ElemIndex first, ElemIndex last, quint64 *words)
+{
+    DISPATCH_COLUMN_TYPE(col, columnMarkElements(col.values<T>()+first,last-first,words));
+}
+
+#endif // COLUMNKERNELS_H
@@ -37,8 +37,11 @@
 //////////////////////////////////////////////////////////////////////////////
 
 #include <QTime>
+#include <QThread>
+#include <QElapsedTimer>
 
 #include "console.h"
+#include "selectionquery.h"
 
 static QString titleText(
     "---- MemAxes Console ----\n"
@@ -47,25 +50,27 @@ static QString titleText(
 static QString helpText(
     "Commands : \n"
     "    \n"
-    "    select [--mode={new,append,filter}] <query>\n"
+    "    select [--mode={new,append,filter}] [--group=N] <query>\n"
     "    hide <query>\n"
     "    show <query>\n"
     "    \n"
-    "        <query> is of the form:\n"
-    "           [DIMRANGE dim=vmin:vmax]\n"
-    "           [RESOURCE resource=id]\n"
+    "        <query> is made of terms joined by AND, OR, NOT and ( ),\n"
+    "        terms side by side are ANDed:\n"
+    "           [DIMRANGE] dim=vmin:vmax   (either end may be left out)\n"
+    "           [DIMRANGE] dim=v1,v2,...   dim IN (v1,v2,...)   dim!=v\n"
+    "           [DIMRANGE] dim<v   dim<=v   dim>v   dim>=v\n"
+    "           RESOURCE {cpu,numa,cache,ram}=id[,id...]\n"
+    "        dim is a dimension name or index, sources and\n"
+    "        variables may be given by name\n"
     "    \n"
     "    inspect\n"
     "    \n"
-    "    derivedim <expression>\n"
-    "        <expression> is of the form:\n"
-    "            dim1 <op> dim2\n"
-    "        <op> is one of:\n"
-    "            + - * /\n"
     "Examples : \n"
     "    select DIMRANGE 4=30:40 5=4:5\n"
+    "    select --mode=append latency>=100 variable IN (x,y)\n"
+    "    select --group=2 source=\"lulesh.cc\" AND NOT RESOURCE cpu=0,1\n"
+    "    hide latency<10 OR RESOURCE cache=L3\n"
     "    \n"
-//    "    select RESOURCE cpu=4 cache=L3\n"
 );
 
 console::console(QWidget *parent) :
@@ -113,35 +118,109 @@ void console::inspectCommand(QStringList *args)
     log(QString::number(numTot));
 }
 
-void console::selectCommand(QStringList *args)
+bool console::runQuery(QString text, ElemSet &result)
 {
-    if(dataSet == NULL)
+    if(dataSet == NULL || dataSet->numElements == 0)
     {
         log("Unable to select from the void, please load data first");
-        return;
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    SelectionQuery query(dataSet);
+    if(!query.compile(text))
+    {
+        log("Invalid query : "+query.error());
+        return false;
     }
+    query.evaluate(result);
 
-    if(args == NULL || args->size() < 3)
+    log(QString::number(result.size())+" samples matched in "
+        +QString::number(timer.elapsed())+" ms");
+    return true;
+}
+
+void console::selectCommand(QStringList *args)
+{
+    if(args == NULL || args->size() < 2)
     {
         log("Invalid arguments");
         return;
     }
 
-    QUERY_TYPE qt = getQueryType(args->at(1));
+    selection_mode mode = dataSet ? dataSet->selectionMode() : MODE_NEW;
+    int group = -1;
 
-    if(qt == QUERY_UNKNOWN)
+    int i = 1;
+    for(; i<args->size() && args->at(i).startsWith("--"); i++)
+    {
+        QString opt = args->at(i).toLower();
+        if(opt == "--mode=new")
+            mode = MODE_NEW;
+        else if(opt == "--mode=append")
+            mode = MODE_APPEND;
+        else if(opt == "--mode=filter")
+            mode = MODE_FILTER;
+        else if(opt.startsWith("--group="))
+        {
+            bool ok;
+            group = opt.mid(8).toInt(&ok);
+            if(!ok || group < 1 || group > MAX_SELECTION_GROUPS)
+            {
+                log("Invalid group "+opt.mid(8));
+                return;
+            }
+        }
+        else
+        {
+            log("Unknown option "+args->at(i));
+            return;
+        }
+    }
+
+    QString text;
+    for(; i<args->size(); i++)
+        text += args->at(i) + " ";
+
+    ElemSet result;
+    if(!runQuery(text,result))
+        return;
+
+    selection_mode oldMode = dataSet->selectionMode();
+    dataSet->setSelectionMode(mode,true);
+    dataSet->selectSet(result,group);
+    dataSet->setSelectionMode(oldMode,true);
+
+    emit selectionChangedSig();
+}
+
+void console::visibilityCommand(QStringList *args, bool show)
+{
+    if(args == NULL || args->size() < 2)
     {
         log("Invalid arguments");
         return;
     }
 
-    if(qt == QUERY_DIMRANGE)
-    {
-        struct dimRangeQuery drq = createDimRangeQuery(args);
-        //dataSet->selectByMultiDimRange(drq.dims,drq.mins,drq.maxes);
-        emit selectionChangedSig();
+    QString text;
+    for(int i=1; i<args->size(); i++)
+        text += args->at(i) + " ";
+
+    ElemSet result;
+    if(!runQuery(text,result))
         return;
+
+    for(ElemSet::const_iterator it = result.begin(); it != result.end(); it++)
+    {
+        if(show)
+            dataSet->showData(*it);
+        else
+            dataSet->hideData(*it);
     }
+
+    emit visibilityChangedSig();
 }
 
 CMD_TYPE console::getCommandType(QString cmd)
@@ -151,49 +230,15 @@ CMD_TYPE console::getCommandType(QString cmd)
         return CMD_HELP;
     else if(cmd == "select" || cmd == "sel")
         return CMD_SELECT;
+    else if(cmd == "hide")
+        return CMD_HIDE;
+    else if(cmd == "show")
+        return CMD_SHOW;
     else if(cmd == "inspect" || cmd == "ins")
         return CMD_INSPECT;
     return CMD_UNKNOWN;
 }
 
-QUERY_TYPE console::getQueryType(QString qtype)
-{
-    qtype = qtype.toLower();
-    if(qtype == "dimrange")
-        return QUERY_DIMRANGE;
-    else if(qtype == "resource")
-        return QUERY_RESOURCE;
-    return QUERY_UNKNOWN;
-}
-
-dimRange console::createDimRange(QString str)
-{
-    QStringList eqSplit = str.split("=");
-    QStringList rangeStrs = eqSplit[1].split(":");
-
-    struct dimRange dr;
-    dr.dim = eqSplit[0];
-    dr.min = rangeStrs[0].toDouble();
-    dr.max = rangeStrs[1].toDouble();
-
-    return dr;
-}
-
-struct dimRangeQuery console::createDimRangeQuery(QStringList *args)
-{
-    struct dimRangeQuery drq;
-
-    for(int i=2; i<args->size(); i++)
-    {
-        struct dimRange dr = createDimRange(args->at(i));
-        drq.dims.push_back(dr.dim);
-        drq.mins.push_back(dr.min);
-        drq.maxes.push_back(dr.max);
-    }
-
-    return drq;
-}
-
 void console::command(int i)
 {
     Q_UNUSED(i);
@@ -219,6 +264,12 @@ void console::command(int i)
     case(CMD_SELECT):
         selectCommand(&cmdArgs);
         break;
+    case(CMD_HIDE):
+        visibilityCommand(&cmdArgs,false);
+        break;
+    case(CMD_SHOW):
+        visibilityCommand(&cmdArgs,true);
+        break;
     case(CMD_INSPECT):
         inspectCommand(&cmdArgs);
         break;
@@ -235,6 +286,13 @@ void console::log(const char *msg)
 
 void console::log(QString msg)
 {
+    // Loading threads log too, the text is appended on the GUI thread
+    if(QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this,"log",Qt::QueuedConnection,Q_ARG(QString,msg));
+        return;
+    }
+
     QString timestamp = QTime::currentTime().toString();
     this->append(timestamp+"$ "+msg);
 
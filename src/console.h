@@ -44,6 +44,7 @@
 #include <QScrollBar>
 
 #include "dataobject.h"
+#include "elembitmap.h"
 #include "util.h"
 
 class DataObject;
@@ -51,28 +52,12 @@ class DataObject;
 enum CMD_TYPE {
     CMD_HELP = 0,
     CMD_SELECT,
+    CMD_HIDE,
+    CMD_SHOW,
     CMD_INSPECT,
     CMD_UNKNOWN
 };
 
-enum QUERY_TYPE {
-    QUERY_DIMRANGE = 0,
-    QUERY_RESOURCE,
-    QUERY_UNKNOWN
-};
-
-struct dimRangeQuery {
-    QVector<QString> dims;
-    QVector<qreal> mins;
-    QVector<qreal> maxes;
-};
-
-struct dimRange {
-    QString dim;
-    qreal min;
-    qreal max;
-};
-
 class console : public QTextBrowser
 {
     Q_OBJECT
@@ -85,23 +70,23 @@ public:
 
 signals:
     void selectionChangedSig();
+    void visibilityChangedSig();
 
 public slots:
     CMD_TYPE getCommandType(QString cmd);
-    QUERY_TYPE getQueryType(QString qtype);
-
-    struct dimRange createDimRange(QString str);
-    struct dimRangeQuery createDimRangeQuery(QStringList *args);
 
     void helpCommand(QStringList *args);
     void inspectCommand(QStringList *args);
     void selectCommand(QStringList *args);
+    void visibilityCommand(QStringList *args, bool show);
 
     void command(int i);
     void log(const char *msg);
     void log(QString msg);
 
 private:
+    bool runQuery(QString text, ElemSet &result);
+
     QPlainTextEdit *console_input;
     DataObject *dataSet;
     QScrollBar *sb;
@@ -0,0 +1,342 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "datacolumn.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+ColumnRange::ColumnRange()
+{
+    count = 0;
+    vmin = 0;
+    vmax = 0;
+    integral = true;
+    exactFloat = true;
+}
+
+void ColumnRange::add(const qreal *vals, ElemIndex n)
+{
+    if(n == 0)
+        return;
+
+    qreal lo = vals[0];
+    qreal hi = vals[0];
+    bool isIntegral = true;
+    bool isExactFloat = true;
+    for(ElemIndex i=0; i<n; i++)
+    {
+        lo = std::min(lo,vals[i]);
+        hi = std::max(hi,vals[i]);
+        isIntegral = isIntegral && (vals[i] == floor(vals[i]));
+        isExactFloat = isExactFloat && ((qreal)(float)vals[i] == vals[i]);
+    }
+
+    vmin = (count == 0) ? lo : std::min(vmin,lo);
+    vmax = (count == 0) ? hi : std::max(vmax,hi);
+    integral = integral && isIntegral;
+    exactFloat = exactFloat && isExactFloat;
+    count += n;
+}
+
+static inline bool exactInFloat(qint64 val)
+{
+    qreal f = (float)val;
+    return f >= -9223372036854775808.0 && f < 9223372036854775808.0 && (qint64)f == val;
+}
+
+// Integers wider than a double's mantissa, e.g. addresses and timestamps,
+// only keep an approximate min and max. The values themselves stay exact
+// and always fit COL_INT64.
+void ColumnRange::add(const qint64 *vals, ElemIndex n)
+{
+    if(n == 0)
+        return;
+
+    qint64 lo = vals[0];
+    qint64 hi = vals[0];
+    bool isExactFloat = true;
+    for(ElemIndex i=0; i<n; i++)
+    {
+        lo = std::min(lo,vals[i]);
+        hi = std::max(hi,vals[i]);
+        isExactFloat = isExactFloat && exactInFloat(vals[i]);
+    }
+
+    // Rounding up to 2^63 would not fit COL_INT64 any more
+    qreal rlo = (qreal)lo;
+    qreal rhi = std::min((qreal)hi,9223372036854774784.0);
+
+    vmin = (count == 0) ? rlo : std::min(vmin,rlo);
+    vmax = (count == 0) ? rhi : std::max(vmax,rhi);
+    exactFloat = exactFloat && isExactFloat;
+    count += n;
+}
+
+column_type ColumnRange::type() const
+{
+    return DataColumn::narrowestType(vmin,vmax,integral,exactFloat);
+}
+
+DataColumn::DataColumn()
+{
+    clear();
+}
+
+void DataColumn::clear()
+{
+    colType = COL_UINT8;
+    numValues = 0;
+    storage.clear();
+    external = NULL;
+    colRange = ColumnRange();
+}
+
+// Drops the values from n on. The type and range stay as wide as before.
+void DataColumn::truncate(ElemIndex n)
+{
+    if(n >= numValues)
+        return;
+
+    if(external)
+        detach();
+
+    numValues = n;
+    colRange.count = n;
+    storage.resize(n*typeSize(colType));
+}
+
+// Becomes src's values in the given element order, in src's type
+void DataColumn::gather(const DataColumn &src, const ElemIndex *order, ElemIndex n)
+{
+    reset(src.type(),n);
+    colRange = src.range();
+    colRange.count = n;
+
+    DISPATCH_COLUMN_TYPE(*this,
+        T *dst = (T*)storage.data();
+        const T *vals = src.values<T>();
+        for(ElemIndex i=0; i<n; i++)
+            dst[i] = vals[order[i]];
+    );
+}
+
+int DataColumn::typeSize(column_type t)
+{
+    switch(t)
+    {
+        case(COL_UINT8):  return 1;
+        case(COL_INT8):   return 1;
+        case(COL_UINT16): return 2;
+        case(COL_INT16):  return 2;
+        case(COL_UINT32): return 4;
+        case(COL_INT32):  return 4;
+        case(COL_INT64):  return 8;
+        case(COL_FLOAT):  return 4;
+        case(COL_DOUBLE): return 8;
+    }
+    return 8;
+}
+
+const char *DataColumn::typeName(column_type t)
+{
+    switch(t)
+    {
+        case(COL_UINT8):  return "uint8";
+        case(COL_INT8):   return "int8";
+        case(COL_UINT16): return "uint16";
+        case(COL_INT16):  return "int16";
+        case(COL_UINT32): return "uint32";
+        case(COL_INT32):  return "int32";
+        case(COL_INT64):  return "int64";
+        case(COL_FLOAT):  return "float";
+        case(COL_DOUBLE): return "double";
+    }
+    return "???";
+}
+
+column_type DataColumn::narrowestType(qreal lo, qreal hi, bool integral, bool exactFloat)
+{
+    if(integral)
+    {
+        if(lo >= 0 && hi <= 0xFF)
+            return COL_UINT8;
+        if(lo >= -0x80 && hi <= 0x7F)
+            return COL_INT8;
+        if(lo >= 0 && hi <= 0xFFFF)
+            return COL_UINT16;
+        if(lo >= -0x8000 && hi <= 0x7FFF)
+            return COL_INT16;
+        if(lo >= 0 && hi <= 4294967295.0)
+            return COL_UINT32;
+        if(lo >= -2147483648.0 && hi <= 2147483647.0)
+            return COL_INT32;
+        if(lo >= -9223372036854775808.0 && hi < 9223372036854775808.0)
+            return COL_INT64;
+    }
+
+    return exactFloat ? COL_FLOAT : COL_DOUBLE;
+}
+
+void DataColumn::reset(column_type t, ElemIndex n)
+{
+    clear();
+    colType = t;
+    numValues = n;
+    storage.resize(n*typeSize(t));
+}
+
+void DataColumn::attach(column_type t, const char *data, const ColumnRange &r)
+{
+    clear();
+    colType = t;
+    numValues = r.count;
+    external = data;
+    colRange = r;
+}
+
+void DataColumn::detach()
+{
+    storage.assign(external,external + bytes());
+    external = NULL;
+}
+
+void DataColumn::convert(column_type t)
+{
+    std::vector<char> old;
+    old.swap(storage);
+
+    column_type oldType = colType;
+    colType = t;
+    storage.resize(numValues*typeSize(t));
+
+    // Widening never loses values, so going through qreal is exact
+    DISPATCH_COLUMN_TYPE(*this,
+        T *dst = (T*)storage.data();
+        switch(oldType)
+        {
+            case(COL_UINT8):  { const quint8 *src = (const quint8*)old.data();   for(ElemIndex i=0; i<numValues; i++) dst[i] = (T)src[i]; } break;
+            case(COL_INT8):   { const qint8 *src = (const qint8*)old.data();     for(ElemIndex i=0; i<numValues; i++) dst[i] = (T)src[i]; } break;
+            case(COL_UINT16): { const quint16 *src = (const quint16*)old.data(); for(ElemIndex i=0; i<numValues; i++) dst[i] = (T)src[i]; } break;
+            case(COL_INT16):  { const qint16 *src = (const qint16*)old.data();   for(ElemIndex i=0; i<numValues; i++) dst[i] = (T)src[i]; } break;
+            case(COL_UINT32): { const quint32 *src = (const quint32*)old.data(); for(ElemIndex i=0; i<numValues; i++) dst[i] = (T)src[i]; } break;
+            case(COL_INT32):  { const qint32 *src = (const qint32*)old.data();   for(ElemIndex i=0; i<numValues; i++) dst[i] = (T)src[i]; } break;
+            case(COL_INT64):  { const qint64 *src = (const qint64*)old.data();   for(ElemIndex i=0; i<numValues; i++) dst[i] = (T)src[i]; } break;
+            case(COL_FLOAT):  { const float *src = (const float*)old.data();     for(ElemIndex i=0; i<numValues; i++) dst[i] = (T)src[i]; } break;
+            case(COL_DOUBLE): { const double *src = (const double*)old.data();   for(ElemIndex i=0; i<numValues; i++) dst[i] = (T)src[i]; } break;
+        }
+    );
+}
+
+void DataColumn::encode(column_type t, const qreal *vals, ElemIndex n, char *dst)
+{
+    switch(t)
+    {
+        case(COL_UINT8):  { quint8 *out = (quint8*)dst;   for(ElemIndex i=0; i<n; i++) out[i] = (quint8)vals[i]; } break;
+        case(COL_INT8):   { qint8 *out = (qint8*)dst;     for(ElemIndex i=0; i<n; i++) out[i] = (qint8)vals[i]; } break;
+        case(COL_UINT16): { quint16 *out = (quint16*)dst; for(ElemIndex i=0; i<n; i++) out[i] = (quint16)vals[i]; } break;
+        case(COL_INT16):  { qint16 *out = (qint16*)dst;   for(ElemIndex i=0; i<n; i++) out[i] = (qint16)vals[i]; } break;
+        case(COL_UINT32): { quint32 *out = (quint32*)dst; for(ElemIndex i=0; i<n; i++) out[i] = (quint32)vals[i]; } break;
+        case(COL_INT32):  { qint32 *out = (qint32*)dst;   for(ElemIndex i=0; i<n; i++) out[i] = (qint32)vals[i]; } break;
+        case(COL_INT64):  { qint64 *out = (qint64*)dst;   for(ElemIndex i=0; i<n; i++) out[i] = (qint64)vals[i]; } break;
+        case(COL_FLOAT):  { float *out = (float*)dst;     for(ElemIndex i=0; i<n; i++) out[i] = (float)vals[i]; } break;
+        case(COL_DOUBLE): { double *out = (double*)dst;   for(ElemIndex i=0; i<n; i++) out[i] = (double)vals[i]; } break;
+    }
+}
+
+void DataColumn::encode(column_type t, const qint64 *vals, ElemIndex n, char *dst)
+{
+    switch(t)
+    {
+        case(COL_UINT8):  { quint8 *out = (quint8*)dst;   for(ElemIndex i=0; i<n; i++) out[i] = (quint8)vals[i]; } break;
+        case(COL_INT8):   { qint8 *out = (qint8*)dst;     for(ElemIndex i=0; i<n; i++) out[i] = (qint8)vals[i]; } break;
+        case(COL_UINT16): { quint16 *out = (quint16*)dst; for(ElemIndex i=0; i<n; i++) out[i] = (quint16)vals[i]; } break;
+        case(COL_INT16):  { qint16 *out = (qint16*)dst;   for(ElemIndex i=0; i<n; i++) out[i] = (qint16)vals[i]; } break;
+        case(COL_UINT32): { quint32 *out = (quint32*)dst; for(ElemIndex i=0; i<n; i++) out[i] = (quint32)vals[i]; } break;
+        case(COL_INT32):  { qint32 *out = (qint32*)dst;   for(ElemIndex i=0; i<n; i++) out[i] = (qint32)vals[i]; } break;
+        case(COL_INT64):  memcpy(dst,vals,n*sizeof(qint64)); break;
+        case(COL_FLOAT):  { float *out = (float*)dst;     for(ElemIndex i=0; i<n; i++) out[i] = (float)vals[i]; } break;
+        case(COL_DOUBLE): { double *out = (double*)dst;   for(ElemIndex i=0; i<n; i++) out[i] = (double)vals[i]; } break;
+    }
+}
+
+void DataColumn::append(const qreal *vals, ElemIndex n)
+{
+    appendValues(vals,n);
+}
+
+void DataColumn::append(const qint64 *vals, ElemIndex n)
+{
+    appendValues(vals,n);
+}
+
+template<typename V>
+void DataColumn::appendValues(const V *vals, ElemIndex n)
+{
+    if(n == 0)
+        return;
+
+    if(external)
+        detach();
+
+    bool first = (numValues == 0);
+    colRange.add(vals,n);
+
+    column_type t = colRange.type();
+    if(first)
+        colType = t;
+    else if(t != colType)
+        convert(t);
+
+    ElemIndex offset = numValues;
+    numValues += n;
+    storage.resize(numValues*typeSize(colType));
+
+    encode(colType,vals,n,storage.data() + offset*typeSize(colType));
+}
+
+void DataColumn::decode(ElemIndex first, ElemIndex n, qreal *out) const
+{
+    DISPATCH_COLUMN_TYPE(*this,
+        const T *src = values<T>() + first;
+        for(ElemIndex i=0; i<n; i++)
+            out[i] = src[i];
+    );
+}
@@ -0,0 +1,163 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef DATACOLUMN_H
+#define DATACOLUMN_H
+
+#include <QtGlobal>
+
+#include <vector>
+
+typedef unsigned long long ElemIndex;
+
+// Physical types, narrowest first
+enum column_type
+{
+    COL_UINT8 = 0,
+    COL_INT8,
+    COL_UINT16,
+    COL_INT16,
+    COL_UINT32,
+    COL_INT32,
+    COL_INT64,
+    COL_FLOAT,
+    COL_DOUBLE
+};
+
+// Expands EXPR once per physical type, with T bound to the column's
+// element type, and runs the one matching col.type()
+#define DISPATCH_COLUMN_TYPE(col, EXPR) \
+    switch((col).type()) \
+    { \
+        case(COL_UINT8):  { typedef quint8 T;  EXPR; } break; \
+        case(COL_INT8):   { typedef qint8 T;   EXPR; } break; \
+        case(COL_UINT16): { typedef quint16 T; EXPR; } break; \
+        case(COL_INT16):  { typedef qint16 T;  EXPR; } break; \
+        case(COL_UINT32): { typedef quint32 T; EXPR; } break; \
+        case(COL_INT32):  { typedef qint32 T;  EXPR; } break; \
+        case(COL_INT64):  { typedef qint64 T;  EXPR; } break; \
+        case(COL_FLOAT):  { typedef float T;   EXPR; } break; \
+        case(COL_DOUBLE): { typedef double T;  EXPR; } break; \
+    }
+
+// Count and range of the values seen so far, which decide the physical type
+struct ColumnRange
+{
+    ColumnRange();
+
+    void add(const qreal *vals, ElemIndex n);
+    void add(const qint64 *vals, ElemIndex n);
+    column_type type() const;
+
+    ElemIndex count;
+    qreal vmin;
+    qreal vmax;
+    bool integral;
+    bool exactFloat;
+};
+
+// One contiguous array of values for a single dimension, stored in the
+// narrowest physical type that holds every value seen so far. Appending
+// values outside that range widens the column in place.
+//
+// A column can also be attached to memory it does not own (a mapped
+// cache file). It is copied into its own storage on the first change.
+class DataColumn
+{
+public:
+    DataColumn();
+
+    column_type type() const { return colType; }
+    ElemIndex size() const { return numValues; }
+    bool empty() const { return numValues == 0; }
+    size_t bytes() const { return numValues*typeSize(colType); }
+
+    qreal minValue() const { return colRange.vmin; }
+    qreal maxValue() const { return colRange.vmax; }
+    const ColumnRange &range() const { return colRange; }
+    bool isAttached() const { return external != NULL; }
+
+    const char *rawData() const { return external ? external : storage.data(); }
+    template<typename T> const T *values() const { return (const T*)rawData(); }
+
+    inline qreal at(ElemIndex i) const;
+    void decode(ElemIndex first, ElemIndex n, qreal *out) const;
+
+    void append(const qreal *vals, ElemIndex n);
+    void append(const qint64 *vals, ElemIndex n);
+    void reset(column_type t, ElemIndex n);
+    inline void set(ElemIndex i, qreal val);
+    void truncate(ElemIndex n);
+    void gather(const DataColumn &src, const ElemIndex *order, ElemIndex n);
+    void clear();
+
+    void attach(column_type t, const char *data, const ColumnRange &r);
+
+    static int typeSize(column_type t);
+    static const char *typeName(column_type t);
+    static column_type narrowestType(qreal lo, qreal hi, bool integral, bool exactFloat);
+    static void encode(column_type t, const qreal *vals, ElemIndex n, char *dst);
+    static void encode(column_type t, const qint64 *vals, ElemIndex n, char *dst);
+
+private:
+    template<typename V> void appendValues(const V *vals, ElemIndex n);
+    void convert(column_type t);
+    void detach();
+
+private:
+    column_type colType;
+    ElemIndex numValues;
+    std::vector<char> storage;
+    const char *external;
+    ColumnRange colRange;
+};
+
+qreal DataColumn::at(ElemIndex i) const
+{
+    DISPATCH_COLUMN_TYPE(*this, return values<T>()[i]);
+    return 0;
+}
+
+void DataColumn::set(ElemIndex i, qreal val)
+{
+    if(external)
+        detach();
+    DISPATCH_COLUMN_TYPE(*this, ((T*)storage.data())[i] = (T)val);
+}
+
+#endif // DATACOLUMN_H
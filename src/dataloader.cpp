@@ -0,0 +1,109 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "dataloader.h"
+
+DataLoader::DataLoader(QString topoFile, QString dataFile, console *c, QObject *parent)
+    : QThread(parent),
+      topoFileName(topoFile),
+      dataFileName(dataFile),
+      con(c),
+      samplingMode(SAMPLING_NONE),
+      sampleSize(0),
+      dedup(false),
+      dataSet(NULL),
+      err(0)
+{
+}
+
+DataLoader::~DataLoader()
+{
+    wait();
+    delete dataSet;
+}
+
+DataObject *DataLoader::takeDataSet()
+{
+    DataObject *d = dataSet;
+    dataSet = NULL;
+    if(d)
+        d->setProgress(NULL);
+    return d;
+}
+
+void DataLoader::run()
+{
+    dataSet = new DataObject();
+    dataSet->setConsole(con);
+    dataSet->setProgress(&progress);
+    dataSet->setSampling(samplingMode,sampleSize);
+    dataSet->setDeduplicate(dedup,dedupIgnore);
+
+    progress.setStage(LOAD_TOPOLOGY);
+    err = dataSet->loadHardwareTopology(topoFileName);
+    if(err != 0)
+    {
+        err = -1;
+        errStr = "Error loading hardware: "+topoFileName;
+        return;
+    }
+
+    if(progress.cancelled())
+    {
+        err = LOAD_CANCELLED;
+        return;
+    }
+
+    err = dataSet->loadData(dataFileName);
+    if(err == LOAD_CANCELLED)
+        return;
+    if(err != 0)
+    {
+        err = -1;
+        errStr = "Error loading dataset: "+dataFileName;
+        return;
+    }
+
+    // Topology sample sets only touch the data set, so they are gathered
+    // here; the widgets are prepared on the GUI thread afterwards
+    progress.setStage(LOAD_VIEWS);
+    dataSet->visibilityChanged();
+
+    if(progress.cancelled())
+        err = LOAD_CANCELLED;
+}
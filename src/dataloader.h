@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef DATALOADER_H
+#define DATALOADER_H
+
+#include <QThread>
+#include <QString>
+
+#include "dataobject.h"
+#include "loadprogress.h"
+
+class console;
+
+// Loads the topology and samples of a data directory into a new
+// DataObject on its own thread. The GUI polls getProgress() and takes
+// the data set once finished() is emitted.
+class DataLoader : public QThread
+{
+    Q_OBJECT
+
+public:
+    DataLoader(QString topoFile, QString dataFile, console *c, QObject *parent = 0);
+    ~DataLoader();
+
+    void setSampling(sampling_mode mode, ElemIndex size) { samplingMode = mode; sampleSize = size; }
+    void setDeduplicate(bool on, QStringList ignore) { dedup = on; dedupIgnore = ignore; }
+
+    LoadProgress *getProgress() { return &progress; }
+    void cancel() { progress.cancel(); }
+
+    // 0 on success, LOAD_CANCELLED or -1 after finished()
+    int error() const { return err; }
+    QString errorString() const { return errStr; }
+
+    // Ownership passes to the caller, otherwise the partial data set is
+    // freed with the loader
+    DataObject *takeDataSet();
+
+protected:
+    void run();
+
+private:
+    QString topoFileName;
+    QString dataFileName;
+    console *con;
+
+    sampling_mode samplingMode;
+    ElemIndex sampleSize;
+    bool dedup;
+    QStringList dedupIgnore;
+
+    DataObject *dataSet;
+    LoadProgress progress;
+
+    int err;
+    QString errStr;
+};
+
+#endif // DATALOADER_H
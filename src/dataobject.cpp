@@ -38,13 +38,28 @@
 
 #include "dataobject.h"
 #include "parseUtil.h"
+#include "sampleparser.h"
+#include "cachefile.h"
+#include "samplestream.h"
+#include "perfreader.h"
+#include "reservoirsink.h"
+#include "dedupsink.h"
+#include "rangefilter.h"
 
 #include <iostream>
 #include <algorithm>
 #include <functional>
+#include <limits>
+#include <queue>
 
 #include <QFile>
-#include <QTextStream>
+#include <QFileInfo>
+#include <QDir>
+#include <QElapsedTimer>
+
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
 
 DataObject::DataObject()
 {
@@ -54,13 +69,37 @@ DataObject::DataObject()
     numVisible = 0;
 
     topo = NULL;
+    con = NULL;
+
+    parseThreads = 0;
+
+    useCache = true;
+    storageMode = STORAGE_AUTO;
+    mergeByTime = true;
+    samplingMode = SAMPLING_NONE;
+    sampleSize = 0;
+    dedup = false;
+    cache = NULL;
+    progress = NULL;
+    sourceBytes = 0;
+    dataSourceEncoding = DSE_INTEL_PEBS;
+    categoryIndexing = true;
+    sourceLineIndexed = 0;
 
     selMode = MODE_NEW;
     selGroup = 1;
+    selRestored = false;
+}
+
+DataObject::~DataObject()
+{
+    delete cache;
+    delete topo;
 }
 
 int DataObject::loadHardwareTopology(QString filename)
 {
+    delete topo;
     topo = new hwTopo();
     int err = topo->loadHardwareTopologyFromXML(filename);
     return err;
@@ -68,79 +107,364 @@ int DataObject::loadHardwareTopology(QString filename)
 
 int DataObject::loadData(QString filename)
 {
-    int err = parseCSVFile(filename);
+    // Columns may still be attached to the previous mapping
+    this->columns.clear();
+    dimSortedLists.clear();
+    delete cache;
+    cache = NULL;
+
+    categoryIndexing = true;
+
+    sampleFiles = findSampleFiles(filename);
+    if(sampleFiles.isEmpty())
+    {
+        std::cerr << "ERROR: no sample files in " << filename.toStdString() << std::endl;
+        return -1;
+    }
+
+    // Several files (e.g. one per rank) are parsed in memory as one data
+    // set, without a cache, and so are downsampled or deduplicated loads
+    if(sampleFiles.size() > 1 || samplingMode != SAMPLING_NONE || dedup)
+    {
+        sourceFileName.clear();
+        sourceBytes = 0;
+
+        int err = parseCSVFile(sampleFiles);
+        if(err)
+            return err;
+
+        calcStatistics();
+        if(cancelled())
+            return LOAD_CANCELLED;
+
+        constructSortedLists();
+        if(cancelled())
+            return LOAD_CANCELLED;
+
+        return 0;
+    }
+
+    filename = sampleFiles[0];
+    QString cacheFileName = filename + ".mxc";
+
+    sourceFileName = filename;
+    sourceBytes = 0;
+
+    bool stream = outOfCore(filename);
+    categoryIndexing = !stream;
+    if((useCache || stream) && readCacheFile(cacheFileName,filename) == 0)
+        return 0;
+
+    // Out of core, the cache is built without holding the columns in
+    // memory and then used in place
+    if(stream)
+    {
+        int err = streamCacheFile(cacheFileName,filename);
+        if(err)
+            return err;
+        return readCacheFile(cacheFileName,filename);
+    }
+
+    int err = parseCSVFile(sampleFiles);
     if(err)
         return err;
 
     calcStatistics();
+    if(cancelled())
+        return LOAD_CANCELLED;
+
     constructSortedLists();
+    if(cancelled())
+        return LOAD_CANCELLED;
+
+    // Not fatal, the next load just parses again
+    if(useCache && writeCacheFile(cacheFileName,filename) != 0)
+        std::cerr << "WARNING: could not write cache " << cacheFileName.toStdString() << std::endl;
+
+    return 0;
+}
+
+// The sample files named by path: the file itself, the sample files in a
+// directory, or the files matching a wildcard pattern, in name order
+QStringList DataObject::findSampleFiles(QString path)
+{
+    QFileInfo info(path);
+    QDir dir;
+    QStringList filters;
+
+    if(info.isDir())
+    {
+        dir = QDir(path);
+        filters << "*.out" << "*.out.gz" << "*.out.zst"
+                << "*.csv" << "*.csv.gz" << "*.csv.zst" << "*.data";
+    }
+    else if(path.contains('*') || path.contains('?') || path.contains('['))
+    {
+        dir = info.dir();
+        filters << info.fileName();
+    }
+    else
+    {
+        return QStringList(path);
+    }
+
+    QStringList files;
+    QStringList names = dir.entryList(filters,QDir::Files,QDir::Name);
+    for(int i=0; i<names.size(); i++)
+        files << dir.filePath(names[i]);
+
+    return files;
+}
+
+// Files larger than this fraction of physical memory are loaded out of core
+#define OUT_OF_CORE_MEMORY_FRACTION 0.5
+#define COMPRESSION_RATIO_ESTIMATE 10
+
+static qint64 physicalMemory()
+{
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGE_SIZE);
+    if(pages <= 0 || pageSize <= 0)
+        return 0;
+    return (qint64)pages * pageSize;
+}
+
+bool DataObject::outOfCore(QString dataFileName) const
+{
+    switch(storageMode)
+    {
+        case(STORAGE_IN_MEMORY): return false;
+        case(STORAGE_OUT_OF_CORE): return true;
+        case(STORAGE_AUTO): break;
+    }
+
+    qint64 mem = physicalMemory();
+    qint64 size = QFileInfo(dataFileName).size();
+    if(isCompressedSampleFile(dataFileName))
+        size *= COMPRESSION_RATIO_ESTIMATE;
+
+    return mem > 0 && size > mem*OUT_OF_CORE_MEMORY_FRACTION;
+}
+
+// The data source column may name its encoding, the column itself is
+// always "dataSource"
+static int headerColumns(QString dataFileName, const QStringList &header,
+                         QStringList &names, int &encoding)
+{
+    names = header;
+    encoding = DSE_INTEL_PEBS;
+    for(int d=0; d<names.size(); d++)
+    {
+        if(!isDataSourceColumn(names[d]))
+            continue;
 
+        encoding = findDataSourceEncoding(names[d]);
+        if(encoding == -1)
+        {
+            std::cerr << "ERROR: unknown data source encoding " << names[d].toStdString()
+                      << " in " << dataFileName.toStdString() << std::endl;
+            return -1;
+        }
+        names[d] = "dataSource";
+    }
     return 0;
 }
 
+int DataObject::followData(ElemIndex &firstNew)
+{
+    firstNew = this->numElements;
+
+    if(sourceFileName.isEmpty() || isCompressedSampleFile(sourceFileName) ||
+       isPerfDataFile(sourceFileName))
+        return -1;
+
+    // Out of core columns would all be copied into memory on append
+    if(cache && !(cache->header().flags & CACHE_HAS_SORTED_LISTS))
+        return -1;
+
+    QFile dataFile(sourceFileName);
+    if(!dataFile.open(QIODevice::ReadOnly))
+        return -1;
+
+    qint64 fileSize = dataFile.size();
+    if(fileSize < sourceBytes)
+    {
+        std::cerr << "ERROR: " << sourceFileName.toStdString() << " was truncated" << std::endl;
+        return -1;
+    }
+    if(fileSize == sourceBytes)
+        return 0;
+
+    // A load from the cache only has the columns after parsing, the
+    // parser needs those of the file
+    if(this->fileMeta.isEmpty())
+    {
+        QString line = QString::fromUtf8(dataFile.readLine()).trimmed();
+        QStringList names;
+        int encoding;
+        if(headerColumns(sourceFileName,line.split(','),names,encoding) ||
+           encoding != dataSourceEncoding || SampleParser::dimensions(names) != this->meta)
+            return -1;
+        this->fileMeta = names;
+    }
+
+    const char *data = (const char*)dataFile.map(sourceBytes,fileSize-sourceBytes);
+    if(data == NULL)
+        return -1;
+
+    // Whole lines only, the sampler may be midway through writing one
+    const char *end = data + (fileSize-sourceBytes);
+    while(end > data && end[-1] != '\n')
+        end--;
+
+    int err = 0;
+    if(end > data)
+    {
+        SampleParser parser(this->fileMeta,dataSourceEncoding);
+        ColumnSink sink(this->columns);
+        err = parser.parse(data,end,sink,varDict,sourceDict,parseThreads);
+        if(err)
+        {
+            std::cerr << "ERROR: element dimensions do not match metadata!" << std::endl;
+            std::cerr << "At element " << firstNew + parser.errorElement() << std::endl;
+            for(int d=0; d<this->columns.size(); d++)
+                this->columns[d].truncate(firstNew);
+        }
+        else
+        {
+            sourceBytes += end - data;
+            appendElements(firstNew);
+        }
+    }
+
+    dataFile.unmap((uchar*)data);
+    dataFile.close();
+
+    return err;
+}
+
+// Brings everything derived from the columns up to date with the
+// elements appended from first on, without revisiting the others
+void DataObject::appendElements(ElemIndex first)
+{
+    this->numElements = this->columns.empty() ? 0 : this->columns[0].size();
+
+    // New elements are visible and unselected
+    visibility.resize(this->numElements,VISIBLE);
+    selectionGroup.resize(this->numElements,0);
+    numVisible += this->numElements - first;
+
+    updateStatistics(first);
+    if(topo)
+        addTopoSamples(first,this->numElements);
+}
+
 void DataObject::allocate()
 {
     numDimensions = meta.size();
-    numElements = vals.size() / numDimensions;
+    numElements = columns.empty() ? 0 : columns[0].size();
 
-    begin = vals.begin();
-    end = vals.end();
+    visibility.assign(numElements,VISIBLE);
+    numVisible = numElements;
 
-    visibility.resize(numElements);
-    visibility.fill(VISIBLE);
+    selectionGroup.assign(numElements,0); // all belong to 0 (unselected)
 
-    selectionGroup.resize(numElements);
-    selectionGroup.fill(0); // all belong to 0 (unselected)
+    selectionSets.assign(2,ElemSet());
+    numSelected = 0;
+    selDelta = SelectionDelta();
+    selHistory.reset(selectionSets);
+    selRestored = false;
+
+    QMutexLocker lock(&categoryLock);
+    categoryIndexes.clear();
+    categoryIndexes.resize(numDimensions);
+    categoryIndexed.fill(0,numDimensions);
+    sourceLineIndex.clear();
+    sourceLineIndexed = 0;
+}
 
-    selectionSets.push_back(ElemSet());
-    selectionSets.push_back(ElemSet());
+bool DataObject::isCategorical(int dim) const
+{
+    return dim != -1 && (dim == variableDim || dim == sourceDim || dim == cpuDim ||
+                         dim == nodeDim || dim == dataSourceDim);
 }
 
-int DataObject::selected(ElemIndex index)
+int DataObject::selected(ElemIndex index) const
 {
-    return selectionGroup.at((int)index);
+    return selectionGroup[index];
 }
 
-bool DataObject::visible(ElemIndex index)
+bool DataObject::visible(ElemIndex index) const
 {
-    return visibility.at((int)index);
+    return visibility[index];
 }
 
-bool DataObject::selectionDefined()
+bool DataObject::selectionDefined() const
 {
     return numSelected > 0;
 }
 
+// Resolves group -1 to the current group and makes room for it
+int DataObject::groupIndex(int group)
+{
+    if(group < 0)
+        group = selGroup;
+    group = std::min(std::max(group,1),MAX_SELECTION_GROUPS);
+
+    if(group >= (int)selectionSets.size())
+        selectionSets.resize(group+1);
+    return group;
+}
+
+void DataObject::setCurrentGroup(int group)
+{
+    selGroup = groupIndex(group);
+}
+
+// An element is in at most one group, selecting it moves it
 void DataObject::selectData(ElemIndex index, int group)
 {
-    if(visible(index))
-    {
-        selectionGroup[index] = group;
-        selectionSets.at(group).insert(index);
+    if(!visible(index))
+        return;
+
+    group = groupIndex(group);
+    int old = selectionGroup[index];
+    if(old == group)
+        return;
+
+    if(old)
+        selectionSets.at(old).remove(index);
+    else
         numSelected++;
-    }
+
+    selectionGroup[index] = group;
+    selectionSets.at(group).insert(index);
+    selDelta.full = true;
 }
 
 void DataObject::selectAll(int group)
 {
-    selectionGroup.fill(group);
+    group = groupIndex(group);
 
-    for(ElemIndex i=0; i<numElements; i++)
-    {
-        selectionSets.at(group).insert(i);
-    }
+    std::fill(selectionGroup.begin(),selectionGroup.end(),group);
+
+    for(unsigned int g=0; g<selectionSets.size(); g++)
+        selectionSets.at(g).clear();
+    selectionSets.at(group).insertRange(0,numElements);
 
     numSelected = numElements;
+    selDelta.full = true;
 }
 
 void DataObject::deselectAll()
 {
-    selectionGroup.fill(0);
+    std::fill(selectionGroup.begin(),selectionGroup.end(),0);
 
     for(unsigned int i=0; i<selectionSets.size(); i++)
         selectionSets.at(i).clear();
 
     numSelected = 0;
+    selDelta.full = true;
 }
 
 void DataObject::selectAllVisible(int group)
@@ -153,7 +477,7 @@ void DataObject::selectAllVisible(int group)
     }
 }
 
-void DataObject::showData(unsigned int index)
+void DataObject::showData(ElemIndex index)
 {
     if(!visible(index))
     {
@@ -162,7 +486,7 @@ void DataObject::showData(unsigned int index)
     }
 }
 
-void DataObject::hideData(unsigned int index)
+void DataObject::hideData(ElemIndex index)
 {
     if(visible(index))
     {
@@ -173,142 +497,192 @@ void DataObject::hideData(unsigned int index)
 
 void DataObject::showAll()
 {
-    visibility.fill(VISIBLE);
+    std::fill(visibility.begin(),visibility.end(),VISIBLE);
     numVisible = numElements;
 }
 
 void DataObject::hideAll()
 {
-    visibility.fill(INVISIBLE);
+    std::fill(visibility.begin(),visibility.end(),INVISIBLE);
     numVisible = 0;
 }
 
 void DataObject::selectBySourceFileName(QString str, int group)
 {
-    ElemSet selSet;
-    ElemIndex elem;
-    QVector<qreal>::Iterator p;
-    for(elem=0, p=this->begin; p!=this->end; elem++, p+=this->numDimensions)
-    {
-        if(fileNames[elem] == str)
-            selSet.insert(elem);
-    }
-    selectSet(selSet, group);
+    selectByCategory(sourceDim,sourceDict.find(str),group);
 }
 
-struct indexedValueLtFunctor
+void DataObject::selectBySourceLine(QString str, int line, int group)
 {
-    indexedValueLtFunctor(const struct indexedValue _it) : it(_it) {}
+    int id = sourceDict.find(str);
+    if(id == -1 || sourceDim == -1 || lineDim == -1)
+    {
+        selectSet(ElemSet(),group);
+        return;
+    }
 
-    struct indexedValue it;
+    if(!categoryIndexing)
+    {
+        ElemSet selSet, lineSet;
+        columnRangeScan(column(sourceDim),id,id,selSet);
+        columnRangeScan(column(lineDim),line,line,lineSet);
+        selectSet(selSet.intersect(lineSet),group);
+        return;
+    }
 
-    bool operator()(const struct indexedValue &other)
+    QMutexLocker lock(&categoryLock);
+    if(sourceLineIndexed < numElements)
     {
-        return it.val < other.val;
+        sourceLineIndex.add(column(sourceDim),column(lineDim),sourceLineIndexed,numElements);
+        sourceLineIndexed = numElements;
     }
-};
+    const ElemSet *s = sourceLineIndex.find(CategoryIndex::pairKey(id,line));
+    ElemSet selSet = s ? *s : ElemSet();
+    lock.unlock();
 
-void DataObject::selectByDimRange(int dim, qreal vmin, qreal vmax, int group)
+    selectSet(selSet,group);
+}
+
+// Selects the elements of dim equal to val, from the category index when
+// dim has one
+void DataObject::selectByCategory(int dim, qreal val, int group)
 {
+    if(dim < 0 || dim >= (int)numDimensions)
+    {
+        selectSet(ElemSet(),group);
+        return;
+    }
+
+    if(hasCategoryIndex(dim))
+    {
+        const ElemSet *s = categorySet(dim,val);
+        selectSet(s ? *s : ElemSet(),group);
+        return;
+    }
+
     ElemSet selSet;
-    std::vector<indexedValue>::iterator itMin;
-    std::vector<indexedValue>::iterator itMax;
+    columnRangeScan(column(dim),val,val,selSet);
+    selectSet(selSet,group);
+}
+
+bool DataObject::hasCategoryIndex(int dim) const
+{
+    return categoryIndexing && dim < (int)categoryIndexes.size() && isCategorical(dim);
+}
 
-    struct indexedValue ivMinQuery;
-    ivMinQuery.val = vmin;
+// The elements of dim equal to val, NULL if there are none or dim is not
+// categorical
+const ElemSet *DataObject::categorySet(int dim, qreal val) const
+{
+    if(!hasCategoryIndex(dim))
+        return NULL;
 
-    struct indexedValue ivMaxQuery;
-    ivMaxQuery.val = vmax;
+    // Keys are whole numbers, which no fraction or out of range value
+    // (or NaN) can be
+    if(val != floor(val) || val < -CATEGORY_KEY_LIMIT || val >= CATEGORY_KEY_LIMIT)
+        return NULL;
 
-    if(ivMinQuery.val <= this->minimumValues[dim])
+    QMutexLocker lock(&categoryLock);
+    if(categoryIndexed[dim] < numElements)
     {
-        itMin = dimSortedLists.at(dim).begin();
+        categoryIndexes[dim].add(column(dim),categoryIndexed[dim],numElements);
+        categoryIndexed[dim] = numElements;
     }
-    else
+    return categoryIndexes[dim].find(CategoryIndex::key(val));
+}
+
+// Position of the first element in dim's sorted order with a value above val
+ElemIndex DataObject::sortedPosAbove(int dim, qreal val) const
+{
+    const DataColumn &order = *sortedList(dim);
+    const DataColumn &vals = column(dim);
+
+    ElemIndex lo = 0;
+    ElemIndex hi = numElements;
+    while(lo < hi)
     {
-        itMin = std::find_if(dimSortedLists.at(dim).begin(),
-                             dimSortedLists.at(dim).end(),
-                             indexedValueLtFunctor(ivMinQuery));
+        ElemIndex mid = lo + (hi - lo) / 2;
+        if(val < vals.at((ElemIndex)order.at(mid)))
+            hi = mid;
+        else
+            lo = mid + 1;
     }
+    return lo;
+}
 
-    if(ivMaxQuery.val >= this->maximumValues[dim])
+// Adds the elements of dim in (vmin,vmax] to selSet, from the sorted
+// lists when there are any and by scanning the column otherwise
+void DataObject::selectRange(int dim, qreal vmin, qreal vmax, ElemSet &selSet) const
+{
+    if(dimSortedLists.empty())
     {
-        itMax = dimSortedLists.at(dim).end();
+        if(vmin <= this->minimumValues[dim])
+            vmin = -std::numeric_limits<qreal>::infinity();
+        columnIntervalScan(column(dim),vmin,vmax,selSet);
+        return;
     }
+
+    ElemIndex posMin;
+    ElemIndex posMax;
+
+    if(vmin <= this->minimumValues[dim])
+        posMin = 0;
+    else
+        posMin = sortedPosAbove(dim,vmin);
+
+    if(vmax >= this->maximumValues[dim])
+        posMax = numElements;
     else
+        posMax = sortedPosAbove(dim,vmax);
+
+    if(posMin >= posMax)
+        return;
+
+    if(posMax - posMin == numElements)
     {
-        itMax = std::find_if(dimSortedLists.at(dim).begin(),
-                             dimSortedLists.at(dim).end(),
-                             indexedValueLtFunctor(ivMaxQuery));
+        selSet.insertRange(0,numElements);
+        return;
     }
 
-    for(/*itMin*/; itMin != itMax; itMin++)
+    // The hits come out in value order, so wide ranges are marked in a
+    // flat bitmap first rather than inserted one by one
+    const DataColumn &order = *sortedList(dim);
+    if(posMax - posMin < numElements / 64)
     {
-        selSet.insert(itMin->idx);
+        for(ElemIndex pos=posMin; pos<posMax; pos++)
+            selSet.insert((ElemIndex)order.at(pos));
+        return;
     }
 
+    QVector<quint64> words((numElements + 63) / 64,0);
+    columnMarkElements(order,posMin,posMax,words.data());
+    selSet.insertWords(words.constData(),words.size());
+}
+
+void DataObject::selectByDimRange(int dim, qreal vmin, qreal vmax, int group)
+{
+    ElemSet selSet;
+    selectRange(dim,vmin,vmax,selSet);
     selectSet(selSet,group);
 }
 
+// Selects the elements inside every one of the ranges
 void DataObject::selectByMultiDimRange(QVector<int> dims, QVector<qreal> mins, QVector<qreal> maxes, int group)
 {
-    ElemSet selSet;
+    RangeFilter filter(this);
     for(int d=0; d<dims.size(); d++)
     {
-        int dim = dims[d];
-        std::vector<indexedValue>::iterator itMin;
-        std::vector<indexedValue>::iterator itMax;
-
-        struct indexedValue ivMinQuery;
-        ivMinQuery.val = mins[d];
-
-        struct indexedValue ivMaxQuery;
-        ivMaxQuery.val = maxes[d];
-
-        if(ivMinQuery.val <= this->minimumValues[dim])
-        {
-            itMin = dimSortedLists.at(dim).begin();
-        }
-        else
-        {
-            itMin = std::find_if(dimSortedLists.at(dim).begin(),
-                                 dimSortedLists.at(dim).end(),
-                                 indexedValueLtFunctor(ivMinQuery));
-        }
-
-        if(ivMaxQuery.val >= this->maximumValues[dim])
-        {
-            itMax = dimSortedLists.at(dim).end();
-        }
-        else
-        {
-            itMax = std::find_if(dimSortedLists.at(dim).begin(),
-                                 dimSortedLists.at(dim).end(),
-                                 indexedValueLtFunctor(ivMaxQuery));
-        }
-
-        for(/*itMin*/; itMin != itMax; itMin++)
-        {
-            selSet.insert(itMin->idx);
-        }
+        filter.addRange(dims[d],mins[d],maxes[d]);
     }
 
+    ElemSet selSet;
+    filter.evaluate(selSet);
     selectSet(selSet,group);
 }
 
 void DataObject::selectByVarName(QString str, int group)
 {
-    ElemSet selSet;
-
-    ElemIndex elem;
-    QVector<qreal>::Iterator p;
-    for(elem=0, p=this->begin; p!=this->end; elem++, p+=this->numDimensions)
-    {
-        if(varNames[elem] == str)
-            selSet.insert(elem);
-    }
-
-    selectSet(selSet,group);
+    selectByCategory(variableDim,varDict.find(str),group);
 }
 
 void DataObject::selectByResource(hwNode *node, int group)
@@ -336,32 +710,27 @@ void DataObject::hideUnselected()
     }
 }
 
-void DataObject::selectSet(ElemSet &s, int group)
+// Makes the group's elements those of s, combined with the group's current
+// elements by the selection mode. Other groups keep theirs, except for the
+// elements that move to this group.
+void DataObject::selectSet(const ElemSet &s, int group)
 {
-    ElemSet *newSel = NULL;
+    group = groupIndex(group);
+
+    ElemSet newSel;
     if(selMode == MODE_NEW)
     {
-        newSel = &s;
+        newSel = s;
     }
     else if(selMode == MODE_APPEND)
     {
-        newSel = new ElemSet();
-        std::set_union(selectionSets.at(group).begin(),
-                       selectionSets.at(group).end(),
-                       s.begin(),
-                       s.end(),
-                       std::inserter(*newSel,
-                                     newSel->begin()));
+        newSel = selectionSets.at(group);
+        newSel.unite(s);
     }
     else if(selMode == MODE_FILTER)
     {
-        newSel = new ElemSet();
-        std::set_intersection(selectionSets.at(group).begin(),
-                              selectionSets.at(group).end(),
-                              s.begin(),
-                              s.end(),
-                              std::inserter(*newSel,
-                                            newSel->begin()));
+        newSel = selectionSets.at(group);
+        newSel.intersect(s);
     }
     else
     {
@@ -369,20 +738,109 @@ void DataObject::selectSet(ElemSet &s, int group)
         return;
     }
 
-    // Reprocess groups
-    selectionSets.at(group).clear();
-    selectionGroup.fill(0);
+    // Hidden elements are never selected
+    if(numVisible != numElements)
+    {
+        ElemSet visibleSel;
+        for(ElemSet::const_iterator it = newSel.begin(); it != newSel.end(); it++)
+        {
+            if(visible(*it))
+                visibleSel.insert(*it);
+        }
+        newSel = visibleSel;
+    }
+
+    // Only the elements that change group are touched
+    ElemSet &groupSet = selectionSets.at(group);
+    bool wasDefined = selectionDefined();
+
+    ElemSet removed = groupSet;
+    removed.subtract(newSel);
+    ElemSet added = newSel;
+    added.subtract(groupSet);
+
+    std::vector<ElemSet> changed(selectionSets.size());
+
+    for(ElemSet::const_iterator it = removed.begin(); it != removed.end(); it++)
+        selectionGroup[*it] = 0;
+    groupSet.subtract(removed);
+    numSelected -= removed.size();
+    changed[group] = removed;
+
+    for(ElemSet::const_iterator it = added.begin(); it != added.end(); it++)
+    {
+        changed[selectionGroup[*it]].insert(*it);
+        selectionGroup[*it] = group;
+    }
+    for(unsigned int g=1; g<selectionSets.size(); g++)
+    {
+        if((int)g == group || changed[g].empty())
+            continue;
+        selectionSets.at(g).subtract(changed[g]);
+        numSelected -= changed[g].size();
+    }
+    groupSet.unite(added);
+    numSelected += added.size();
+
+    // Whether a selection is defined changes what every element counts for
+    if(wasDefined != selectionDefined())
+        selDelta.full = true;
+    mergeSelectionDelta(changed);
+}
+
+bool SelectionDelta::empty() const
+{
+    for(unsigned int g=0; g<changed.size(); g++)
+    {
+        if(!changed[g].empty())
+            return false;
+    }
+    return true;
+}
+
+void DataObject::clearSelectionDelta()
+{
+    selDelta.full = false;
+    selDelta.changed.clear();
+}
+
+// Adds changed, by old group, to the pending delta. Elements already in it
+// keep the group they had when it was cleared.
+void DataObject::mergeSelectionDelta(std::vector<ElemSet> &changed)
+{
+    if(selDelta.full)
+        return;
+
+    ElemSet pending;
+    for(unsigned int g=0; g<selDelta.changed.size(); g++)
+        pending.unite(selDelta.changed[g]);
+
+    if(selDelta.changed.size() < changed.size())
+        selDelta.changed.resize(changed.size());
 
-    for(ElemSet::iterator it = newSel->begin();
-        it != newSel->end();
-        it++)
+    for(unsigned int g=0; g<changed.size(); g++)
     {
-        selectData(*it,group);
+        changed[g].subtract(pending);
+        selDelta.changed[g].unite(changed[g]);
     }
 }
 
+// Brings what is derived from the selection up to date with its changes
+void DataObject::selectionChanged()
+{
+    recordSelection();
+
+    if(selDelta.full)
+        collectTopoSamples();
+    else
+        updateTopoSamples(selDelta);
+}
+
 void DataObject::collectTopoSamples()
 {
+    if(!topo)
+        return;
+
     // Reset info
     for(int i=0; i<topo->allHardwareResourceNodes.size(); i++)
     {
@@ -390,32 +848,57 @@ void DataObject::collectTopoSamples()
         topo->allHardwareResourceNodes[i]->sampleSets[this].selCycles = 0;
         topo->allHardwareResourceNodes[i]->sampleSets[this].totSamples.clear();
         topo->allHardwareResourceNodes[i]->sampleSets[this].selSamples.clear();
+        topo->allHardwareResourceNodes[i]->sampleSets[this].groupCycles.clear();
+        topo->allHardwareResourceNodes[i]->sampleSets[this].groupSamples.clear();
         topo->allHardwareResourceNodes[i]->transactions = 0;
     }
 
+    addTopoSamples(0,numElements);
+}
+
+static void addTopoSample(SampleSet &set, ElemIndex elem, qint64 cycles, int group, bool sel)
+{
+    set.totSamples.insert(elem);
+    set.totCycles += cycles;
+
+    if(sel)
+    {
+        set.selSamples.insert(elem);
+        set.selCycles += cycles;
+    }
+
+    if(group >= set.groupCycles.size())
+    {
+        set.groupCycles.resize(group+1);
+        set.groupSamples.resize(group+1);
+    }
+    set.groupCycles[group] += cycles;
+    set.groupSamples[group]++;
+}
+
+// Adds the elements [first,last) to the sample sets of their topo nodes
+void DataObject::addTopoSamples(ElemIndex first, ElemIndex last)
+{
     // Go through each sample and add it to the right topo node
-    ElemIndex elem;
-    QVector<qreal>::Iterator p;
-    for(elem=0, p=this->begin; p!=this->end; elem++, p+=this->numDimensions)
+    const DataColumn &dataSources = column(dataSourceDim);
+    const DataColumn &cpus = column(cpuDim);
+    const DataColumn &latencies = column(latencyDim);
+
+    for(ElemIndex elem=first; elem<last; elem++)
     {
         // Get vars
-        int dse = *(p+dataSourceDim);
-        int cpu = *(p+cpuDim);
-        int cycles = *(p+latencyDim);
+        int dse = dataSources.at(elem);
+        int cpu = cpus.at(elem);
+        qint64 cycles = latencies.at(elem) * weight(elem) + 0.5;
+        int group = selected(elem);
+        bool sel = !selectionDefined() || group;
 
         // Search for nodes
         hwNode *cpuNode = topo->CPUIDMap[cpu];
         hwNode *node = cpuNode;
 
         // Update data for serving resource
-        node->sampleSets[this].totSamples.insert(elem);
-        node->sampleSets[this].totCycles += cycles;
-
-        if(!selectionDefined() || selected(elem))
-        {
-            node->sampleSets[this].selSamples.insert(elem);
-            node->sampleSets[this].selCycles += cycles;
-        }
+        addTopoSample(node->sampleSets[this],elem,cycles,group,sel);
 
         if(dse == -1)
             continue;
@@ -423,46 +906,186 @@ void DataObject::collectTopoSamples()
         // Go up to data source
         for( /*init*/; dse>0 && node->parent; dse--, node=node->parent)
         {
-            if(!selectionDefined() || selected(elem))
+            if(sel)
             {
                 node->transactions++;
             }
         }
 
         // Update data for core
-        node->sampleSets[this].totSamples.insert(elem);
-        node->sampleSets[this].totCycles += cycles;
+        addTopoSample(node->sampleSets[this],elem,cycles,group,sel);
+    }
+}
 
-        if(!selectionDefined() || selected(elem))
+static void moveTopoSample(SampleSet &set, ElemIndex elem, qint64 cycles, int oldGroup, int newGroup)
+{
+    if(oldGroup && !newGroup)
+    {
+        set.selSamples.remove(elem);
+        set.selCycles -= cycles;
+    }
+    else if(!oldGroup && newGroup)
+    {
+        set.selSamples.insert(elem);
+        set.selCycles += cycles;
+    }
+
+    if(newGroup >= set.groupCycles.size())
+    {
+        set.groupCycles.resize(newGroup+1);
+        set.groupSamples.resize(newGroup+1);
+    }
+    set.groupCycles[oldGroup] -= cycles;
+    set.groupSamples[oldGroup]--;
+    set.groupCycles[newGroup] += cycles;
+    set.groupSamples[newGroup]++;
+}
+
+// Moves the elements of the delta between the selected and per-group
+// totals of their topo nodes. Only for deltas that leave selectionDefined()
+// as it was, which are not full.
+void DataObject::updateTopoSamples(const SelectionDelta &delta)
+{
+    if(!topo)
+        return;
+
+    const DataColumn &dataSources = column(dataSourceDim);
+    const DataColumn &cpus = column(cpuDim);
+    const DataColumn &latencies = column(latencyDim);
+
+    for(unsigned int oldGroup=0; oldGroup<delta.changed.size(); oldGroup++)
+    {
+        const ElemSet &elems = delta.changed[oldGroup];
+        for(ElemSet::const_iterator it = elems.begin(); it != elems.end(); it++)
         {
-            node->sampleSets[this].selSamples.insert(elem);
-            node->sampleSets[this].selCycles += cycles;
+            ElemIndex elem = *it;
+            int newGroup = selected(elem);
+            if(newGroup == (int)oldGroup)
+                continue;
+
+            int dse = dataSources.at(elem);
+            qint64 cycles = latencies.at(elem) * weight(elem) + 0.5;
+
+            hwNode *node = topo->CPUIDMap[cpus.at(elem)];
+            moveTopoSample(node->sampleSets[this],elem,cycles,oldGroup,newGroup);
+
+            if(dse == -1)
+                continue;
+
+            int transDelta = (newGroup != 0) - (oldGroup != 0);
+            for( /*init*/; dse>0 && node->parent; dse--, node=node->parent)
+                node->transactions += transDelta;
+
+            moveTopoSample(node->sampleSets[this],elem,cycles,oldGroup,newGroup);
         }
     }
 }
 
-int DataObject::parseCSVFile(QString dataFileName)
+// Adds the changes since the last step to the history
+void DataObject::recordSelection()
 {
-    // Open the file
-    QFile dataFile(dataFileName);
+    if(selRestored)
+    {
+        selRestored = false;
+        return;
+    }
 
-    if (!dataFile.open(QIODevice::ReadOnly | QIODevice::Text))
-        return -1;
+    SelectionStep step;
+    const GroupSets *last = selHistory.snapshot();
+    if(selDelta.full && last)
+    {
+        SelectionStep::diff(*last,selectionSets,step);
+    }
+    else if(!selDelta.full)
+    {
+        step.before = selDelta.changed;
+        step.after.resize(selectionSets.size());
+        for(unsigned int g=0; g<step.before.size(); g++)
+        {
+            const ElemSet &elems = step.before[g];
+            for(ElemSet::const_iterator it = elems.begin(); it != elems.end(); it++)
+                step.after[selected(*it)].insert(*it);
+        }
+    }
 
-    // Create text stream
-    QTextStream dataStream(&dataFile);
-    QString line;
-    QStringList lineValues;
-    qint64 elemid = 0;
+    if(!step.empty())
+        selHistory.record(step,selectionSets);
+}
 
-    // Get metadata from first line
-    line = dataStream.readLine();
-    this->meta = line.split(',');
-    this->numDimensions = this->meta.size();
+// Moves the elements of from (by their current group) to their group in to,
+// and the views along through the selection delta
+void DataObject::restoreSelection(const GroupSets &from, const GroupSets &to)
+{
+    bool wasDefined = selectionDefined();
+
+    if(selectionSets.size() < to.size())
+        selectionSets.resize(to.size());
+
+    for(unsigned int g=0; g<to.size(); g++)
+    {
+        for(ElemSet::const_iterator it = to[g].begin(); it != to[g].end(); it++)
+            selectionGroup[*it] = g;
+    }
+
+    const GroupSets *state = selHistory.snapshot();
+    if(state)
+    {
+        for(unsigned int g=0; g<selectionSets.size(); g++)
+            selectionSets[g] = (g < state->size()) ? state->at(g) : ElemSet();
+    }
+    else
+    {
+        for(unsigned int g=1; g<selectionSets.size(); g++)
+        {
+            if(g < from.size())
+                selectionSets[g].subtract(from[g]);
+            if(g < to.size())
+                selectionSets[g].unite(to[g]);
+        }
+    }
+
+    numSelected = 0;
+    for(unsigned int g=1; g<selectionSets.size(); g++)
+        numSelected += selectionSets[g].size();
+
+    if(wasDefined != selectionDefined())
+        selDelta.full = true;
+
+    GroupSets changed = from;
+    mergeSelectionDelta(changed);
+
+    selHistory.setSnapshot(selectionSets);
+    selRestored = true;
+}
 
+bool DataObject::undoSelection()
+{
+    if(!selHistory.canUndo())
+        return false;
+
+    const SelectionStep &step = selHistory.undo();
+    restoreSelection(step.after,step.before);
+    return true;
+}
+
+bool DataObject::redoSelection()
+{
+    if(!selHistory.canRedo())
+        return false;
+
+    const SelectionStep &step = selHistory.redo();
+    restoreSelection(step.before,step.after);
+    return true;
+}
+
+void DataObject::findDimensions()
+{
     sourceDim = this->meta.indexOf("source");
+
     lineDim = this->meta.indexOf("line");
     variableDim = this->meta.indexOf("variable");
+    timeDim = this->meta.indexOf("time");
+    rankDim = this->meta.indexOf("rank");
     dataSourceDim = this->meta.indexOf("dataSource");
     indexDim = this->meta.indexOf("index");
     latencyDim = this->meta.indexOf("latency");
@@ -471,62 +1094,757 @@ int DataObject::parseCSVFile(QString dataFileName)
     xDim = this->meta.indexOf("xidx");
     yDim = this->meta.indexOf("yidx");
     zDim = this->meta.indexOf("zidx");
+    weightDim = this->meta.indexOf("weight");
+
+}
+
+int DataObject::readSamples(QString dataFileName, SampleSink &sink, qint64 &bytesRead)
+{
+    return readSamples(QStringList(dataFileName),sink,bytesRead);
+}
+
+// Sets the metadata from the header line at p, or checks that it matches
+// the metadata of the files before, and moves p past it
+int DataObject::readHeader(QString dataFileName, const char *&p, const char *end)
+{
+    const char *eol = findLineEnd(p,end);
+    QStringList header = QString::fromUtf8(p,trimCR(p,eol)-p).split(',');
+    p = nextLine(eol,end);
+
+    return setMeta(dataFileName,header);
+}
+
+int DataObject::setMeta(QString dataFileName, const QStringList &header)
+{
+    QStringList names;
+    int encoding;
+    if(headerColumns(dataFileName,header,names,encoding))
+        return -1;
+
+    // Parsing adds the flags of the data source as columns
+    if(this->meta.isEmpty())
+    {
+        this->fileMeta = names;
+        this->meta = SampleParser::dimensions(names);
+        this->dataSourceEncoding = encoding;
+        this->numDimensions = this->meta.size();
+        findDimensions();
+        return 0;
+    }
 
+    if(names != this->fileMeta || encoding != this->dataSourceEncoding)
+    {
+        std::cerr << "ERROR: header of " << dataFileName.toStdString()
+                  << " does not match the other sample files" << std::endl;
+        return -1;
+    }
 
-    QVector<QString> varVec;
-    QVector<QString> sourceVec;
+    return 0;
+}
+
+// Parses the regions of mapped files in one go and counts the elements
+// of each file
+static int parseRegions(SampleParser *parser, QVector<SampleRegion> &regions, QVector<int> &regionFiles,
+                        SampleSink &sink, StringDict &varDict, StringDict &sourceDict, int threads,
+                        QVector<ElemIndex> *fileElements)
+{
+    if(regions.isEmpty())
+        return 0;
 
-    // Get data
-    while(!dataStream.atEnd())
+    int err = parser->parse(regions,sink,varDict,sourceDict,threads);
+    if(err == LOAD_CANCELLED)
+        return err;
+    if(err)
     {
-        line = dataStream.readLine();
-        lineValues = line.split(',');
+        std::cerr << "ERROR: element dimensions do not match metadata!" << std::endl;
+        std::cerr << "At element " << parser->errorElement() << std::endl;
+        return err;
+    }
+
+    for(int r=0; fileElements && r<regions.size(); r++)
+        (*fileElements)[regionFiles[r]] = parser->parsedElements(r);
 
-        if(lineValues.size() != this->numDimensions)
+    regions.clear();
+    regionFiles.clear();
+    return 0;
+}
+
+// Header and samples of plain (mapped), compressed (streamed) or perf.data
+// files, which must all have the same header. Elements come in file order and
+// fileElements, if given, receives the count from each file. Dictionary
+// IDs are shared by all files as they are parsed.
+int DataObject::readSamples(QStringList dataFileNames, SampleSink &sink, qint64 &bytesRead,
+                            QVector<ElemIndex> *fileElements)
+{
+    bytesRead = 0;
+    varDict.clear();
+    sourceDict.clear();
+    this->meta.clear();
+
+    if(fileElements)
+        fileElements->fill(0,dataFileNames.size());
+
+    // Progress is in input bytes, which are unknown when decompressing
+    qint64 totalBytes = 0;
+    for(int f=0; f<dataFileNames.size(); f++)
+    {
+        if(isCompressedSampleFile(dataFileNames[f]))
         {
-            std::cerr << "ERROR: element dimensions do not match metadata!" << std::endl;
-            std::cerr << "At element " << elemid << std::endl;
-            return -1;
+            totalBytes = 0;
+            break;
+        }
+        totalBytes += QFileInfo(dataFileNames[f]).size();
+    }
+
+    if(progress)
+        progress->setStage(LOAD_PARSE,totalBytes);
+
+    // Consecutive plain files are mapped and parsed together
+    QVector<QFile*> mapped;
+    QVector<SampleRegion> regions;
+    QVector<int> regionFiles;
+
+    SampleParser *parser = NULL;
+    int err = 0;
+
+    for(int f=0; !err && f<dataFileNames.size(); f++)
+    {
+        QString dataFileName = dataFileNames[f];
+
+        if(isPerfDataFile(dataFileName))
+        {
+            if(parser)
+                err = parseRegions(parser,regions,regionFiles,sink,varDict,sourceDict,parseThreads,fileElements);
+            if(err)
+                break;
+
+            // Sampled records are decoded in place, there is no text to parse
+            PerfReader reader;
+            err = reader.open(dataFileName);
+            if(!err)
+                err = setMeta(dataFileName,reader.dimensions());
+            if(err)
+                break;
+
+            err = reader.read(sink,varDict,sourceDict,progress);
+            if(fileElements)
+                (*fileElements)[f] = reader.samplesRead();
+            bytesRead += reader.size();
+            continue;
         }
 
-        // Process individual dimensions differently
-        for(int i=0; i<lineValues.size(); i++)
+        if(!isCompressedSampleFile(dataFileName))
         {
-            QString tok = lineValues[i];
-            if(i==variableDim)
+            // Open and map the file, tokens are parsed in place from the mapping
+            QFile *dataFile = new QFile(dataFileName);
+            mapped.push_back(dataFile);
+
+            if (!dataFile->open(QIODevice::ReadOnly))
             {
-                ElemIndex uid = createUniqueID(varVec,tok);
-                this->vals.push_back(uid);
-                varNames.push_back(tok);
+                err = -1;
+                break;
             }
-            else if(i==sourceDim)
+
+            qint64 fileSize = dataFile->size();
+            const char *data = fileSize > 0 ? (const char*)dataFile->map(0,fileSize) : NULL;
+            if(data == NULL)
             {
-                ElemIndex uid = createUniqueID(sourceVec,tok);
-                this->vals.push_back(uid);
-                fileNames.push_back(tok);
+                err = -1;
+                break;
             }
-            else if(i==dataSourceDim)
+
+            const char *begin = data;
+            err = readHeader(dataFileName,begin,data + fileSize);
+            if(err)
+                break;
+
+            if(parser == NULL)
             {
-                int dseVal = tok.toInt(NULL,16);
-                this->vals.push_back(dseDepth(dseVal));
+                parser = new SampleParser(this->fileMeta,dataSourceEncoding);
+                parser->setProgress(progress);
             }
-            else
+
+            SampleRegion region;
+            region.begin = begin;
+            region.end = data + fileSize;
+            regions.push_back(region);
+            regionFiles.push_back(f);
+
+            bytesRead += fileSize;
+            continue;
+        }
+
+        if(parser)
+            err = parseRegions(parser,regions,regionFiles,sink,varDict,sourceDict,parseThreads,fileElements);
+        if(err)
+            break;
+
+        SampleStream *stream = openSampleStream(dataFileName);
+        if(stream == NULL)
+        {
+            err = -1;
+            break;
+        }
+
+        BlockReader reader(stream);
+        const char *begin, *end;
+        if(!reader.next(begin,end))
+        {
+            err = -1;
+            break;
+        }
+
+        err = readHeader(dataFileName,begin,end);
+        if(err)
+            break;
+
+        if(parser == NULL)
+        {
+            parser = new SampleParser(this->fileMeta,dataSourceEncoding);
+            parser->setProgress(progress);
+        }
+
+        qint64 firstElem = parser->parsedElements();
+        do
+        {
+            err = parser->parse(begin,end,sink,varDict,sourceDict,parseThreads);
+            if(err == LOAD_CANCELLED)
+                break;
+            if(err)
             {
-                this->vals.push_back(tok.toLongLong());
+                std::cerr << "ERROR: element dimensions do not match metadata!" << std::endl;
+                std::cerr << "At element " << parser->errorElement() << std::endl;
+                break;
             }
+        } while(reader.next(begin,end));
+
+        if(fileElements)
+            (*fileElements)[f] = parser->parsedElements() - firstElem;
+
+        bytesRead += reader.bytesRead();
+        if(!err && reader.failed())
+        {
+            std::cerr << "ERROR: could not decompress " << dataFileName.toStdString() << std::endl;
+            err = -1;
         }
+    }
 
-        elemid++;
+    if(!err && parser)
+        err = parseRegions(parser,regions,regionFiles,sink,varDict,sourceDict,parseThreads,fileElements);
+
+    // Closing a file also unmaps it
+    for(int f=0; f<mapped.size(); f++)
+        delete mapped[f];
+    delete parser;
+
+    return err;
+}
+
+int DataObject::parseCSVFile(QStringList dataFileNames)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    this->columns.clear();
+
+    qint64 fileSize = 0;
+    QVector<ElemIndex> fileElements;
+    ElemIndex numSeen = 0;
+    int err;
+
+    // Rows of a single file can be deduplicated as they are parsed,
+    // otherwise that waits for the final rows below
+    bool streamDedup = dedup && samplingMode == SAMPLING_NONE && dataFileNames.size() == 1;
+
+    if(streamDedup)
+    {
+        DedupSink sink(this->meta,dedupIgnore,parseThreads);
+        err = readSamples(dataFileNames,sink,fileSize,&fileElements);
+        if(err)
+            return err;
+
+        sink.finish(this->columns);
+        numSeen = sink.seen();
+        this->meta = sink.dimensions();
+        this->numDimensions = this->meta.size();
+        findDimensions();
+    }
+    else if(samplingMode == SAMPLING_NONE)
+    {
+        ColumnSink sink(this->columns);
+        err = readSamples(dataFileNames,sink,fileSize,&fileElements);
+        if(err)
+            return err;
+    }
+    else
+    {
+        QStringList strata;
+        if(samplingMode == SAMPLING_STRATIFIED)
+            strata << "cpu" << "dataSource";
+
+        ReservoirSink sink(this->meta,sampleSize,strata);
+        err = readSamples(dataFileNames,sink,fileSize,&fileElements);
+        if(err)
+            return err;
+
+        sink.finish(this->columns);
+        addWeightColumn(sink.weights());
+        numSeen = sink.seen();
+
+        // Kept elements are in input order, recount them per file
+        QVector<ElemIndex> origins = sink.origins();
+        ElemIndex fileEnd = 0;
+        for(int f=0, i=0; f<fileElements.size(); f++)
+        {
+            fileEnd += fileElements[f];
+            ElemIndex kept = 0;
+            for(/*i*/; i<origins.size() && origins[i] < fileEnd; i++)
+                kept++;
+            fileElements[f] = kept;
+        }
     }
 
-    // Close and return
-    dataFile.close();
+    sourceBytes = fileSize;
+
+    if(dataFileNames.size() > 1)
+    {
+        addRankColumn(fileElements);
+        if(mergeByTime)
+            mergeRanksByTime(fileElements);
+    }
+
+    ElemIndex numRows = this->columns.empty() ? 0 : this->columns[0].size();
+    if(dedup && !streamDedup)
+        deduplicateColumns();
+
+    qint64 elemid = this->columns.empty() ? 0 : this->columns[0].size();
 
     this->allocate();
 
+    qreal secs = timer.nsecsElapsed() / 1e9;
+    if(con)
+    {
+        con->log(QString("Parsed %1 samples from %2 file(s) (%3 MB) in %4 s, %5 GB/s")
+                 .arg(elemid)
+                 .arg(dataFileNames.size())
+                 .arg(fileSize / (1024.0*1024.0),0,'f',1)
+                 .arg(secs,0,'f',3)
+                 .arg(fileSize / 1e9 / secs,0,'f',3));
+
+        if(samplingMode != SAMPLING_NONE)
+            con->log(QString("Kept %1 of %2 samples (%3)")
+                     .arg(numRows)
+                     .arg(numSeen)
+                     .arg(samplingMode == SAMPLING_STRATIFIED ? "stratified by cpu and dataSource"
+                                                             : "uniform"));
+        if(dedup)
+            con->log(QString("Deduplicated %1 samples into %2 elements, ignoring %3")
+                     .arg(streamDedup ? numSeen : numRows)
+                     .arg(elemid)
+                     .arg(dedupIgnore.isEmpty() ? "nothing" : dedupIgnore.join(",")));
+
+        size_t bytes = 0;
+        QString types;
+        for(int d=0; d<this->columns.size(); d++)
+        {
+            bytes += this->columns[d].bytes();
+            types += QString(" %1:%2").arg(this->meta[d])
+                                      .arg(DataColumn::typeName(this->columns[d].type()));
+        }
+
+        con->log(QString("Resident %1 bytes/sample,%2")
+                 .arg(elemid ? (qreal)bytes / elemid : 0,0,'f',1)
+                 .arg(types));
+    }
+
     return 0;
 }
 
+// Values appended to the rank column at a time
+#define RANK_BLOCK_ELEMS 4096
+
+// Rows handed to a DedupSink at a time when deduplicating parsed columns
+#define DEDUP_BLOCK_ELEMS (1 << 20)
+
+// Replays the parsed columns through a DedupSink, for loads whose rows
+// are only final after parsing (downsampled or from several files)
+void DataObject::deduplicateColumns()
+{
+    ElemIndex n = this->columns.empty() ? 0 : this->columns[0].size();
+
+    DedupSink sink(this->meta,dedupIgnore,parseThreads);
+    sink.begin(this->numDimensions);
+
+    QVector<qreal> block(std::min(n,(ElemIndex)DEDUP_BLOCK_ELEMS));
+    for(ElemIndex b=0; b<n; b+=DEDUP_BLOCK_ELEMS)
+    {
+        ElemIndex m = std::min((ElemIndex)DEDUP_BLOCK_ELEMS,n-b);
+        for(int d=0; d<this->numDimensions; d++)
+        {
+            this->columns[d].decode(b,m,block.data());
+            sink.append(d,block.constData(),m);
+        }
+        sink.endBatch();
+    }
+
+    QVector<DataColumn> deduped;
+    sink.finish(deduped);
+    std::swap(this->columns,deduped);
+
+    this->meta = sink.dimensions();
+    this->numDimensions = this->meta.size();
+    findDimensions();
+}
+
+// Sets the weights of a downsampled load, multiplied into the weights
+// the samples may already carry
+void DataObject::addWeightColumn(const QVector<qreal> &weights)
+{
+    int dim = this->meta.indexOf("weight");
+
+    QVector<qreal> vals = weights;
+    if(dim != -1)
+    {
+        for(int e=0; e<vals.size(); e++)
+            vals[e] *= this->columns[dim].at(e);
+    }
+
+    DataColumn w;
+    w.append(vals.constData(),vals.size());
+
+    if(dim == -1)
+    {
+        this->meta.append("weight");
+        this->columns.append(w);
+    }
+    else
+    {
+        this->columns[dim] = w;
+    }
+
+    this->numDimensions = this->meta.size();
+    findDimensions();
+}
+
+// Tags every element with the index of its file in sampleFiles. Files
+// that already have a rank column get a "file" column instead.
+void DataObject::addRankColumn(const QVector<ElemIndex> &fileElements)
+{
+    QString name = this->meta.contains("rank") ? "file" : "rank";
+
+    DataColumn ranks;
+    QVector<qreal> vals;
+    for(int f=0; f<fileElements.size(); f++)
+    {
+        vals.fill(f,std::min(fileElements[f],(ElemIndex)RANK_BLOCK_ELEMS));
+        for(ElemIndex e=0; e<fileElements[f]; e+=vals.size())
+            ranks.append(vals.constData(),std::min((ElemIndex)vals.size(),fileElements[f]-e));
+    }
+
+    this->meta.append(name);
+    this->columns.append(ranks);
+    this->numDimensions = this->meta.size();
+    findDimensions();
+}
+
+// Orders element indices by their values in a column
+struct ElemOrder
+{
+    ElemOrder(const DataColumn &c) : col(c) {}
+    bool operator()(ElemIndex a, ElemIndex b) const { return col.at(a) < col.at(b); }
+    const DataColumn &col;
+};
+
+// Interleaves the per-file runs of elements into global time order with
+// a k-way merge. Runs are each in time order as sampled; any that are not
+// are sorted first.
+void DataObject::mergeRanksByTime(const QVector<ElemIndex> &fileElements)
+{
+    if(timeDim == -1)
+    {
+        std::cerr << "WARNING: no time dimension to order the sample files by" << std::endl;
+        return;
+    }
+
+    const DataColumn &times = column(timeDim);
+    ElemIndex numElems = times.size();
+
+    std::vector<ElemIndex> runOrder(numElems);
+    std::vector<ElemIndex> runPos(fileElements.size());
+    std::vector<ElemIndex> runEnd(fileElements.size());
+
+    ElemIndex start = 0;
+    for(int f=0; f<fileElements.size(); f++)
+    {
+        runPos[f] = start;
+        runEnd[f] = start + fileElements[f];
+
+        bool ordered = true;
+        for(ElemIndex e=start; e<runEnd[f]; e++)
+        {
+            runOrder[e] = e;
+            if(e > start && times.at(e) < times.at(e-1))
+                ordered = false;
+        }
+
+        if(!ordered)
+            std::stable_sort(runOrder.begin()+start,runOrder.begin()+runEnd[f],
+                             ElemOrder(times));
+
+        start = runEnd[f];
+    }
+
+    // Earliest head of all runs first, ties go to the lower rank
+    typedef std::pair<qreal,int> RunHead;
+    std::priority_queue<RunHead,std::vector<RunHead>,std::greater<RunHead> > heads;
+    for(int f=0; f<fileElements.size(); f++)
+    {
+        if(runPos[f] < runEnd[f])
+            heads.push(RunHead(times.at(runOrder[runPos[f]]),f));
+    }
+
+    std::vector<ElemIndex> order;
+    order.reserve(numElems);
+    while(!heads.empty())
+    {
+        int f = heads.top().second;
+        heads.pop();
+
+        order.push_back(runOrder[runPos[f]++]);
+        if(runPos[f] < runEnd[f])
+            heads.push(RunHead(times.at(runOrder[runPos[f]]),f));
+    }
+
+    for(int d=0; d<this->columns.size(); d++)
+    {
+        DataColumn merged;
+        merged.gather(this->columns[d],order.data(),numElems);
+        std::swap(this->columns[d],merged);
+    }
+}
+
+int DataObject::readCacheFile(QString cacheFileName, QString dataFileName)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QFileInfo source(dataFileName);
+    if(!source.exists() || !QFile::exists(cacheFileName))
+        return -1;
+
+    CacheReader *reader = new CacheReader();
+    if(reader->open(cacheFileName,source.size(),source.lastModified().toMSecsSinceEpoch()))
+    {
+        delete reader;
+        return -1;
+    }
+
+    const CacheHeader &header = reader->header();
+    int nDims = header.numDimensions;
+
+    // One name per dimension, which also bounds nDims before anything is
+    // sized from it
+    int err = reader->getStringList(this->meta);
+    err = (err || this->meta.size() != (int)header.numDimensions) ? -1 : 0;
+    dataSourceEncoding = header.dataSourceEncoding;
+    fileMeta.clear();
+    err = err ? err : reader->getDict(varDict);
+    err = err ? err : reader->getDict(sourceDict);
+
+    this->columns.clear();
+    if(!err)
+        this->columns.resize(nDims);
+    for(int d=0; !err && d<nDims; d++)
+        err = reader->getColumn(this->columns[d],header.numElements);
+
+    err = err ? err : reader->getReals(dimSums,nDims);
+    err = err ? err : reader->getReals(minimumValues,nDims);
+    err = err ? err : reader->getReals(maximumValues,nDims);
+    err = err ? err : reader->getReals(meanValues,nDims);
+    err = err ? err : reader->getReals(standardDeviations,nDims);
+    err = err ? err : reader->getReals(covarianceMatrix,nDims*nDims);
+    err = err ? err : reader->getReals(correlationMatrix,nDims*nDims);
+
+    // Out-of-core caches have none, range selections then scan instead
+    dimSortedLists.clear();
+    if(!err && (header.flags & CACHE_HAS_SORTED_LISTS))
+    {
+        dimSortedLists.resize(nDims);
+        for(int d=0; !err && d<nDims; d++)
+            err = reader->getColumn(dimSortedLists[d],header.numElements);
+    }
+
+    if(err)
+    {
+        std::cerr << "WARNING: ignoring corrupt cache " << cacheFileName.toStdString() << std::endl;
+        this->columns.clear();
+        dimSortedLists.clear();
+        delete reader;
+        return -1;
+    }
+
+    cache = reader;
+    sourceBytes = header.sourceSize;
+
+    this->numDimensions = nDims;
+    findDimensions();
+    this->allocate();
+
+    if(con)
+    {
+        con->log(QString("Loaded %1 samples from cache %2 in %3 s")
+                 .arg(this->numElements)
+                 .arg(cacheFileName)
+                 .arg(timer.nsecsElapsed() / 1e9,0,'f',3));
+    }
+
+    return 0;
+}
+
+int DataObject::writeCacheFile(QString cacheFileName, QString dataFileName)
+{
+    QFileInfo source(dataFileName);
+
+    CacheWriter writer(cacheFileName);
+    if(writer.open())
+        return -1;
+
+    writer.putStringList(this->meta);
+    writer.putDict(varDict);
+    writer.putDict(sourceDict);
+
+    for(int d=0; d<this->numDimensions; d++)
+        writer.putColumn(this->columns[d]);
+
+    writer.putReals(dimSums);
+    writer.putReals(minimumValues);
+    writer.putReals(maximumValues);
+    writer.putReals(meanValues);
+    writer.putReals(standardDeviations);
+    writer.putReals(covarianceMatrix);
+    writer.putReals(correlationMatrix);
+
+    for(int d=0; d<this->numDimensions; d++)
+        writer.putColumn(*sortedList(d));
+
+    CacheHeader header;
+    memset(&header,0,sizeof(header));
+    header.numDimensions = this->numDimensions;
+    header.numElements = this->numElements;
+    // Only what was parsed, a followed file may have grown since
+    header.sourceSize = isCompressedSampleFile(dataFileName) ? source.size() : sourceBytes;
+    header.sourceMtime = source.lastModified().toMSecsSinceEpoch();
+    header.flags = CACHE_HAS_SORTED_LISTS;
+    header.dataSourceEncoding = dataSourceEncoding;
+
+    return writer.finish(header);
+}
+
+int DataObject::streamCacheFile(QString cacheFileName, QString dataFileName)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // First pass: counts, ranges and dictionaries, nothing is kept
+    RangeSink ranges;
+    qint64 fileSize = 0;
+    int err = readSamples(dataFileName,ranges,fileSize);
+    if(err)
+        return err;
+
+    // Lay out the cache now that every column's size and type is known
+    CacheWriter writer(cacheFileName);
+    if(writer.open())
+        return -1;
+
+    writer.putStringList(this->meta);
+    writer.putDict(varDict);
+    writer.putDict(sourceDict);
+
+    QVector<column_type> types(this->numDimensions);
+    QVector<qint64> columnOffsets(this->numDimensions);
+    for(int d=0; d<this->numDimensions; d++)
+    {
+        types[d] = ranges.ranges[d].type();
+        columnOffsets[d] = writer.reserveColumn(types[d],ranges.ranges[d]);
+    }
+
+    int nDims = this->numDimensions;
+    int statSizes[] = { nDims, nDims, nDims, nDims, nDims, nDims*nDims, nDims*nDims };
+    QVector<qint64> statOffsets;
+    for(unsigned int i=0; i<sizeof(statSizes)/sizeof(statSizes[0]); i++)
+        statOffsets.push_back(writer.reserve(statSizes[i]*sizeof(qreal)));
+
+    char *out = writer.map();
+    if(out == NULL)
+    {
+        writer.abort();
+        return -1;
+    }
+
+    // Second pass: encode straight into the mapped cache. The dictionaries
+    // are rebuilt in the same order, so the IDs match the first pass.
+    QVector<char*> dst(this->numDimensions);
+    for(int d=0; d<this->numDimensions; d++)
+        dst[d] = out + columnOffsets[d];
+
+    // The file may have changed since the first pass
+    EncodeSink encoder(types,dst,ranges.ranges[0].count);
+    err = readSamples(dataFileName,encoder,fileSize);
+    if(!err && encoder.count() != ranges.ranges[0].count)
+        err = -1;
+
+    if(err)
+    {
+        writer.abort();
+        return err;
+    }
+
+    // Statistics stream over the mapped columns
+    this->columns.resize(this->numDimensions);
+    for(int d=0; d<this->numDimensions; d++)
+        this->columns[d].attach(types[d],dst[d],ranges.ranges[d]);
+    this->numElements = ranges.ranges.empty() ? 0 : ranges.ranges[0].count;
+
+    calcStatistics();
+    if(cancelled())
+    {
+        this->columns.clear();
+        writer.abort();
+        return LOAD_CANCELLED;
+    }
+
+    const QVector<qreal> *stats[] = { &dimSums, &minimumValues, &maximumValues, &meanValues,
+                                      &standardDeviations, &covarianceMatrix, &correlationMatrix };
+    for(int i=0; i<statOffsets.size(); i++)
+        memcpy(out + statOffsets[i],stats[i]->constData(),statSizes[i]*sizeof(qreal));
+
+    this->columns.clear();
+
+    QFileInfo source(dataFileName);
+
+    CacheHeader header;
+    memset(&header,0,sizeof(header));
+    header.numDimensions = this->numDimensions;
+    header.numElements = this->numElements;
+    header.sourceSize = source.size();
+    header.sourceMtime = source.lastModified().toMSecsSinceEpoch();
+    header.dataSourceEncoding = dataSourceEncoding;
+
+    err = writer.finish(header);
+
+    if(con)
+    {
+        con->log(QString("Streamed %1 samples (%2 MB) out of core into %3 in %4 s")
+                 .arg(this->numElements)
+                 .arg(fileSize / (1024.0*1024.0),0,'f',1)
+                 .arg(cacheFileName)
+                 .arg(timer.nsecsElapsed() / 1e9,0,'f',3));
+    }
+
+    return err;
+}
+
 void DataObject::setSelectionMode(selection_mode mode, bool silent)
 {
     selMode = mode;
@@ -550,6 +1868,10 @@ void DataObject::setSelectionMode(selection_mode mode, bool silent)
     con->log(selcmd);
 }
 
+// Rows per block for the covariance pass, small enough for the block's
+// columns to stay in cache while all dimension pairs go over it
+#define STATS_BLOCK_ELEMS 1024
+
 void DataObject::calcStatistics()
 {
     dimSums.resize(this->numDimensions);
@@ -561,45 +1883,97 @@ void DataObject::calcStatistics()
     covarianceMatrix.resize(this->numDimensions*this->numDimensions);
     correlationMatrix.resize(this->numDimensions*this->numDimensions);
 
-    qreal firstVal = *(this->begin);
     dimSums.fill(0);
-    minimumValues.fill(9999999999);
-    maximumValues.fill(0);
+    minimumValues.fill(std::numeric_limits<qreal>::infinity());
+    maximumValues.fill(-std::numeric_limits<qreal>::infinity());
     meanValues.fill(0);
     standardDeviations.fill(0);
 
-    // Means and combined means
-    QVector<qreal>::Iterator p;
-    ElemIndex elem;
-    qreal x, y;
+    if(progress)
+        progress->setStage(LOAD_STATISTICS,this->numElements);
+
+    // Sums, minima and maxima, one column at a time
+    for(int i=0; i<this->numDimensions; i++)
+    {
+        dimSums[i] = columnSum(column(i));
+        columnMinMax(column(i),NoMask(),minimumValues[i],maximumValues[i]);
 
+        // No elements, no range
+        if(this->numElements == 0)
+            minimumValues[i] = maximumValues[i] = 0;
+    }
+
+    // Weighted elements stand for several samples each, so every moment
+    // is weighted, the weight column's too (its mean is sum(w^2)/sum(w)).
+    // Only its sum stays plain, the number of samples stood for.
+    bool weighted = (weightDim != -1);
+    qreal totalWeight = weighted ? dimSums[weightDim] : (qreal)this->numElements;
+    QVector<qreal> weightedSums(this->numDimensions);
+    weightedSums.fill(0);
+
+    // Combined means, over blocks decoded from the narrow columns
     QVector<qreal> meanXY;
     meanXY.resize(this->numDimensions*this->numDimensions);
     meanXY.fill(0);
-    for(elem=0, p=this->begin; p!=this->end; elem++, p+=this->numDimensions)
+
+    QVector<qreal> block(this->numDimensions*STATS_BLOCK_ELEMS);
+    QVector<qreal> weightedBlock(weighted ? STATS_BLOCK_ELEMS : 0);
+    for(ElemIndex b=0; b<this->numElements; b+=STATS_BLOCK_ELEMS)
     {
+        if(cancelled())
+            return;
+
+        ElemIndex n = std::min((ElemIndex)STATS_BLOCK_ELEMS,this->numElements-b);
+        if(progress)
+            progress->advance(n);
+
+        for(int i=0; i<this->numDimensions; i++)
+            column(i).decode(b,n,block.data() + i*STATS_BLOCK_ELEMS);
+
+        const qreal *w = weighted ? block.constData() + weightDim*STATS_BLOCK_ELEMS : NULL;
         for(int i=0; i<this->numDimensions; i++)
         {
-            x = *(p+i);
-            dimSums[i] += x;
-            minimumValues[i] = std::min(x,minimumValues[i]);
-            maximumValues[i] = std::max(x,maximumValues[i]);
+            const qreal *x = block.constData() + i*STATS_BLOCK_ELEMS;
+            if(weighted)
+            {
+                qreal *wx = weightedBlock.data();
+                qreal sum = 0;
+                for(ElemIndex e=0; e<n; e++)
+                {
+                    wx[e] = w[e]*x[e];
+                    sum += wx[e];
+                }
+                weightedSums[i] += sum;
+                x = wx;
+            }
 
-            for(int j=0; j<this->numDimensions; j++)
+            for(int j=i; j<this->numDimensions; j++)
             {
-                y = *(p+j);
-                meanXY[ROWMAJOR_2D(i,j,this->numDimensions)] += x*y;
+                const qreal *y = block.constData() + j*STATS_BLOCK_ELEMS;
+
+                qreal sum = 0;
+                for(ElemIndex e=0; e<n; e++)
+                    sum += x[e]*y[e];
+
+                meanXY[ROWMAJOR_2D(i,j,this->numDimensions)] += sum;
             }
         }
     }
 
-    // Divide by this->numElements to get mean
+    for(int i=0; weighted && i<this->numDimensions; i++)
+    {
+        if(i != weightDim)
+            dimSums[i] = weightedSums[i];
+    }
+
+    // Divide by the number of samples to get mean
     for(int i=0; i<this->numDimensions; i++)
     {
-        meanValues[i] = dimSums[i] / (qreal)this->numElements;
-        for(int j=0; j<this->numDimensions; j++)
+        meanValues[i] = (weighted ? weightedSums[i] : dimSums[i]) / totalWeight;
+        for(int j=i; j<this->numDimensions; j++)
         {
-            meanXY[ROWMAJOR_2D(i,j,this->numDimensions)] /= (qreal)this->numElements;
+            meanXY[ROWMAJOR_2D(i,j,this->numDimensions)] /= totalWeight;
+            meanXY[ROWMAJOR_2D(j,i,this->numDimensions)] = meanXY[ROWMAJOR_2D(i,j,this->numDimensions)];
         }
     }
 
@@ -614,20 +1988,110 @@ void DataObject::calcStatistics()
     }
 
     // Standard deviation of each dim
-    for(elem=0, p=this->begin; p!=this->end; elem++, p+=this->numDimensions)
+    for(int i=0; i<this->numDimensions; i++)
     {
-        for(int i=0; i<this->numDimensions; i++)
+        if(weighted)
         {
-            x = *(p+i);
-            standardDeviations[i] += (x-meanValues[i])*(x-meanValues[i]);
+            qreal var = covarianceMatrix[ROWMAJOR_2D(i,i,this->numDimensions)];
+            standardDeviations[i] = sqrt(std::max(var,(qreal)0));
+            continue;
         }
+        standardDeviations[i] = columnSquaredDeviation(column(i),meanValues[i]);
+        standardDeviations[i] = sqrt(standardDeviations[i]/(qreal)this->numElements);
     }
 
-    for(int i=0; i<this->numDimensions; i++)
+    calcCorrelations();
+}
+
+// Combines the moments of the elements before first with those of the
+// ones from first on (Chan et al.), so only the new elements are read
+void DataObject::updateStatistics(ElemIndex first)
+{
+    // The merge below counts every element once
+    if(first == 0 || weightDim != -1)
     {
-        standardDeviations[i] = sqrt(standardDeviations[i]/(qreal)this->numElements);
+        calcStatistics();
+        return;
+    }
+
+    ElemIndex last = this->numElements;
+    if(last == first)
+        return;
+
+    int nDims = this->numDimensions;
+    qreal na = first;
+    qreal nb = last - first;
+    qreal n = last;
+
+    QVector<qreal> meanB(nDims);
+    for(int i=0; i<nDims; i++)
+    {
+        qreal sum = columnSum(column(i),first,last);
+        dimSums[i] += sum;
+        meanB[i] = sum / nb;
+        columnMinMax(column(i),first,last,minimumValues[i],maximumValues[i]);
+    }
+
+    // Co-moments of the new elements about their own means
+    QVector<qreal> comB(nDims*nDims);
+    comB.fill(0);
+
+    QVector<qreal> block(nDims*STATS_BLOCK_ELEMS);
+    for(ElemIndex b=first; b<last; b+=STATS_BLOCK_ELEMS)
+    {
+        ElemIndex m = std::min((ElemIndex)STATS_BLOCK_ELEMS,last-b);
+
+        for(int i=0; i<nDims; i++)
+        {
+            qreal *x = block.data() + i*STATS_BLOCK_ELEMS;
+            column(i).decode(b,m,x);
+            for(ElemIndex e=0; e<m; e++)
+                x[e] -= meanB[i];
+        }
+
+        for(int i=0; i<nDims; i++)
+        {
+            const qreal *x = block.constData() + i*STATS_BLOCK_ELEMS;
+            for(int j=i; j<nDims; j++)
+            {
+                const qreal *y = block.constData() + j*STATS_BLOCK_ELEMS;
+
+                qreal sum = 0;
+                for(ElemIndex e=0; e<m; e++)
+                    sum += x[e]*y[e];
+
+                comB[ROWMAJOR_2D(i,j,nDims)] += sum;
+            }
+        }
     }
 
+    for(int i=0; i<nDims; i++)
+    {
+        qreal di = meanB[i] - meanValues[i];
+        for(int j=i; j<nDims; j++)
+        {
+            qreal dj = meanB[j] - meanValues[j];
+            qreal c = covarianceMatrix[ROWMAJOR_2D(i,j,nDims)]*na
+                    + comB[ROWMAJOR_2D(i,j,nDims)]
+                    + di*dj*na*nb/n;
+            covarianceMatrix[ROWMAJOR_2D(i,j,nDims)] = c / n;
+            covarianceMatrix[ROWMAJOR_2D(j,i,nDims)] = c / n;
+        }
+
+        qreal m2 = standardDeviations[i]*standardDeviations[i]*na
+                 + comB[ROWMAJOR_2D(i,i,nDims)]
+                 + di*di*na*nb/n;
+        standardDeviations[i] = sqrt(m2 / n);
+    }
+
+    for(int i=0; i<nDims; i++)
+        meanValues[i] = dimSums[i] / n;
+
+    calcCorrelations();
+}
+
+void DataObject::calcCorrelations()
+{
     // Correlation Coeff = cov(xy) / stdev(x)*stdev(y)
     for(int i=0; i<this->numDimensions; i++)
     {
@@ -642,18 +2106,104 @@ void DataObject::calcStatistics()
 
 void DataObject::constructSortedLists()
 {
+    // Sorted once with the values alongside, then kept as a narrow
+    // column of element indices
+    column_type idxType = DataColumn::narrowestType(0,this->numElements,true,true);
+
+    if(progress)
+        progress->setStage(LOAD_INDEXES,this->numDimensions);
+
+    IndexList list(this->numElements);
     dimSortedLists.resize(this->numDimensions);
     for(int d=0; d<this->numDimensions; d++)
     {
-        for(int e=0; e<this->numElements; e++)
+        if(cancelled())
+            return;
+
+        const DataColumn &vals = column(d);
+        for(ElemIndex e=0; e<this->numElements; e++)
+        {
+            list[e].idx = e;
+            list[e].val = vals.at(e);
+        }
+        std::sort(list.begin(),list.end());
+
+        DataColumn &order = dimSortedLists.at(d);
+        order.reset(idxType,this->numElements);
+        for(ElemIndex e=0; e<this->numElements; e++)
+            order.set(e,list[e].idx);
+
+        if(progress)
+            progress->advance(1);
+    }
+}
+
+#define MERGE_BLOCK_ELEMS 4096
+
+// Sorts the values of the elements from order.size() to last and merges
+// them into order. The old order is read and the merged one written a
+// block at a time, so only the values are looked up one by one.
+template<typename T>
+static void mergeSortedRun(const T *vals, DataColumn &order, ElemIndex last)
+{
+    ElemIndex first = order.size();
+
+    IndexList added(last-first);
+    for(ElemIndex e=first; e<last; e++)
+    {
+        added[e-first].idx = e;
+        added[e-first].val = vals[e];
+    }
+    std::sort(added.begin(),added.end());
+
+    QVector<qreal> oldBlock(MERGE_BLOCK_ELEMS);
+    QVector<qreal> outBlock(MERGE_BLOCK_ELEMS);
+    DataColumn merged;
+
+    ElemIndex a = 0, aStart = 0, aEnd = 0, b = 0;
+    int k = 0;
+    while(a < first || b < added.size())
+    {
+        if(a < first && a == aEnd)
         {
-            struct indexedValue di;
-            di.idx = e;
-            di.val = at(e,d);
-            dimSortedLists.at(d).push_back(di);
+            aStart = a;
+            aEnd = std::min(a + MERGE_BLOCK_ELEMS,first);
+            order.decode(aStart,aEnd-aStart,oldBlock.data());
+        }
+
+        if(a < first && (b == added.size() || !(added[b].val < vals[(ElemIndex)oldBlock[a-aStart]])))
+            outBlock[k++] = oldBlock[(a++)-aStart];
+        else
+            outBlock[k++] = added[b++].idx;
+
+        if(k == MERGE_BLOCK_ELEMS)
+        {
+            merged.append(outBlock.data(),k);
+            k = 0;
         }
-        std::sort(dimSortedLists.at(d).begin(),dimSortedLists.at(d).end());
     }
+    merged.append(outBlock.data(),k);
+
+    std::swap(order,merged);
+}
+
+// Brings dimension d's sorted list up to date with the appended elements
+void DataObject::mergeSortedList(int d) const
+{
+    const DataColumn &vals = column(d);
+    DISPATCH_COLUMN_TYPE(vals, mergeSortedRun(vals.values<T>(),dimSortedLists[d],this->numElements));
+}
+
+// Appended elements (follow mode) only cost the lists that are used
+const DataColumn *DataObject::sortedList(int d) const
+{
+    if(dimSortedLists.empty())
+        return NULL;
+
+    QMutexLocker lock(&sortedListsLock);
+    if(dimSortedLists[d].size() < this->numElements)
+        mergeSortedList(d);
+    return &dimSortedLists[d];
 }
 
 qreal distanceHardware(DataObject *d, ElemSet *s1, ElemSet *s2)
@@ -676,7 +2226,7 @@ qreal distanceHardware(DataObject *d, ElemSet *s1, ElemSet *s2)
     qreal n1 = s1->size();
     qreal n2 = s2->size();
 
-    ElemSet::iterator it;
+    ElemSet::const_iterator it;
     qreal lat;
 
     // Collect s1 topo data
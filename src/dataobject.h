@@ -40,26 +40,49 @@
 #define DATAOBJECT_H
 
 #include <QWidget>
-#include <QBitArray>
+#include <QMutex>
 
 #include <map>
-#include <set>
 #include <vector>
 #include <assert.h>
 
 #include "hwtopo.h"
 #include "util.h"
 #include "console.h"
+#include "stringdict.h"
+#include "columnkernels.h"
+#include "categoryindex.h"
+#include "selectionhistory.h"
+#include "loadprogress.h"
 
 #define INVISIBLE false
 #define VISIBLE true
 
+// Group IDs are one byte per element, 0 being unselected
+#define MAX_SELECTION_GROUPS 255
+
 class hwTopo;
 class hwNode;
 class console;
+class CacheReader;
+class SampleSink;
 
 typedef unsigned long long ElemIndex;
-typedef std::set<ElemIndex> ElemSet;
+
+enum storage_mode
+{
+    STORAGE_AUTO = 0,    // out of core when the file is large for this machine
+    STORAGE_IN_MEMORY,
+    STORAGE_OUT_OF_CORE
+};
+
+// Downsampling at load time, see ReservoirSink
+enum sampling_mode
+{
+    SAMPLING_NONE = 0,
+    SAMPLING_RESERVOIR,  // uniform over all samples
+    SAMPLING_STRATIFIED  // per (cpu, dataSource)
+};
 
 enum selection_mode
 {
@@ -81,6 +104,19 @@ struct indexedValue
 
 typedef std::vector<indexedValue> IndexList;
 
+// Selection changes the views have not caught up with: the elements that
+// changed group, by the group they left (their new one is selected()).
+// When full, the changes are unknown and everything must be redone.
+struct SelectionDelta
+{
+    SelectionDelta() : full(true) {}
+
+    bool full;
+    std::vector<ElemSet> changed;
+
+    bool empty() const;
+};
+
 // Distance Functions (for clustering)
 typedef qreal (*distance_metric_fn_t)(DataObject *d, ElemSet *s1, ElemSet *s2);
 qreal distanceHardware(DataObject *d, ElemSet *s1, ElemSet *s2);
@@ -89,58 +125,134 @@ class DataObject
 {
 public:
     DataObject();
-
+    ~DataObject();
 
     hwTopo *getTopo() { return topo; }
     int loadHardwareTopology(QString filename);
     bool empty() { return numElements == 0; }
 
-    // Initialization
+    // Initialization. filename may also be a directory or wildcard
+    // pattern of sample files, e.g. one per rank.
     int loadData(QString filename);
-    void selectionChanged() { collectTopoSamples(); }
+    static QStringList findSampleFiles(QString path);
+    void selectionChanged();
     void visibilityChanged() { collectTopoSamples(); }
 
     void setConsole(console *c) { con = c; }
+    void setParseThreads(int n) { parseThreads = n; } // 0 = all cores
+    void setUseCache(bool use) { useCache = use; }
+    void setStorageMode(storage_mode mode) { storageMode = mode; }
+    void setMergeByTime(bool merge) { mergeByTime = merge; }
+
+    // Keeps at most size samples (per stratum) in a "weight" column
+    // weighted by how many they stand for. Such loads bypass the cache.
+    void setSampling(sampling_mode mode, ElemIndex size) { samplingMode = mode; sampleSize = size; }
+
+    // Collapses samples equal on all but the ignored dimensions into one
+    // element with a "weight" column. Such loads bypass the cache too.
+    void setDeduplicate(bool on, QStringList ignore = QStringList("time"))
+        { dedup = on; dedupIgnore = ignore; }
+
+    // Progress and cancellation of loadData(), which may run on another thread
+    void setProgress(LoadProgress *p) { progress = p; }
+    bool cancelled() const { return progress && progress->cancelled(); }
+
+    // Follow mode: parses the samples appended to the loaded file since
+    // the last call, the new elements are [firstNew,numElements)
+    int followData(ElemIndex &firstNew);
+    QString dataFileName() const { return sourceFileName; }
 
 private:
     void allocate();
     void collectTopoSamples();
-    int parseCSVFile(QString dataFileName);
+    void updateTopoSamples(const SelectionDelta &delta);
+    void addTopoSamples(ElemIndex first, ElemIndex last);
+    bool isCategorical(int dim) const;
+    void appendElements(ElemIndex first);
+    void updateStatistics(ElemIndex first);
+    void calcCorrelations();
+    void mergeSortedList(int d) const;
+    void findDimensions();
+    int readSamples(QString dataFileName, SampleSink &sink, qint64 &bytesRead);
+    int readSamples(QStringList dataFileNames, SampleSink &sink, qint64 &bytesRead,
+                    QVector<ElemIndex> *fileElements = NULL);
+    int readHeader(QString dataFileName, const char *&p, const char *end);
+    int setMeta(QString dataFileName, const QStringList &header);
+    int parseCSVFile(QStringList dataFileNames);
+    void addRankColumn(const QVector<ElemIndex> &fileElements);
+    void mergeRanksByTime(const QVector<ElemIndex> &fileElements);
+    void addWeightColumn(const QVector<qreal> &weights);
+    void deduplicateColumns();
+    int readCacheFile(QString cacheFileName, QString dataFileName);
+    int writeCacheFile(QString cacheFileName, QString dataFileName);
+    int streamCacheFile(QString cacheFileName, QString dataFileName);
+    bool outOfCore(QString dataFileName) const;
+    void selectRange(int dim, qreal vmin, qreal vmax, ElemSet &selSet) const;
+    int groupIndex(int group);
+    void mergeSelectionDelta(std::vector<ElemSet> &changed);
+    void recordSelection();
+    void restoreSelection(const GroupSets &from, const GroupSets &to);
 
 public:
-    // Selection & Visibility
+    // Selection & Visibility. Elements belong to at most one selection
+    // group, 1 to MAX_SELECTION_GROUPS. Group -1 is the current group.
     selection_mode selectionMode() { return selMode; }
     void setSelectionMode(selection_mode mode, bool silent = false);
-    int selected(ElemIndex index);
-    bool visible(ElemIndex index);
-    bool selectionDefined();
-
-    void selectData(ElemIndex index, int group = 1);
-    void selectAll(int group = 1);
+    int currentGroup() const { return selGroup; }
+    void setCurrentGroup(int group);
+    int numSelectionGroups() const { return selectionSets.size(); } // including 0
+    const quint8 *groupIDs() const { return selectionGroup.empty() ? NULL : &selectionGroup[0]; }
+    int selected(ElemIndex index) const;
+    bool visible(ElemIndex index) const;
+    bool selectionDefined() const;
+
+    void selectData(ElemIndex index, int group = -1);
+    void selectAll(int group = -1);
     void deselectAll();
-    void selectAllVisible(int group = 1);
+    void selectAllVisible(int group = -1);
 
-    void showData(unsigned int index);
-    void hideData(unsigned int index);
+    void showData(ElemIndex index);
+    void hideData(ElemIndex index);
     void showAll();
     void hideAll();
     void hideSelected();
     void hideUnselected();
 
-    void selectSet(ElemSet &s, int group = 1);
-    void selectByDimRange(int dim, qreal vmin, qreal vmax, int group = 1);
-    void selectByMultiDimRange(QVector<int> dims, QVector<qreal> mins, QVector<qreal> maxes, int group = 1);
-    void selectBySourceFileName(QString str, int group = 1);
-    void selectByVarName(QString str, int group = 1);
-    void selectByResource(hwNode *node, int group = 1);
+    void selectSet(const ElemSet &s, int group = -1);
+    void selectByDimRange(int dim, qreal vmin, qreal vmax, int group = -1);
+    void selectByMultiDimRange(QVector<int> dims, QVector<qreal> mins, QVector<qreal> maxes, int group = -1);
+    void selectBySourceFileName(QString str, int group = -1);
+    void selectBySourceLine(QString str, int line, int group = -1);
+    void selectByVarName(QString str, int group = -1);
+    void selectByCategory(int dim, qreal val, int group = -1);
+    void selectByResource(hwNode *node, int group = -1);
+
+    ElemSet& getSelectionSet(int group = -1) { return selectionSets.at(groupIndex(group)); }
 
-    ElemSet& getSelectionSet(int group = 1) { return selectionSets.at(group); }
+    // Changes since clearSelectionDelta(), for updating aggregates in
+    // proportion to what changed rather than to the data size
+    const SelectionDelta &selectionDelta() const { return selDelta; }
+    void clearSelectionDelta();
+
+    // Every selectionChanged() is a step that can be undone
+    bool canUndoSelection() const { return selHistory.canUndo(); }
+    bool canRedoSelection() const { return selHistory.canRedo(); }
+    bool undoSelection();
+    bool redoSelection();
 
     // Calculated statistics
     void calcStatistics();
     void constructSortedLists();
 
-    qreal at(int i, int d) const { return vals[i*numDimensions+d]; }
+    // Element indices of dimension d in ascending value order, if built
+    const DataColumn *sortedList(int d) const;
+    ElemIndex sortedPosAbove(int dim, qreal val) const;
+    bool hasCategoryIndex(int dim) const;
+    const ElemSet *categorySet(int dim, qreal val) const;
+
+    qreal at(ElemIndex i, int d) const { return columns[d].at(i); }
+    qreal weight(ElemIndex i) const { return weightDim == -1 ? 1 : columns[weightDim].at(i); }
+    const DataColumn &column(int d) const { return columns[d]; }
     qreal sumAt(int d) const { return dimSums[d]; }
     qreal minAt(int d) const { return minimumValues[d]; }
     qreal maxAt(int d) const { return maximumValues[d]; }
@@ -168,7 +280,10 @@ public:
     int sourceDim;
     int lineDim;
     int variableDim;
+    int timeDim;
+    int rankDim;
     int dataSourceDim;
+    int dataSourceEncoding;
     int indexDim;
     int latencyDim;
     int cpuDim;
@@ -176,19 +291,39 @@ public:
     int xDim;
     int yDim;
     int zDim;
+    int weightDim;
 
-    QVector<qreal> vals;
-    QVector<QString> fileNames;
-    QVector<QString> varNames;
-    QVector<qreal>::Iterator begin;
-    QVector<qreal>::Iterator end;
+    QVector<DataColumn> columns;
 
-private:
-    QBitArray visibility;
-    QVector<int> selectionGroup;
-    std::vector<ElemSet> selectionSets;
+    // Sample files of the last load, the rank dimension indexes these
+    QStringList sampleFiles;
 
-    std::vector<IndexList> dimSortedLists;
+    // Names of the variable and source dimensions, which hold only IDs
+    StringDict varDict;
+    StringDict sourceDict;
+
+private:
+    // A bit and a byte per element. Unlike QBitArray/QVector these can
+    // hold more than 2^31 elements.
+    std::vector<bool> visibility;
+    std::vector<quint8> selectionGroup;
+    GroupSets selectionSets;
+
+    // Element indices of each dimension in ascending value order. Elements
+    // appended later are merged into a list when it is next used.
+    mutable std::vector<DataColumn> dimSortedLists;
+    mutable QMutex sortedListsLock;
+
+    // Elements of each value of the categorical dimensions (empty for
+    // the others) and of each (source,line) pair. Each is built, and
+    // brought up to date with appended elements, when it is next used.
+    // Out of core loads scan the columns instead.
+    bool categoryIndexing;
+    mutable QVector<CategoryIndex> categoryIndexes;
+    mutable QVector<ElemIndex> categoryIndexed;
+    mutable CategoryIndex sourceLineIndex;
+    mutable ElemIndex sourceLineIndexed;
+    mutable QMutex categoryLock;
 
     QVector<qreal> dimSums;
     QVector<qreal> minimumValues;
@@ -202,8 +337,50 @@ private:
     console *con;
     QVector<DataObject*> dataObjects;
 
+    int parseThreads;
+
+    // Mapped .mxc cache the columns are attached to, if loaded from one
+    bool useCache;
+    storage_mode storageMode;
+    CacheReader *cache;
+
+    bool mergeByTime;
+
+    sampling_mode samplingMode;
+    ElemIndex sampleSize;
+
+    bool dedup;
+    QStringList dedupIgnore;
+
+    LoadProgress *progress;
+
+    // Sample file of the last load and how many of its bytes are parsed
+    QString sourceFileName;
+    qint64 sourceBytes;
+
+    // Columns of the sample files, before parsing adds to them
+    QStringList fileMeta;
+
     int selGroup;
     selection_mode selMode;
+    SelectionDelta selDelta;
+    SelectionHistory selHistory;
+    bool selRestored;   // the pending changes are an undo or redo
+};
+
+// Element masks for the column kernels
+struct VisibleMask
+{
+    VisibleMask(const DataObject *d) : dataSet(d) {}
+    bool operator()(ElemIndex i) const { return dataSet->visible(i); }
+    const DataObject *dataSet;
+};
+
+struct SelectedMask
+{
+    SelectedMask(const DataObject *d) : dataSet(d) {}
+    bool operator()(ElemIndex i) const { return dataSet->selected(i); }
+    const DataObject *dataSet;
 };
 
 #endif // DATAOBJECT_H
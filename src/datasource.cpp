@@ -0,0 +1,206 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "datasource.h"
+
+static const char *fieldNames[DSF_NUM_FIELDS] =
+{
+    "dataSource", "dirty", "stlbMiss", "locked", "remote"
+};
+
+const char *dataSourceFieldName(int field)
+{
+    return fieldNames[field];
+}
+
+static DataSourceInfo makeInfo(int depth, int dirty, bool remote, const char *label)
+{
+    DataSourceInfo info;
+    info.depth = depth;
+    info.dirty = dirty;
+    info.remote = remote;
+    info.stlbMiss = false;
+    info.locked = false;
+    info.label = label;
+    return info;
+}
+
+// Intel PEBS load latency: bits 0-3 data source, 0x10 STLB miss, 0x20 locked
+static DataSourceInfo intelPEBS(int key)
+{
+    DataSourceInfo info;
+    switch(key & 0xF)
+    {
+        case(0x0): info = makeInfo(-1,-1,false,"Unknown L3 Miss"); break;
+        case(0x1): info = makeInfo(1,-1,false,"L1"); break;
+        case(0x2): info = makeInfo(1,-1,false,"TLB"); break; // cache hit pending (don't draw)
+        case(0x3): info = makeInfo(2,-1,false,"L2"); break;
+        case(0x4): info = makeInfo(3,-1,false,"L3"); break;
+        case(0x5): info = makeInfo(3,0,false,"L3 Snoop (clean)"); break; // from another core L2/L1
+        case(0x6): info = makeInfo(3,1,false,"L3 Snoop (dirty)"); break; // from another core L2/L1
+        case(0x7): info = makeInfo(-1,-1,false,"LLC Snoop (dirty)"); break; // no LLC now
+        case(0x8): info = makeInfo(4,-1,false,"L3 Miss (dirty)"); break; // local ram?
+        case(0x9): info = makeInfo(-1,-1,false,"MONKEYS"); break; // reserved (shouldn't happen)
+        case(0xA): info = makeInfo(4,0,false,"Local RAM"); break;
+        case(0xB): info = makeInfo(4,0,true,"Remote RAM"); break;
+        case(0xC): info = makeInfo(4,1,false,"Local RAM"); break;
+        case(0xD): info = makeInfo(4,1,true,"Remote RAM"); break;
+        case(0xE): info = makeInfo(-1,-1,false,"I/O"); break;
+        default:   info = makeInfo(-1,-1,false,"Uncacheable"); break;
+    }
+
+    info.stlbMiss = key & 0x10;
+    info.locked = key & 0x20;
+    return info;
+}
+
+// AMD IBS op sampling, packed by the collector as bits 0-4 IbsOpData2
+// DataSrc (DataSrcHi:DataSrcLo), 0x20 RmtNode, 0x40 IbsOpData3 DcMiss,
+// 0x80 DcL2TlbMiss, 0x100 DcLockedOp
+static DataSourceInfo amdIBS(int key)
+{
+    bool remote = key & 0x20;
+    DataSourceInfo info;
+    switch(key & 0x1F)
+    {
+        case(0x0):
+            if(key & 0x40)
+                info = makeInfo(2,-1,false,"L2");
+            else
+                info = makeInfo(1,-1,false,"L1");
+            break;
+        case(0x1): info = makeInfo(3,-1,false,"L3"); break;
+        case(0x2): info = makeInfo(3,-1,false,"Near CCX Cache"); break;
+        case(0x3): info = makeInfo(4,-1,remote,remote ? "Remote RAM" : "Local RAM"); break;
+        case(0x4): info = makeInfo(3,-1,true,"Remote Cache"); break; // before family 19h
+        case(0x5): info = makeInfo(3,-1,remote,"Far CCX Cache"); break;
+        case(0x6): info = makeInfo(4,-1,remote,"Persistent Memory"); break;
+        case(0x7): info = makeInfo(-1,-1,false,"I/O"); break;
+        case(0x8): info = makeInfo(4,-1,remote,"Extension Memory"); break;
+        case(0xC): info = makeInfo(4,-1,remote,"Peer Agent Memory"); break;
+        default:   info = makeInfo(-1,-1,false,"Unknown"); break;
+    }
+
+    info.stlbMiss = key & 0x80;
+    info.locked = key & 0x100;
+    return info;
+}
+
+// Arm SPE (Neoverse data source packet): bits 0-3 data source, 0x10 TLB
+// walk event, 0x20 atomic or exclusive operation
+static DataSourceInfo armSPE(int key)
+{
+    DataSourceInfo info;
+    switch(key & 0xF)
+    {
+        case(0x0): info = makeInfo(1,-1,false,"L1"); break;
+        case(0x8): info = makeInfo(2,-1,false,"L2"); break;
+        case(0x9): info = makeInfo(3,-1,false,"Peer Core"); break;
+        case(0xA): info = makeInfo(3,-1,false,"Local Cluster"); break;
+        case(0xB): info = makeInfo(3,-1,false,"System Cache"); break;
+        case(0xC): info = makeInfo(3,-1,false,"Peer Cluster"); break;
+        case(0xD): info = makeInfo(4,-1,true,"Remote"); break;
+        case(0xE): info = makeInfo(4,-1,false,"RAM"); break;
+        default:   info = makeInfo(-1,-1,false,"Unknown"); break;
+    }
+
+    info.stlbMiss = key & 0x10;
+    info.locked = key & 0x20;
+    return info;
+}
+
+DataSourceDecoder::DataSourceDecoder(const char *name, int keyBits, Rule rule)
+    : decoderName(name), mask((1 << keyBits) - 1)
+{
+    table.resize(1 << keyBits);
+    for(int f=0; f<DSF_NUM_FIELDS; f++)
+        fields[f].resize(1 << keyBits);
+
+    for(int k=0; k<table.size(); k++)
+    {
+        table[k] = rule(k);
+        fields[DSF_DEPTH][k] = table[k].depth;
+        fields[DSF_DIRTY][k] = table[k].dirty;
+        fields[DSF_STLB_MISS][k] = table[k].stlbMiss ? 1 : 0;
+        fields[DSF_LOCKED][k] = table[k].locked ? 1 : 0;
+        fields[DSF_REMOTE][k] = table[k].remote ? 1 : 0;
+    }
+}
+
+void DataSourceDecoder::decode(int field, const qreal *vals, qint64 n, qreal *out) const
+{
+    const qreal *f = fields[field].constData();
+    for(qint64 i=0; i<n; i++)
+        out[i] = f[(int)vals[i] & mask];
+}
+
+// Built once at startup, in data_source_encoding order
+static const DataSourceDecoder decoders[DSE_NUM_ENCODINGS] =
+{
+    DataSourceDecoder("intel-pebs",6,intelPEBS),
+    DataSourceDecoder("amd-ibs",9,amdIBS),
+    DataSourceDecoder("arm-spe",6,armSPE)
+};
+
+const DataSourceDecoder &dataSourceDecoder(int encoding)
+{
+    if(encoding < 0 || encoding >= DSE_NUM_ENCODINGS)
+        encoding = DSE_INTEL_PEBS;
+    return decoders[encoding];
+}
+
+bool isDataSourceColumn(const QString &column)
+{
+    return column == "dataSource" || column.startsWith("dataSource:");
+}
+
+int findDataSourceEncoding(const QString &column)
+{
+    if(column == "dataSource")
+        return DSE_INTEL_PEBS;
+    if(!isDataSourceColumn(column))
+        return -1;
+
+    QString name = column.mid(column.indexOf(':')+1);
+    for(int e=0; e<DSE_NUM_ENCODINGS; e++)
+    {
+        if(name == decoders[e].name())
+            return e;
+    }
+    return -1;
+}
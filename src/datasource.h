@@ -0,0 +1,110 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef DATASOURCE_H
+#define DATASOURCE_H
+
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+// Encodings of the dataSource column. A sample file picks one with a
+// suffix on the column name (e.g. "dataSource:amd-ibs"), plain
+// "dataSource" is Intel PEBS.
+enum data_source_encoding
+{
+    DSE_INTEL_PEBS = 0,
+    DSE_AMD_IBS,
+    DSE_ARM_SPE,
+    DSE_NUM_ENCODINGS
+};
+
+// What a raw encoding decodes to, in the order of their columns
+enum data_source_field
+{
+    DSF_DEPTH = 0,
+    DSF_DIRTY,
+    DSF_STLB_MISS,
+    DSF_LOCKED,
+    DSF_REMOTE,
+    DSF_NUM_FIELDS
+};
+
+// Column name of a field, "dataSource" for the depth
+const char *dataSourceFieldName(int field);
+
+struct DataSourceInfo
+{
+    int depth;      // 1 = L1 ... 4 = RAM, -1 unknown
+    int dirty;      // -1 when it does not apply
+    bool remote;
+    bool stlbMiss;
+    bool locked;
+    const char *label;
+};
+
+// Lookup table from raw encodings (masked to keyBits) to what they mean,
+// generated from the rules of one vendor
+class DataSourceDecoder
+{
+public:
+    typedef DataSourceInfo (*Rule)(int key);
+
+    DataSourceDecoder(const char *name, int keyBits, Rule rule);
+
+    const char *name() const { return decoderName; }
+    const DataSourceInfo &info(int raw) const { return table[raw & mask]; }
+
+    // Values of one field for n raw encodings, out may be vals
+    void decode(int field, const qreal *vals, qint64 n, qreal *out) const;
+
+private:
+    const char *decoderName;
+    int mask;
+    QVector<DataSourceInfo> table;
+    QVector<qreal> fields[DSF_NUM_FIELDS];
+};
+
+const DataSourceDecoder &dataSourceDecoder(int encoding);
+
+// Encoding named by a header column ("dataSource" or "dataSource:<name>"),
+// or -1 if the column is not a data source or the name is unknown
+int findDataSourceEncoding(const QString &column);
+bool isDataSourceColumn(const QString &column);
+
+#endif // DATASOURCE_H
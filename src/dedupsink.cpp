@@ -0,0 +1,298 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "dedupsink.h"
+
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include <algorithm>
+#include <string.h>
+
+enum dedup_phase
+{
+    PHASE_HASH = 0,
+    PHASE_AGGREGATE
+};
+
+class DedupTask : public QRunnable
+{
+public:
+    DedupTask(DedupSink *s, int ph, int i) : sink(s), phase(ph), index(i) {}
+
+    void run()
+    {
+        if(phase == PHASE_HASH)
+            sink->hashRows(index);
+        else
+            sink->aggregate(index);
+    }
+
+private:
+    DedupSink *sink;
+    int phase;
+    int index;
+};
+
+DedupSink::DedupSink(const QStringList &m, QStringList ignore, int threads)
+    : meta(m), ignoreNames(ignore), numDimensions(-1), weightDim(-1),
+      pendingRows(0), numSeen(0)
+{
+    numThreads = (threads <= 0) ? QThread::idealThreadCount() : threads;
+    partitions.resize(numThreads);
+}
+
+void DedupSink::begin(int n)
+{
+    // Called again for every parse of a multi-file load
+    if(n == numDimensions)
+        return;
+
+    numDimensions = n;
+    pending.resize(n);
+
+    keyDims.clear();
+    weightDim = -1;
+    for(int d=0; d<n && d<meta.size(); d++)
+    {
+        if(meta[d] == "weight")
+            weightDim = d;
+        else if(!ignoreNames.contains(meta[d]))
+            keyDims.push_back(d);
+    }
+}
+
+void DedupSink::append(int dim, const qreal *vals, ElemIndex n)
+{
+    QVector<qreal> &p = pending[dim];
+    int size = p.size();
+    p.resize(size + n);
+    memcpy(p.data() + size,vals,n*sizeof(qreal));
+}
+
+void DedupSink::runPhase(int phase, int numTasks)
+{
+    if(numThreads == 1)
+    {
+        for(int i=0; i<numTasks; i++)
+            DedupTask(this,phase,i).run();
+        return;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+    for(int i=0; i<numTasks; i++)
+        pool.start(new DedupTask(this,phase,i));
+    pool.waitForDone();
+}
+
+static inline quint64 mix(quint64 h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+void DedupSink::hashRows(int task)
+{
+    ElemIndex first = pendingRows * task / numThreads;
+    ElemIndex last = pendingRows * (task+1) / numThreads;
+
+    for(ElemIndex i=first; i<last; i++)
+    {
+        quint64 h = 0;
+        for(int k=0; k<keyDims.size(); k++)
+        {
+            // +0.0 so that -0.0 hashes like 0.0, which it equals
+            qreal v = pending[keyDims[k]][i] + 0.0;
+            quint64 bits;
+            memcpy(&bits,&v,sizeof(bits));
+            h = mix(h ^ bits);
+        }
+        pendingHashes[i] = h;
+    }
+}
+
+void DedupSink::grow(Partition &p)
+{
+    int size = p.table.isEmpty() ? 1024 : p.table.size()*2;
+    p.table.fill(-1,size);
+    for(int g=0; g<p.hashes.size(); g++)
+    {
+        int slot = p.hashes[g] & (size-1);
+        while(p.table[slot] != -1)
+            slot = (slot+1) & (size-1);
+        p.table[slot] = g;
+    }
+}
+
+// Rows whose hash falls into this partition, so no two tasks ever touch
+// the same group
+void DedupSink::aggregate(int partition)
+{
+    Partition &p = partitions[partition];
+    int numKeys = keyDims.size();
+
+    for(ElemIndex i=0; i<pendingRows; i++)
+    {
+        quint64 h = pendingHashes[i];
+        if((int)((h >> 40) % numThreads) != partition)
+            continue;
+
+        if(2*(p.hashes.size()+1) > p.table.size())
+            grow(p);
+
+        qreal w = (weightDim == -1) ? 1 : pending[weightDim][i];
+
+        int mask = p.table.size()-1;
+        int slot = h & mask;
+        for(;;)
+        {
+            int g = p.table[slot];
+            if(g == -1)
+            {
+                g = p.hashes.size();
+                p.table[slot] = g;
+                p.hashes.push_back(h);
+                p.weights.push_back(w);
+                p.first.push_back(numSeen + i);
+                for(int k=0; k<numKeys; k++)
+                    p.keys.push_back(pending[keyDims[k]][i]);
+                break;
+            }
+
+            if(p.hashes[g] == h)
+            {
+                const qreal *key = p.keys.constData() + (ElemIndex)g*numKeys;
+                int k = 0;
+                while(k < numKeys && key[k] == pending[keyDims[k]][i])
+                    k++;
+                if(k == numKeys)
+                {
+                    p.weights[g] += w;
+                    break;
+                }
+            }
+
+            slot = (slot+1) & mask;
+        }
+    }
+}
+
+void DedupSink::endBatch()
+{
+    if(numDimensions <= 0)
+        return;
+
+    pendingRows = pending[0].size();
+    for(int d=1; d<numDimensions; d++)
+        pendingRows = std::min(pendingRows,(ElemIndex)pending[d].size());
+
+    pendingHashes.resize(pendingRows);
+    runPhase(PHASE_HASH,numThreads);
+    runPhase(PHASE_AGGREGATE,numThreads);
+
+    numSeen += pendingRows;
+    for(int d=0; d<numDimensions; d++)
+        pending[d].resize(0);
+}
+
+QStringList DedupSink::dimensions() const
+{
+    QStringList dims;
+    for(int k=0; k<keyDims.size(); k++)
+        dims << meta[keyDims[k]];
+    dims << "weight";
+    return dims;
+}
+
+ElemIndex DedupSink::distinct() const
+{
+    ElemIndex n = 0;
+    for(int p=0; p<partitions.size(); p++)
+        n += partitions[p].hashes.size();
+    return n;
+}
+
+struct GroupRef
+{
+    ElemIndex first;
+    int partition;
+    int group;
+
+    bool operator<(const GroupRef &o) const { return first < o.first; }
+};
+
+void DedupSink::finish(QVector<DataColumn> &columns)
+{
+    QVector<GroupRef> groups;
+    for(int p=0; p<partitions.size(); p++)
+    {
+        for(int g=0; g<partitions[p].first.size(); g++)
+        {
+            GroupRef ref;
+            ref.first = partitions[p].first[g];
+            ref.partition = p;
+            ref.group = g;
+            groups.push_back(ref);
+        }
+    }
+    std::sort(groups.begin(),groups.end());
+
+    int numKeys = keyDims.size();
+    QVector<qreal> vals(groups.size());
+
+    columns.resize(numKeys+1);
+    for(int k=0; k<numKeys; k++)
+    {
+        for(int r=0; r<groups.size(); r++)
+        {
+            const Partition &p = partitions[groups[r].partition];
+            vals[r] = p.keys[(ElemIndex)groups[r].group*numKeys + k];
+        }
+        columns[k].append(vals.constData(),vals.size());
+    }
+
+    for(int r=0; r<groups.size(); r++)
+        vals[r] = partitions[groups[r].partition].weights[groups[r].group];
+    columns[numKeys].append(vals.constData(),vals.size());
+}
@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef DEDUPSINK_H
+#define DEDUPSINK_H
+
+#include <QVector>
+#include <QStringList>
+
+#include "sampleparser.h"
+
+// Collapses elements that are equal on every kept dimension into one
+// element, with a "weight" column counting the elements it stands for
+// (summing their weights if the input already has one). Dimensions named
+// in ignore, e.g. "time", are dropped. Each batch is hashed and then
+// aggregated into one hash table per partition, in parallel.
+class DedupSink : public SampleSink
+{
+public:
+    // meta is read once the parser starts
+    DedupSink(const QStringList &meta, QStringList ignore, int threads = 0);
+
+    void begin(int numDimensions);
+    void append(int dim, const qreal *vals, ElemIndex n);
+    void endBatch();
+
+    // Dimensions of finish(), the kept ones in input order and "weight"
+    QStringList dimensions() const;
+
+    // Appends the distinct elements in order of first appearance
+    void finish(QVector<DataColumn> &columns);
+
+    ElemIndex seen() const { return numSeen; }
+    ElemIndex distinct() const;
+
+    // Parallel phases of endBatch()
+    void hashRows(int task);
+    void aggregate(int partition);
+
+private:
+    struct Partition
+    {
+        QVector<qreal> keys;        // numKeys values per group
+        QVector<qreal> weights;
+        QVector<ElemIndex> first;   // input index of the first element
+        QVector<quint64> hashes;
+        QVector<int> table;         // open addressed group indices, -1 empty
+    };
+
+    void runPhase(int phase, int numTasks);
+    void grow(Partition &p);
+
+private:
+    const QStringList &meta;
+    QStringList ignoreNames;
+    int numThreads;
+
+    int numDimensions;
+    QVector<int> keyDims;
+    int weightDim;
+
+    QVector< QVector<qreal> > pending;
+    QVector<quint64> pendingHashes;
+    ElemIndex pendingRows;
+
+    QVector<Partition> partitions;
+    ElemIndex numSeen;
+};
+
+#endif // DEDUPSINK_H
@@ -0,0 +1,581 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "elembitmap.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+#define CHUNK_SHIFT 16
+#define CHUNK_MASK 0xffff
+#define CHUNK_WORDS 1024
+#define ARRAY_MAX 4096
+
+static inline int lowestBit(quint64 w)
+{
+    return qPopulationCount((w & (~w + 1)) - 1);
+}
+
+static int countBits(const QVector<quint64> &bits)
+{
+    int card = 0;
+    for(int w=0; w<bits.size(); w++)
+        card += qPopulationCount(bits.at(w));
+    return card;
+}
+
+bool ElemBitmap::Chunk::contains(quint16 low) const
+{
+    if(dense())
+        return (bits.at(low >> 6) >> (low & 63)) & 1;
+    return std::binary_search(array.constData(),array.constData() + array.size(),low);
+}
+
+void ElemBitmap::Chunk::toBits()
+{
+    bits.fill(0,CHUNK_WORDS);
+    for(int i=0; i<array.size(); i++)
+        bits[array.at(i) >> 6] |= 1ULL << (array.at(i) & 63);
+    array = QVector<quint16>();
+}
+
+void ElemBitmap::Chunk::toArray()
+{
+    array.reserve(card);
+    for(int w=0; w<CHUNK_WORDS; w++)
+    {
+        quint64 word = bits.at(w);
+        while(word)
+        {
+            array.append(w*64 + lowestBit(word));
+            word &= word - 1;
+        }
+    }
+    bits = QVector<quint64>();
+}
+
+// Adds low to the chunk, returning whether it was new
+static bool insertLow(QVector<quint16> &array, quint16 low)
+{
+    if(array.isEmpty() || array.last() < low)
+    {
+        array.append(low);
+        return true;
+    }
+
+    const quint16 *first = array.constData();
+    const quint16 *it = std::lower_bound(first,first + array.size(),low);
+    if(*it == low)
+        return false;
+    array.insert(array.begin() + (it - first),low);
+    return true;
+}
+
+ElemBitmap::ElemBitmap()
+    : count(0)
+{
+}
+
+int ElemBitmap::findChunk(quint64 key) const
+{
+    int lo = 0;
+    int hi = chunks.size();
+    while(lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if(chunks.at(mid).key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if(lo < chunks.size() && chunks.at(lo).key == key)
+        return lo;
+    return -lo - 1;
+}
+
+ElemBitmap::Chunk &ElemBitmap::chunkFor(quint64 key)
+{
+    // Ascending inserts only ever touch the last chunk
+    if(!chunks.isEmpty() && chunks.last().key >= key)
+    {
+        if(chunks.last().key == key)
+            return chunks.last();
+
+        int idx = findChunk(key);
+        if(idx >= 0)
+            return chunks[idx];
+
+        Chunk c;
+        c.key = key;
+        c.card = 0;
+        chunks.insert(chunks.begin() + (-idx - 1),c);
+        return chunks[-idx - 1];
+    }
+
+    Chunk c;
+    c.key = key;
+    c.card = 0;
+    chunks.append(c);
+    return chunks.last();
+}
+
+void ElemBitmap::insert(ElemIndex i)
+{
+    Chunk &c = chunkFor(i >> CHUNK_SHIFT);
+    quint16 low = i & CHUNK_MASK;
+
+    if(c.dense())
+    {
+        quint64 &word = c.bits[low >> 6];
+        quint64 mask = 1ULL << (low & 63);
+        if(word & mask)
+            return;
+        word |= mask;
+    }
+    else
+    {
+        if(!insertLow(c.array,low))
+            return;
+        if(c.array.size() > ARRAY_MAX)
+            c.toBits();
+    }
+
+    c.card++;
+    count++;
+}
+
+// Inserts [first,last)
+void ElemBitmap::insertRange(ElemIndex first, ElemIndex last)
+{
+    while(first < last)
+    {
+        quint64 key = first >> CHUNK_SHIFT;
+        ElemIndex chunkEnd = (key + 1) << CHUNK_SHIFT;
+        int lo = first & CHUNK_MASK;
+        int hi = (int)(std::min(last,chunkEnd) - (key << CHUNK_SHIFT));
+
+        Chunk &c = chunkFor(key);
+        int before = c.card;
+
+        if(!c.dense() && c.card + (hi - lo) > ARRAY_MAX)
+            c.toBits();
+
+        if(c.dense())
+        {
+            for(int b=lo; b<hi; )
+            {
+                int w = b >> 6;
+                int n = std::min(hi - b, 64 - (b & 63));
+                quint64 mask = (n == 64) ? ~0ULL : ((1ULL << n) - 1) << (b & 63);
+                c.bits[w] |= mask;
+                b += n;
+            }
+            c.card = countBits(c.bits);
+            if(c.card <= ARRAY_MAX)
+                c.toArray();
+        }
+        else
+        {
+            for(int b=lo; b<hi; b++)
+                c.card += insertLow(c.array,b);
+        }
+
+        count += c.card - before;
+        first = std::min(last,chunkEnd);
+    }
+}
+
+// Inserts the set bits of a flat bitmap, bit i of words[i/64] being
+// element i
+void ElemBitmap::insertWords(const quint64 *words, ElemIndex numWords)
+{
+    ElemBitmap other;
+    for(ElemIndex first=0; first<numWords; first+=CHUNK_WORDS)
+    {
+        int n = (int)std::min((ElemIndex)CHUNK_WORDS,numWords - first);
+
+        Chunk c;
+        c.key = first / CHUNK_WORDS;
+        c.card = 0;
+        for(int w=0; w<n; w++)
+            c.card += qPopulationCount(words[first + w]);
+        if(c.card == 0)
+            continue;
+
+        c.bits.fill(0,CHUNK_WORDS);
+        std::copy(words + first,words + first + n,c.bits.data());
+        if(c.card <= ARRAY_MAX)
+            c.toArray();
+
+        other.chunks.append(c);
+        other.count += c.card;
+    }
+
+    if(empty())
+        *this = other;
+    else
+        unite(other);
+}
+
+void ElemBitmap::remove(ElemIndex i)
+{
+    int idx = findChunk(i >> CHUNK_SHIFT);
+    if(idx < 0)
+        return;
+
+    Chunk &c = chunks[idx];
+    quint16 low = i & CHUNK_MASK;
+
+    if(c.dense())
+    {
+        quint64 &word = c.bits[low >> 6];
+        quint64 mask = 1ULL << (low & 63);
+        if(!(word & mask))
+            return;
+        word &= ~mask;
+        if(--c.card <= ARRAY_MAX)
+            c.toArray();
+    }
+    else
+    {
+        const quint16 *first = c.array.constData();
+        const quint16 *it = std::lower_bound(first,first + c.array.size(),low);
+        if(it == first + c.array.size() || *it != low)
+            return;
+        c.array.erase(c.array.begin() + (it - first));
+        c.card--;
+    }
+
+    count--;
+    if(c.card == 0)
+        chunks.erase(chunks.begin() + idx);
+}
+
+bool ElemBitmap::contains(ElemIndex i) const
+{
+    int idx = findChunk(i >> CHUNK_SHIFT);
+    if(idx < 0)
+        return false;
+    return chunks.at(idx).contains(i & CHUNK_MASK);
+}
+
+void ElemBitmap::toWords(ElemIndex firstWord, ElemIndex numWords, quint64 *words) const
+{
+    std::fill(words,words + numWords,0);
+
+    ElemIndex lastWord = firstWord + numWords;
+    for(ElemIndex w=firstWord; w<lastWord; /*inc*/)
+    {
+        quint64 key = w / CHUNK_WORDS;
+        ElemIndex chunkBase = key * CHUNK_WORDS;
+        ElemIndex chunkEnd = std::min(chunkBase + CHUNK_WORDS,lastWord);
+
+        int idx = findChunk(key);
+        if(idx >= 0)
+        {
+            const Chunk &c = chunks.at(idx);
+            int lo = w - chunkBase;
+            int hi = chunkEnd - chunkBase;
+
+            if(c.dense())
+            {
+                std::copy(c.bits.constData() + lo,c.bits.constData() + hi,words + (w - firstWord));
+            }
+            else
+            {
+                const quint16 *end = c.array.constData() + c.array.size();
+                const quint16 *it = std::lower_bound(c.array.constData(),end,(quint16)(lo*64));
+                for(/*init*/; it != end && (*it >> 6) < hi; it++)
+                    words[chunkBase + (*it >> 6) - firstWord] |= 1ULL << (*it & 63);
+            }
+        }
+
+        w = chunkEnd;
+    }
+}
+
+void ElemBitmap::clear()
+{
+    chunks.clear();
+    count = 0;
+}
+
+void ElemBitmap::uniteChunk(Chunk &a, const Chunk &b)
+{
+    if(!a.dense() && !b.dense())
+    {
+        QVector<quint16> merged(a.array.size() + b.array.size());
+        const quint16 *pa = a.array.constData();
+        const quint16 *pb = b.array.constData();
+        quint16 *end = std::set_union(pa,pa + a.array.size(),
+                                      pb,pb + b.array.size(),
+                                      merged.data());
+        merged.resize(end - merged.data());
+        a.array = merged;
+        a.card = merged.size();
+        if(a.card > ARRAY_MAX)
+            a.toBits();
+        return;
+    }
+
+    if(!a.dense())
+        a.toBits();
+
+    quint64 *bits = a.bits.data();
+    if(b.dense())
+    {
+        const quint64 *other = b.bits.constData();
+        for(int w=0; w<CHUNK_WORDS; w++)
+            bits[w] |= other[w];
+    }
+    else
+    {
+        for(int i=0; i<b.array.size(); i++)
+            bits[b.array.at(i) >> 6] |= 1ULL << (b.array.at(i) & 63);
+    }
+    a.card = countBits(a.bits);
+}
+
+void ElemBitmap::intersectChunk(Chunk &a, const Chunk &b)
+{
+    if(a.dense() && b.dense())
+    {
+        quint64 *bits = a.bits.data();
+        const quint64 *other = b.bits.constData();
+        for(int w=0; w<CHUNK_WORDS; w++)
+            bits[w] &= other[w];
+        a.card = countBits(a.bits);
+        if(a.card <= ARRAY_MAX)
+            a.toArray();
+        return;
+    }
+
+    // At least one side is sparse, so the result is too
+    const Chunk &sparse = a.dense() ? b : a;
+    const Chunk &other = a.dense() ? a : b;
+    QVector<quint16> kept;
+    kept.reserve(sparse.array.size());
+    for(int i=0; i<sparse.array.size(); i++)
+    {
+        if(other.contains(sparse.array.at(i)))
+            kept.append(sparse.array.at(i));
+    }
+
+    a.bits = QVector<quint64>();
+    a.array = kept;
+    a.card = kept.size();
+}
+
+void ElemBitmap::subtractChunk(Chunk &a, const Chunk &b)
+{
+    if(!a.dense())
+    {
+        QVector<quint16> kept;
+        kept.reserve(a.array.size());
+        for(int i=0; i<a.array.size(); i++)
+        {
+            if(!b.contains(a.array.at(i)))
+                kept.append(a.array.at(i));
+        }
+        a.array = kept;
+        a.card = kept.size();
+        return;
+    }
+
+    quint64 *bits = a.bits.data();
+    if(b.dense())
+    {
+        const quint64 *other = b.bits.constData();
+        for(int w=0; w<CHUNK_WORDS; w++)
+            bits[w] &= ~other[w];
+    }
+    else
+    {
+        for(int i=0; i<b.array.size(); i++)
+            bits[b.array.at(i) >> 6] &= ~(1ULL << (b.array.at(i) & 63));
+    }
+    a.card = countBits(a.bits);
+    if(a.card <= ARRAY_MAX)
+        a.toArray();
+}
+
+ElemBitmap &ElemBitmap::unite(const ElemBitmap &other)
+{
+    QVector<Chunk> result;
+    result.reserve(chunks.size() + other.chunks.size());
+
+    int i = 0;
+    int j = 0;
+    while(i < chunks.size() || j < other.chunks.size())
+    {
+        if(j == other.chunks.size() ||
+           (i < chunks.size() && chunks.at(i).key < other.chunks.at(j).key))
+        {
+            result.append(chunks.at(i++));
+        }
+        else if(i == chunks.size() || other.chunks.at(j).key < chunks.at(i).key)
+        {
+            result.append(other.chunks.at(j++));
+        }
+        else
+        {
+            Chunk c = chunks.at(i++);
+            uniteChunk(c,other.chunks.at(j++));
+            result.append(c);
+        }
+    }
+
+    chunks = result;
+    recount();
+    return *this;
+}
+
+ElemBitmap &ElemBitmap::intersect(const ElemBitmap &other)
+{
+    QVector<Chunk> result;
+
+    int i = 0;
+    int j = 0;
+    while(i < chunks.size() && j < other.chunks.size())
+    {
+        if(chunks.at(i).key < other.chunks.at(j).key)
+        {
+            i++;
+        }
+        else if(other.chunks.at(j).key < chunks.at(i).key)
+        {
+            j++;
+        }
+        else
+        {
+            Chunk c = chunks.at(i++);
+            intersectChunk(c,other.chunks.at(j++));
+            if(c.card > 0)
+                result.append(c);
+        }
+    }
+
+    chunks = result;
+    recount();
+    return *this;
+}
+
+ElemBitmap &ElemBitmap::subtract(const ElemBitmap &other)
+{
+    QVector<Chunk> result;
+    result.reserve(chunks.size());
+
+    int j = 0;
+    for(int i=0; i<chunks.size(); i++)
+    {
+        while(j < other.chunks.size() && other.chunks.at(j).key < chunks.at(i).key)
+            j++;
+
+        if(j < other.chunks.size() && other.chunks.at(j).key == chunks.at(i).key)
+        {
+            Chunk c = chunks.at(i);
+            subtractChunk(c,other.chunks.at(j));
+            if(c.card > 0)
+                result.append(c);
+        }
+        else
+        {
+            result.append(chunks.at(i));
+        }
+    }
+
+    chunks = result;
+    recount();
+    return *this;
+}
+
+void ElemBitmap::recount()
+{
+    count = 0;
+    for(int i=0; i<chunks.size(); i++)
+        count += chunks.at(i).card;
+}
+
+ElemBitmap::const_iterator::const_iterator(const QVector<Chunk> *c, int ci)
+    : chunks(c), chunk(ci), pos(0), value(0)
+{
+    settle();
+}
+
+// Moves forward from (chunk,pos) to the next element, or to end()
+void ElemBitmap::const_iterator::settle()
+{
+    while(chunk < chunks->size())
+    {
+        const Chunk &c = chunks->at(chunk);
+        if(!c.dense())
+        {
+            if(pos < c.array.size())
+            {
+                value = (c.key << CHUNK_SHIFT) | c.array.at(pos);
+                return;
+            }
+        }
+        else
+        {
+            int w = pos >> 6;
+            if(w < CHUNK_WORDS)
+            {
+                quint64 word = c.bits.at(w) & (~0ULL << (pos & 63));
+                while(!word && ++w < CHUNK_WORDS)
+                    word = c.bits.at(w);
+                if(word)
+                {
+                    pos = w*64 + lowestBit(word);
+                    value = (c.key << CHUNK_SHIFT) | (quint64)pos;
+                    return;
+                }
+            }
+        }
+
+        chunk++;
+        pos = 0;
+    }
+}
+
+void ElemBitmap::const_iterator::advance()
+{
+    pos++;
+    settle();
+}
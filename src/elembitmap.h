@@ -0,0 +1,134 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef ELEMBITMAP_H
+#define ELEMBITMAP_H
+
+#include <QtGlobal>
+#include <QVector>
+
+#include "datacolumn.h"
+
+// Compressed set of element indices. Indices are split into 2^16-wide
+// chunks by their high bits; sparse chunks keep a sorted array of the low
+// 16 bits and dense chunks a 65536-bit bitmap, so large selections cost
+// at most one bit per element.
+class ElemBitmap
+{
+private:
+    struct Chunk
+    {
+        quint64 key;
+        int card;
+        QVector<quint16> array;
+        QVector<quint64> bits;
+
+        bool dense() const { return !bits.isEmpty(); }
+        bool contains(quint16 low) const;
+        void toBits();
+        void toArray();
+    };
+
+public:
+    ElemBitmap();
+
+    void insert(ElemIndex i);
+    void insertRange(ElemIndex first, ElemIndex last);
+    void insertWords(const quint64 *words, ElemIndex numWords);
+    void remove(ElemIndex i);
+    bool contains(ElemIndex i) const;
+
+    // Writes words [firstWord,firstWord+numWords) of the set as a flat bitmap
+    void toWords(ElemIndex firstWord, ElemIndex numWords, quint64 *words) const;
+
+    ElemIndex size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear();
+
+    ElemBitmap &unite(const ElemBitmap &other);
+    ElemBitmap &intersect(const ElemBitmap &other);
+    ElemBitmap &subtract(const ElemBitmap &other);
+
+    // Forward iteration in increasing index order
+    class const_iterator
+    {
+    public:
+        const_iterator() : chunks(NULL), chunk(0), pos(0), value(0) {}
+
+        ElemIndex operator*() const { return value; }
+        const_iterator &operator++() { advance(); return *this; }
+        const_iterator operator++(int) { const_iterator t = *this; advance(); return t; }
+
+        bool operator==(const const_iterator &o) const
+        { return chunk == o.chunk && pos == o.pos; }
+        bool operator!=(const const_iterator &o) const { return !(*this == o); }
+
+    private:
+        friend class ElemBitmap;
+        const_iterator(const QVector<Chunk> *c, int ci);
+
+        void settle();
+        void advance();
+
+        const QVector<Chunk> *chunks;
+        int chunk;
+        int pos;
+        ElemIndex value;
+    };
+    typedef const_iterator iterator;
+
+    const_iterator begin() const { return const_iterator(&chunks,0); }
+    const_iterator end() const { return const_iterator(&chunks,chunks.size()); }
+
+private:
+    int findChunk(quint64 key) const;
+    Chunk &chunkFor(quint64 key);
+    void recount();
+
+    static void uniteChunk(Chunk &a, const Chunk &b);
+    static void intersectChunk(Chunk &a, const Chunk &b);
+    static void subtractChunk(Chunk &a, const Chunk &b);
+
+private:
+    QVector<Chunk> chunks;
+    ElemIndex count;
+};
+
+typedef ElemBitmap ElemSet;
+
+#endif // ELEMBITMAP_H
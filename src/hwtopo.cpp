@@ -54,6 +54,22 @@ hwTopo::hwTopo()
     hardwareResourceRoot = NULL;
 }
 
+hwTopo::~hwTopo()
+{
+    deleteNode(hardwareResourceRoot);
+}
+
+// Nodes own their children, including those of a partly read file
+void hwTopo::deleteNode(hwNode *node)
+{
+    if(node == NULL)
+        return;
+
+    for(int i=0; i<node->children.size(); i++)
+        deleteNode(node->children[i]);
+    delete node;
+}
+
 hwNode *hwTopo::hardwareResourceNodeFromXMLNode(QXmlStreamReader *xml, hwNode *parent)
 {
     hwNode *newLevel = new hwNode();
@@ -89,13 +105,13 @@ hwNode *hwTopo::hardwareResourceNodeFromXMLNode(QXmlStreamReader *xml, hwNode *p
 
 int hwTopo::loadHardwareTopologyFromXML(QString fileName)
 {
-    QFile* file = new QFile(fileName);
+    QFile file(fileName);
 
-    if (!file->open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
         return -1;
     }
 
-    QXmlStreamReader xml(file);
+    QXmlStreamReader xml(&file);
     while(!xml.atEnd() && !xml.hasError())
     {
         xml.readNext();
@@ -105,14 +121,17 @@ int hwTopo::loadHardwareTopologyFromXML(QString fileName)
 
         if(xml.isStartElement())
             if(xml.name() == "Hardware")
+            {
+                deleteNode(hardwareResourceRoot);
                 hardwareResourceRoot = hardwareResourceNodeFromXMLNode(&xml,NULL);
+            }
     }
 
     if(xml.hasError()) {
         return -1;
     }
 
-    file->close();
+    file.close();
     xml.clear();
 
     processLoadedTopology();
@@ -46,18 +46,21 @@
 #include <vector>
 
 #include "dataobject.h"
+#include "elembitmap.h"
 
 class DataObject;
 
 typedef unsigned long long ElemIndex;
-typedef std::set<ElemIndex> ElemSet;
 
 struct SampleSet
 {
-    int totCycles;
-    int selCycles;
+    // Weighted estimates over the whole data set, which can pass 2^31
+    qint64 totCycles;
+    qint64 selCycles;
     ElemSet totSamples;
     ElemSet selSamples;
+    QVector<qint64> groupCycles;    // per selection group, 0 is unselected
+    QVector<int> groupSamples;
 };
 
 class hwNode
@@ -82,6 +85,7 @@ class hwTopo
 {
 public:
     hwTopo();
+    ~hwTopo();
 
     hwNode *hardwareResourceNodeFromXMLNode(QXmlStreamReader *xml, hwNode *parent);
     int loadHardwareTopologyFromXML(QString fileName);
@@ -104,6 +108,7 @@ public:
     QMap<int,hwNode*> NUMAIDMap;
 
 private:
+    static void deleteNode(hwNode *node);
     void processLoadedTopology();
     void constructHardwareResourceMatrix();
     void addToMatrix(hwNode *node);
@@ -88,6 +88,11 @@ void HWTopoVizWidget::processData()
 {
     processed = false;
 
+    // The boxes point into the previous data set's topology
+    nodeBoxes.clear();
+    linkBoxes.clear();
+    widthRange.clear();
+
     if(dataSet->getTopo() == NULL)
         return;
 
@@ -217,7 +222,7 @@ void HWTopoVizWidget::mouseMoveEvent(QMouseEvent* e)
 
         label += "\n";
 
-        int numCycles = 0;
+        qint64 numCycles = 0;
         int numSamples = 0;
         numSamples += node->sampleSets[dataSet].selSamples.size();
         numCycles += node->sampleSets[dataSet].selCycles;
@@ -228,6 +233,22 @@ void HWTopoVizWidget::mouseMoveEvent(QMouseEvent* e)
         label += "\n";
         label += "Cycles/Access: " + QString::number((float)numCycles / (float)numSamples) + "\n";
 
+        if(dataSet->numSelectionGroups() > 2)
+        {
+            const SampleSet &set = node->sampleSets[dataSet];
+
+            label += "\n";
+            for(int g=1; g<set.groupSamples.size(); g++)
+            {
+                if(set.groupSamples[g] == 0)
+                    continue;
+
+                label += "Group " + QString::number(g) + ": "
+                        + QString::number(set.groupSamples[g]) + " samples, "
+                        + QString::number(set.groupCycles[g]) + " cycles\n";
+            }
+        }
+
         QToolTip::showText(e->globalPos(),label,this, rect() );
     }
     else
@@ -270,9 +291,9 @@ void HWTopoVizWidget::calcMinMaxes()
                 continue;
 
             ElemSet &samples = node->sampleSets[dataSet].selSamples;
-            int *numCycles = &node->sampleSets[dataSet].selCycles;
+            qint64 *numCycles = &node->sampleSets[dataSet].selCycles;
 
-            qreal val = (dataMode == COLORBY_CYCLES) ? *numCycles : samples.size();
+            qreal val = (dataMode == COLORBY_CYCLES) ? (qreal)*numCycles : (qreal)samples.size();
             //val = (qreal)(*numCycles) / (qreal)samples->size();
 
             depthValRanges[i].first=0;//min(depthValRanges[i].first,val);
@@ -323,7 +344,7 @@ void HWTopoVizWidget::constructNodeBoxes(QRectF rect,
                            deltaY);
 
             // Get value by cycles or samples
-            int numCycles = 0;
+            qint64 numCycles = 0;
             int numSamples = 0;
             numSamples += nb.node->sampleSets[dataSet].selSamples.size();
             numCycles += nb.node->sampleSets[dataSet].selCycles;
@@ -0,0 +1,104 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef LOADPROGRESS_H
+#define LOADPROGRESS_H
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+
+enum load_stage
+{
+    LOAD_IDLE = 0,
+    LOAD_TOPOLOGY,
+    LOAD_PARSE,
+    LOAD_STATISTICS,
+    LOAD_INDEXES,
+    LOAD_VIEWS,
+    LOAD_DONE
+};
+
+// Returned by the load steps when they stop early on a cancel
+#define LOAD_CANCELLED -2
+
+// Shared between a loading thread, which advances it, and the GUI,
+// which polls it and may ask the load to stop
+class LoadProgress
+{
+public:
+    LoadProgress() : stg(LOAD_IDLE), doneCount(0), totalCount(0), cancelFlag(0) {}
+
+    // total of 0 means unknown
+    void setStage(load_stage s, qint64 total = 0)
+    {
+        doneCount.store(0);
+        totalCount.store(total);
+        stg.store(s);
+    }
+    void advance(qint64 n) { doneCount.fetchAndAddRelaxed(n); }
+
+    void cancel() { cancelFlag.store(1); }
+    bool cancelled() const { return cancelFlag.load() != 0; }
+
+    load_stage stage() const { return (load_stage)stg.load(); }
+    qint64 done() const { return doneCount.load(); }
+    qint64 total() const { return totalCount.load(); }
+
+    static const char *stageName(load_stage s)
+    {
+        switch(s)
+        {
+            case(LOAD_IDLE):       return "Idle";
+            case(LOAD_TOPOLOGY):   return "Loading topology";
+            case(LOAD_PARSE):      return "Parsing samples";
+            case(LOAD_STATISTICS): return "Computing statistics";
+            case(LOAD_INDEXES):    return "Building indexes";
+            case(LOAD_VIEWS):      return "Preparing views";
+            case(LOAD_DONE):       return "Done";
+        }
+        return "";
+    }
+
+private:
+    QAtomicInt stg;
+    QAtomicInteger<qint64> doneCount;
+    QAtomicInteger<qint64> totalCount;
+    QAtomicInt cancelFlag;
+};
+
+#endif // LOADPROGRESS_H
@@ -38,16 +38,26 @@
 
 #include "ui_form.h"
 #include "mainwindow.h"
+#include "samplestream.h"
 
 #include <iostream>
 using namespace std;
 
 #include <QTimer>
 #include <QFileDialog>
+#include <QInputDialog>
+#include <QFile>
+
+#include <limits.h>
+
+// Shortest time between view refreshes with appended samples in follow mode
+#define FOLLOW_INTERVAL_MS 250
+
+// Preset of the downsampling dialog
+#define DEFAULT_SAMPLE_SIZE 1000000
 
 // NEW FEATURES
 // Mem topo 1d memory range
-// Multiple selections, selection groups (classification)
 
 // APPLICATIONS
 // LibNUMA (move_pages(x,x,NULL,...)
@@ -61,6 +71,8 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->menuBar->setNativeMenuBar(true);
 
     dataSet = new DataObject();
+    loader = NULL;
+    loadStage = LOAD_IDLE;
 
     con = new console(this);
     ui->consoleLayout->addWidget(con);
@@ -80,11 +92,47 @@ MainWindow::MainWindow(QWidget *parent) :
     // File buttons
     connect(ui->actionImport_Data, SIGNAL(triggered()),this,SLOT(loadData()));
 
+    // Follow mode
+    followAction = ui->menuFile->addAction(tr("Follow Data"));
+    followAction->setCheckable(true);
+    followWatcher = new QFileSystemWatcher(this);
+    followTimer = new QTimer(this);
+    followTimer->setInterval(FOLLOW_INTERVAL_MS);
+    followPending = false;
+
+    connect(followAction, SIGNAL(toggled(bool)), this, SLOT(setFollow(bool)));
+    connect(followWatcher, SIGNAL(fileChanged(QString)), this, SLOT(followFileChanged()));
+    connect(followTimer, SIGNAL(timeout()), this, SLOT(followUpdate()));
+
+    // Downsampling
+    samplingMode = SAMPLING_NONE;
+    sampleSize = DEFAULT_SAMPLE_SIZE;
+    QAction *samplingAction = ui->menuFile->addAction(tr("Downsample on Load..."));
+    connect(samplingAction, SIGNAL(triggered()), this, SLOT(selectSampling()));
+
+    // Deduplication
+    dedupIgnore << "time";
+    dedupAction = ui->menuFile->addAction(tr("Deduplicate on Load..."));
+    dedupAction->setCheckable(true);
+    connect(dedupAction, SIGNAL(toggled(bool)), this, SLOT(setDeduplicate(bool)));
+
     // Selection mode
     connect(ui->selectModeXOR, SIGNAL(toggled(bool)), this, SLOT(setSelectModeXOR(bool)));
     connect(ui->selectModeOR, SIGNAL(toggled(bool)), this, SLOT(setSelectModeOR(bool)));
     connect(ui->selectModeAND, SIGNAL(toggled(bool)), this, SLOT(setSelectModeAND(bool)));
 
+    // Selection groups
+    QAction *groupAction = ui->menuFile->addAction(tr("Selection Group..."));
+    connect(groupAction, SIGNAL(triggered()), this, SLOT(selectGroup()));
+
+    // Selection history
+    QAction *undoAction = ui->menuFile->addAction(tr("Undo Selection"));
+    undoAction->setShortcut(QKeySequence::Undo);
+    connect(undoAction, SIGNAL(triggered()), this, SLOT(undoSelection()));
+    QAction *redoAction = ui->menuFile->addAction(tr("Redo Selection"));
+    redoAction->setShortcut(QKeySequence::Redo);
+    connect(redoAction, SIGNAL(triggered()), this, SLOT(redoSelection()));
+
     // Selection buttons
     connect(ui->selectAll, SIGNAL(clicked()), this, SLOT(selectAll()));
     connect(ui->deselectAll, SIGNAL(clicked()), this, SLOT(deselectAll()));
@@ -95,6 +143,17 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->showSelectedOnly, SIGNAL(clicked()), this, SLOT(showSelectedOnly()));
     connect(ui->showAll, SIGNAL(clicked()), this, SLOT(showAll()));
 
+    // Load progress
+    loadProgressBar = new QProgressBar(this);
+    loadProgressBar->setMaximumWidth(240);
+    loadProgressBar->hide();
+    loadCancelButton = new QPushButton(tr("Cancel"),this);
+    loadCancelButton->hide();
+    ui->statusBar->addPermanentWidget(loadProgressBar);
+    ui->statusBar->addPermanentWidget(loadCancelButton);
+
+    connect(loadCancelButton, SIGNAL(clicked()), this, SLOT(cancelLoad()));
+
     /*
      * Code Viz
      */
@@ -169,6 +228,7 @@ MainWindow::MainWindow(QWidget *parent) :
     dataSet->setConsole(con);
 
     connect(con, SIGNAL(selectionChangedSig()), this, SLOT(selectionChangedSlot()));
+    connect(con, SIGNAL(visibilityChangedSig()), this, SLOT(visibilityChangedSlot()));
 
     for(int i=0; i<vizWidgets.size(); i++)
     {
@@ -186,10 +246,18 @@ MainWindow::MainWindow(QWidget *parent) :
 
 MainWindow::~MainWindow()
 {
+    if(loader)
+    {
+        loader->cancel();
+        delete loader;
+    }
 }
 
 void MainWindow::frameUpdateAll()
 {
+    if(loader)
+        updateLoadProgress();
+
     for(int i=0; i<vizWidgets.size(); i++)
     {
         vizWidgets[i]->frameUpdate();
@@ -200,6 +268,9 @@ void MainWindow::selectionChangedSlot()
 {
     dataSet->selectionChanged();
     emit selectionChangedSig();
+
+    // Every view has applied the changes
+    dataSet->clearSelectionDelta();
 }
 
 void MainWindow::visibilityChangedSlot()
@@ -219,38 +290,250 @@ int MainWindow::loadData()
 {
     int err = 0;
 
+    if(loader)
+    {
+        con->log("A data set is already loading");
+        return -1;
+    }
+
     err = selectDataDirectory();
     if(err != 0)
         return err;
 
-    QString sourceDir(dataDir+QString("/src/"));
-    codeViz->setSourceDir(sourceDir);
-
     QString topoDir(dataDir+QString("/hardware.xml"));
-    err = dataSet->loadHardwareTopology(topoDir);
-    if(err != 0)
+
+    // Plain samples if present, otherwise a compressed copy, otherwise
+    // every sample file in the directory (e.g. one per rank)
+    QString dataSetDir(dataDir+QString("/data/samples.out"));
+    const char *compressed[] = { ".zst", ".gz" };
+    for(int i=0; i<2 && !QFile::exists(dataSetDir); i++)
     {
-        errdiag("Error loading hardware: "+topoDir);
-        return err;
+        if(QFile::exists(dataSetDir+compressed[i]))
+            dataSetDir += compressed[i];
     }
+    if(!QFile::exists(dataSetDir))
+        dataSetDir = dataDir+QString("/data");
 
-    QString dataSetDir(dataDir+QString("/data/samples.out"));
-    err = dataSet->loadData(dataSetDir);
+    loader = new DataLoader(topoDir,dataSetDir,con,this);
+    loader->setSampling(samplingMode,sampleSize);
+    loader->setDeduplicate(dedupAction->isChecked(),dedupIgnore);
+    connect(loader, SIGNAL(finished()), this, SLOT(loadFinished()));
+
+    loadStage = LOAD_IDLE;
+    loadProgressBar->setRange(0,0);
+    loadProgressBar->show();
+    loadCancelButton->setEnabled(true);
+    loadCancelButton->show();
+
+    loader->start();
+
+    return 0;
+}
+
+void MainWindow::cancelLoad()
+{
+    if(!loader)
+        return;
+
+    loader->cancel();
+    loadCancelButton->setEnabled(false);
+    con->log("Cancelling load...");
+}
+
+void MainWindow::updateLoadProgress()
+{
+    LoadProgress *progress = loader->getProgress();
+
+    load_stage stage = progress->stage();
+    if(stage != loadStage)
+    {
+        loadStage = stage;
+        loadProgressBar->setFormat(QString(LoadProgress::stageName(stage))+" %p%");
+        con->log(QString(LoadProgress::stageName(stage))+"...");
+    }
+
+    // Busy indicator when the total is unknown (e.g. compressed input)
+    qint64 total = progress->total();
+    if(total <= 0)
+    {
+        loadProgressBar->setRange(0,0);
+        return;
+    }
+
+    loadProgressBar->setRange(0,1000);
+    loadProgressBar->setValue((int)(1000*qMin(progress->done(),total)/total));
+}
+
+void MainWindow::loadFinished()
+{
+    int err = loader->error();
+    QString errStr = loader->errorString();
+    DataObject *newDataSet = loader->takeDataSet();
+
+    if(err == 0)
+    {
+        // Widgets are not thread safe, so they switch over and prepare
+        // their views here
+        loadStage = LOAD_VIEWS;
+        loadProgressBar->setRange(0,0);
+
+        DataObject *oldDataSet = dataSet;
+        dataSet = newDataSet;
+        newDataSet = NULL;
+
+        con->setDataSet(dataSet);
+        for(int i=0; i<vizWidgets.size(); i++)
+            vizWidgets[i]->setDataSet(dataSet);
+
+        delete oldDataSet;
+
+        QString sourceDir(dataDir+QString("/src/"));
+        codeViz->setSourceDir(sourceDir);
+
+        for(int i=0; i<vizWidgets.size(); i++)
+        {
+            vizWidgets[i]->processData();
+            vizWidgets[i]->update();
+        }
+
+        // The loader already collected the topology samples
+        emit visibilityChangedSig();
+
+        setFollow(followAction->isChecked());
+
+        con->log("Load complete");
+    }
+    else if(err == LOAD_CANCELLED)
+    {
+        con->log("Load cancelled");
+    }
+
+    // Partial data from a failed or cancelled load
+    delete newDataSet;
+
+    loadProgressBar->hide();
+    loadCancelButton->hide();
+
+    loader->deleteLater();
+    loader = NULL;
+    loadStage = LOAD_IDLE;
+
+    if(err != 0 && err != LOAD_CANCELLED)
+        errdiag(errStr);
+}
+
+void MainWindow::setFollow(bool on)
+{
+    QStringList watched = followWatcher->files();
+    if(!watched.isEmpty())
+        followWatcher->removePaths(watched);
+
+    followTimer->stop();
+    followPending = false;
+
+    if(!on || dataSet->empty())
+        return;
+
+    QString fileName = dataSet->dataFileName();
+    if(isCompressedSampleFile(fileName))
+    {
+        con->log("Follow mode needs an uncompressed samples file");
+        return;
+    }
+
+    followWatcher->addPath(fileName);
+    followTimer->start();
+
+    // Catch up on anything written since the load
+    followPending = true;
+
+    con->log("Following "+fileName);
+}
+
+void MainWindow::followFileChanged()
+{
+    followPending = true;
+}
+
+void MainWindow::followUpdate()
+{
+    if(!followPending || loader)
+        return;
+
+    followPending = false;
+
+    ElemIndex first;
+    int err = dataSet->followData(first);
     if(err != 0)
     {
-        errdiag("Error loading dataset: "+dataSetDir);
-        return err;
+        con->log("Stopped following "+dataSet->dataFileName());
+        followAction->setChecked(false);
+        return;
     }
 
+    if(first == dataSet->numElements)
+        return;
+
     for(int i=0; i<vizWidgets.size(); i++)
+        vizWidgets[i]->dataAppended(first);
+}
+
+void MainWindow::selectSampling()
+{
+    QStringList modes;
+    modes << tr("All samples")
+          << tr("Uniform reservoir sample")
+          << tr("Stratified by cpu and data source");
+
+    bool ok;
+    QString mode = QInputDialog::getItem(this,tr("Downsample on Load"),tr("Samples to load:"),
+                                         modes,samplingMode,false,&ok);
+    if(!ok)
+        return;
+
+    sampling_mode m = (sampling_mode)modes.indexOf(mode);
+    if(m != SAMPLING_NONE)
     {
-        vizWidgets[i]->processData();
-        vizWidgets[i]->update();
+        QString label = (m == SAMPLING_STRATIFIED) ? tr("Samples per stratum:") : tr("Samples:");
+        int size = QInputDialog::getInt(this,tr("Downsample on Load"),label,
+                                        sampleSize,1,INT_MAX,1,&ok);
+        if(!ok)
+            return;
+        sampleSize = size;
     }
 
-    visibilityChangedSlot();
+    samplingMode = m;
+    if(samplingMode == SAMPLING_NONE)
+        con->log("Loading all samples");
+    else
+        con->log(QString("Loading at most %1 samples%2").arg(sampleSize)
+                 .arg(samplingMode == SAMPLING_STRATIFIED ? " per cpu and data source" : ""));
+}
 
-    return 0;
+void MainWindow::setDeduplicate(bool on)
+{
+    if(!on)
+    {
+        con->log("Loading samples without deduplication");
+        return;
+    }
+
+    bool ok;
+    QString ignore = QInputDialog::getText(this,tr("Deduplicate on Load"),
+                                           tr("Dimensions to ignore (comma separated):"),
+                                           QLineEdit::Normal,dedupIgnore.join(","),&ok);
+    if(!ok)
+    {
+        dedupAction->setChecked(false);
+        return;
+    }
+
+    dedupIgnore = ignore.split(',',QString::SkipEmptyParts);
+    for(int i=0; i<dedupIgnore.size(); i++)
+        dedupIgnore[i] = dedupIgnore[i].trimmed();
+
+    con->log("Deduplicating samples on load, ignoring "
+             + (dedupIgnore.isEmpty() ? QString("nothing") : dedupIgnore.join(",")));
 }
 
 int MainWindow::selectDataDirectory()
@@ -304,6 +587,28 @@ void MainWindow::hideSelected()
     visibilityChangedSlot();
 }
 
+void MainWindow::undoSelection()
+{
+    if(dataSet->undoSelection())
+        selectionChangedSlot();
+}
+
+void MainWindow::redoSelection()
+{
+    if(dataSet->redoSelection())
+        selectionChangedSlot();
+}
+
+void MainWindow::selectGroup()
+{
+    bool ok;
+    int group = QInputDialog::getInt(this,tr("Selection Group"),
+                                     tr("Group for new selections:"),
+                                     dataSet->currentGroup(),1,MAX_SELECTION_GROUPS,1,&ok);
+    if(ok)
+        dataSet->setCurrentGroup(group);
+}
+
 void MainWindow::setSelectModeAND(bool on)
 {
     if(on)
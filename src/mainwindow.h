@@ -42,6 +42,9 @@
 #include <QMainWindow>
 #include <QErrorMessage>
 #include <QTimer>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QFileSystemWatcher>
 
 #include <QVector>
 
@@ -54,6 +57,7 @@
 #include "hwtopo.h"
 #include "codeeditor.h"
 #include "console.h"
+#include "dataloader.h"
 
 //#include "volumevizwidget.h"
 
@@ -78,6 +82,13 @@ public slots:
     void selectionChangedSlot();
     void visibilityChangedSlot();
     int loadData();
+    void loadFinished();
+    void cancelLoad();
+    void setFollow(bool on);
+    void selectSampling();
+    void setDeduplicate(bool on);
+    void followFileChanged();
+    void followUpdate();
     int selectDataDirectory();
     void showSelectedOnly();
     void showAll();
@@ -85,11 +96,17 @@ public slots:
     void selectAllVisible();
     void selectAll();
     void deselectAll();
+    void selectGroup();
+    void undoSelection();
+    void redoSelection();
     void setSelectModeAND(bool on);
     void setSelectModeOR(bool on);
     void setSelectModeXOR(bool on);
     void setCodeLabel(QFile *file);
 
+private:
+    void updateLoadProgress();
+
 private:
     Ui::MainWindow *ui;
 
@@ -106,6 +123,25 @@ private:
     QString dataDir;
     DataObject *dataSet;
     console *con;
+
+    DataLoader *loader;
+    load_stage loadStage;
+    QProgressBar *loadProgressBar;
+    QPushButton *loadCancelButton;
+
+    // Follow mode, appended samples are picked up at a bounded rate
+    QAction *followAction;
+    QFileSystemWatcher *followWatcher;
+    QTimer *followTimer;
+    bool followPending;
+
+    // Downsampling of the next load
+    sampling_mode samplingMode;
+    int sampleSize;
+
+    // Deduplication of the next load
+    QAction *dedupAction;
+    QStringList dedupIgnore;
 };
 
 #endif // MAINWINDOW_H
@@ -37,96 +37,249 @@
 //////////////////////////////////////////////////////////////////////////////
 
 #include "parseUtil.h"
+#include "datasource.h"
 
-size_t createUniqueID(QVector<QString> &existing, QString name)
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+size_t createUniqueID(StringDict &existing, QString name)
+{
+    return existing.intern(name);
+}
+
+size_t createUniqueID(StringDict &existing, const char *name, int len)
+{
+    return existing.intern(name,len);
+}
+
+const char *findLineEnd(const char *p, const char *end)
+{
+    const char *eol = (const char*)memchr(p,'\n',end-p);
+    return (eol == NULL) ? end : eol;
+}
+
+const char *nextLine(const char *eol, const char *end)
+{
+    return (eol < end) ? eol+1 : end;
+}
+
+const char *trimCR(const char *begin, const char *eol)
+{
+    if(eol > begin && *(eol-1) == '\r')
+        return eol-1;
+    return eol;
+}
+
+qint64 countLines(const char *p, const char *end)
 {
-    for(int i=0; i<existing.size(); i++)
+    qint64 lines = 0;
+    while(p < end)
     {
-        if(existing[i] == name)
-            return i;
+        const char *eol = findLineEnd(p,end);
+        lines++;
+        p = nextLine(eol,end);
     }
-    existing.push_back(name);
-    return existing.size()-1;
+    return lines;
 }
 
-int dseDepth(int enc)
+static inline int digitValue(char c)
+{
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'z') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'Z') return c - 'A' + 10;
+    return 99;
+}
+
+// Same semantics as QString::toLongLong(NULL,base): surrounding whitespace is
+// ignored, and anything that is not a valid number returns 0
+qlonglong tokToLongLong(const char *begin, const char *end, int base)
 {
-    int src = enc & 0xF;
-    switch(src)
+    while(begin < end && isspace((unsigned char)*begin))
+        begin++;
+    while(end > begin && isspace((unsigned char)*(end-1)))
+        end--;
+
+    bool neg = false;
+    if(begin < end && (*begin == '-' || *begin == '+'))
     {
-        case(0x0): return -1; // at least L3
-        case(0x1): return 1; // L1
-        case(0x2): return 1; // cache hit pending (don't draw)
-        case(0x3): return 2; // L2
-        case(0x4): return 3; // L3
-        case(0x5): return 3; // from another core L2/L1 (clean)
-        case(0x6): return 3; // from another core L2/L1 (dirty)
-        case(0x7): return -1; // no LLC now
-        case(0x8): return 4; // local ram?
-        case(0x9): return -1; // reserved (shouldn't happen)
-        case(0xA): return 4; // local RAM (clean)
-        case(0xB): return 4; // remote RAM (clean)
-        case(0xC): return 4; // local RAM (dirty)
-        case(0xD): return 4; // remote RAM (dirty)
-        case(0xE): return -1; // I/O
-        case(0xF): return -1; // Uncacheable
+        neg = (*begin == '-');
+        begin++;
     }
 
-    return -1;
+    if(base == 16 && end-begin > 2 && begin[0] == '0' && (begin[1] == 'x' || begin[1] == 'X'))
+        begin += 2;
+
+    if(begin == end)
+        return 0;
+
+    unsigned long long val = 0;
+    unsigned long long limit = neg ? 9223372036854775808ULL : 9223372036854775807ULL;
+    for(/*begin*/; begin < end; begin++)
+    {
+        int d = digitValue(*begin);
+        if(d >= base)
+            return 0;
+        if(val > (limit - d) / base)
+            return 0; // overflow
+        val = val*base + d;
+    }
+
+    return neg ? (qlonglong)(0-val) : (qlonglong)val;
 }
 
-int dseDirty(int enc)
+int tokToInt(const char *begin, const char *end, int base)
 {
-    int src = enc & 0xF;
-    switch(src)
+    qlonglong val = tokToLongLong(begin,end,base);
+    if(val < INT_MIN || val > INT_MAX)
+        return 0;
+    return (int)val;
+}
+
+// Fast paths for plain digit strings. Digits are accumulated without
+// branching and validated once at the end; anything else (signs, spaces,
+// prefixes, long tokens) falls back to tokToLongLong.
+#define MAX_FAST_DECIMAL_DIGITS 18
+#define MAX_FAST_HEX_DIGITS 15
+
+qlonglong parseDecimal(const char *begin, const char *end)
+{
+    if(begin == end || end-begin > MAX_FAST_DECIMAL_DIGITS)
+        return tokToLongLong(begin,end,10);
+
+    unsigned long long val = 0;
+    unsigned bad = 0;
+    for(const char *p=begin; p<end; p++)
     {
-        case(0x5): return 0; // from another core L2/L1 (clean)
-        case(0x6): return 1; // from another core L2/L1 (dirty)
-        case(0xA): return 0; // local RAM (clean)
-        case(0xB): return 0; // remote RAM (clean)
-        case(0xC): return 1; // local RAM (dirty)
-        case(0xD): return 1; // remote RAM (dirty)
+        unsigned d = (unsigned char)*p - '0';
+        bad |= (d > 9);
+        val = val*10 + d;
     }
 
-    // N/A
-    return -1;
+    return bad ? tokToLongLong(begin,end,10) : (qlonglong)val;
 }
 
+struct HexTable
+{
+    unsigned char digit[256];
 
-std::string encToString(int enc)
+    HexTable()
+    {
+        for(int c=0; c<256; c++)
+        {
+            int d = digitValue(c);
+            digit[c] = (d < 16) ? d : 0xFF;
+        }
+    }
+};
+
+static const HexTable hexTable;
+
+qlonglong parseHex(const char *begin, const char *end)
 {
-    int src = enc & 0xF;
+    if(begin == end || end-begin > MAX_FAST_HEX_DIGITS)
+        return tokToLongLong(begin,end,16);
 
-    switch(src)
+    qlonglong val = 0;
+    unsigned bad = 0;
+    for(const char *p=begin; p<end; p++)
     {
-        case(0x0): return "Unknown L3 Miss";
-        case(0x1): return "L1";
-        case(0x2): return "TLB";
-        case(0x3): return "L2";
-        case(0x4): return "L3";
-        case(0x5): return "L3 Snoop (clean)"; // from another core L2/L1
-        case(0x6): return "L3 Snoop (dirty)"; // from another core L2/L1
-        case(0x7): return "LLC Snoop (dirty)";
-        case(0x8): return "L3 Miss (dirty)"; // local ram?
-        case(0x9): return "MONKEYS"; // reserved (shouldn't happen)
-        case(0xA): return "Local RAM";
-        case(0xB): return "Remote RAM";
-        case(0xC): return "Local RAM";
-        case(0xD): return "Remote RAM";
-        case(0xE): return "I/O";
-        case(0xF): return "Uncacheable";
+        unsigned d = hexTable.digit[(unsigned char)*p];
+        bad |= d;
+        val = (val << 4) | (d & 0xF);
     }
 
-    return "???"; // really weird
+    return (bad & 0xF0) ? tokToLongLong(begin,end,16) : val;
 }
 
+// Intel PEBS encodings, see datasource.cpp for the table
+int dseDepth(int enc)
+{
+    return dataSourceDecoder(DSE_INTEL_PEBS).info(enc).depth;
+}
+
+int dseDirty(int enc)
+{
+    return dataSourceDecoder(DSE_INTEL_PEBS).info(enc).dirty;
+}
+
+std::string encToString(int enc)
+{
+    return dataSourceDecoder(DSE_INTEL_PEBS).info(enc).label;
+}
 
 int dseSTLB(int enc)
 {
-    return enc & 0x10;
+    return dataSourceDecoder(DSE_INTEL_PEBS).info(enc).stlbMiss;
 }
 
 int dseLocked(int enc)
 {
-    return enc & 0x20;
+    return dataSourceDecoder(DSE_INTEL_PEBS).info(enc).locked;
+}
+
+// Fields of perf_mem_data_src (linux/perf_event.h)
+#define PERF_MEM_LVL(d)      (((d) >> 5) & 0x3FFF)
+#define PERF_MEM_SNOOP(d)    (((d) >> 19) & 0x1F)
+#define PERF_MEM_LOCK(d)     (((d) >> 24) & 0x3)
+#define PERF_MEM_TLB(d)      (((d) >> 26) & 0x7F)
+#define PERF_MEM_LVLNUM(d)   (((d) >> 33) & 0xF)
+#define PERF_MEM_REMOTE(d)   (((d) >> 37) & 0x1)
+
+int perfDataSrcToEnc(quint64 dataSrc)
+{
+    int lvl = PERF_MEM_LVL(dataSrc);
+    int snoop = PERF_MEM_SNOOP(dataSrc);
+    bool hitm = snoop & 0x10;
+    bool snoopHit = snoop & 0x4;
+    int enc = 0x0;
+
+    // A level marked as missed, without a hit, is where the access
+    // missed and not where it was served, which is unknown
+    bool missed = (lvl & 0x4) && !(lvl & 0x2);
+
+    if(missed)
+        enc = 0x0;
+    else if(lvl & 0x8)       // L1
+        enc = 0x1;
+    else if(lvl & 0x10)      // line fill buffer
+        enc = 0x2;
+    else if(lvl & 0x20)      // L2
+        enc = 0x3;
+    else if(lvl & 0x40)      // L3
+        enc = hitm ? 0x6 : (snoopHit ? 0x5 : 0x4);
+    else if(lvl & 0x80)      // local RAM
+        enc = hitm ? 0xC : 0xA;
+    else if(lvl & 0x300)     // remote RAM (1 or 2 hops)
+        enc = hitm ? 0xD : 0xB;
+    else if(lvl & 0xC00)     // remote cache (1 or 2 hops)
+        enc = hitm ? 0x6 : 0x5;
+    else if(lvl & 0x1000)    // I/O
+        enc = 0xE;
+    else if(lvl & 0x2000)    // uncached
+        enc = 0xF;
+    else
+    {
+        // Newer kernels may only fill in the level number
+        switch(PERF_MEM_LVLNUM(dataSrc))
+        {
+            case(0x1): enc = 0x1; break;
+            case(0x2): enc = 0x3; break;
+            case(0x3): enc = hitm ? 0x6 : (snoopHit ? 0x5 : 0x4); break;
+            case(0xc): enc = 0x2; break;
+            case(0xd):
+                if(PERF_MEM_REMOTE(dataSrc))
+                    enc = hitm ? 0xD : 0xB;
+                else
+                    enc = hitm ? 0xC : 0xA;
+                break;
+        }
+    }
+
+    if(PERF_MEM_TLB(dataSrc) & 0x4)
+        enc |= 0x10;
+    if(PERF_MEM_LOCK(dataSrc) & 0x2)
+        enc |= 0x20;
+
+    return enc;
 }
@@ -38,10 +38,28 @@
 
 #include <QVector>
 #include <QString>
+#include <QByteArray>
+
+#include "stringdict.h"
+
+size_t createUniqueID(StringDict &existing, QString name);
+size_t createUniqueID(StringDict &existing, const char *name, int len);
+
+// Raw byte tokenizing (no allocation)
+const char *findLineEnd(const char *p, const char *end);
+const char *nextLine(const char *eol, const char *end);
+const char *trimCR(const char *begin, const char *eol);
+qint64 countLines(const char *p, const char *end);
+qlonglong tokToLongLong(const char *begin, const char *end, int base = 10);
+int tokToInt(const char *begin, const char *end, int base = 10);
+qlonglong parseDecimal(const char *begin, const char *end);
+qlonglong parseHex(const char *begin, const char *end);
 
-size_t createUniqueID(QVector<QString> &existing, QString name);
 int dseDepth(int enc);
 int dseDirty(int enc);
 std::string encToString(int enc);
 int dseSTLB(int enc);
 int dseLocked(int enc);
+
+// Linux perf_mem_data_src to the encoding above
+int perfDataSrcToEnc(quint64 dataSrc);
@@ -118,6 +118,8 @@ void PCVizWidget::processData()
     axesPositions.resize(numDimensions);
     axesOrder.resize(numDimensions);
 
+    histCounts.resize(numDimensions);
+    histGroupCounts.resize(numDimensions);
     histVals.resize(numDimensions);
     histMaxVals.resize(numDimensions);
     histMaxVals.fill(0);
@@ -130,6 +132,8 @@ void PCVizWidget::processData()
 
         axesPositions[axesOrder[i]] = i*(1.0/(numDimensions-1));
 
+        histCounts[i].resize(numHistBins);
+        histCounts[i].fill(0);
         histVals[i].resize(numHistBins);
         histVals[i].fill(0);
     }
@@ -326,8 +330,6 @@ void PCVizWidget::processSelection()
         selMaxes.fill(-1);
     }
 
-    needsRecalcLines = true;
-
     emit selectionChangedSig();
 }
 
@@ -339,18 +341,15 @@ void PCVizWidget::calcMinMaxes()
     dimMins.fill(std::numeric_limits<double>::max());
     dimMaxes.fill(std::numeric_limits<double>::min());
 
-    int elem;
-    QVector<qreal>::Iterator p;
-    for(elem=0, p=dataSet->begin; p!=dataSet->end; elem++, p+=numDimensions)
+    bool allVisible = dataSet->numVisible == dataSet->numElements;
+    for(int i=0; i<numDimensions; i++)
     {
-        if(!dataSet->visible(elem))
-            continue;
-
-        for(int i=0; i<numDimensions; i++)
-        {
-            dimMins[i] = std::min(dimMins[i],*(p+i));
-            dimMaxes[i] = std::max(dimMaxes[i],*(p+i));
-        }
+        if(allVisible)
+            columnMinMax(dataSet->column(i),NoMask(),
+                         dimMins[i],dimMaxes[i]);
+        else
+            columnMinMax(dataSet->column(i),VisibleMask(dataSet),
+                         dimMins[i],dimMaxes[i]);
     }
 }
 
@@ -359,70 +358,85 @@ void PCVizWidget::calcHistBins()
     if(!processed)
         return;
 
-    histMaxVals.fill(0);
-
-    int elem;
-    QVector<qreal>::Iterator p;
-    for(elem=0, p=dataSet->begin; p!=dataSet->end; elem++, p+=numDimensions)
+    // Every group's histogram in one pass over each column
+    int numGroups = dataSet->numSelectionGroups();
+    for(int i=0; i<numDimensions; i++)
     {
-        if(dataSet->selectionDefined() && !dataSet->selected(elem))
-            continue;
+        histGroupCounts[i].fill(0,numGroups*numHistBins);
 
-        for(int i=0; i<numDimensions; i++)
-        {
-            int histBin = floor(scale(*(p+i),dimMins[i],dimMaxes[i],0,numHistBins));
+        // Weighted elements count as the samples they stand for
+        if(dataSet->weightDim != -1)
+            columnGroupHistogram(dataSet->column(i),0,dataSet->numElements,dataSet->groupIDs(),
+                                 dataSet->column(dataSet->weightDim),
+                                 dimMins[i],dimMaxes[i],histGroupCounts[i].data(),numHistBins);
+        else
+            columnGroupHistogram(dataSet->column(i),0,dataSet->numElements,dataSet->groupIDs(),
+                                 dimMins[i],dimMaxes[i],histGroupCounts[i].data(),numHistBins);
+    }
+
+    sumGroupBins();
+    scaleHistBins();
+}
 
-            if(histBin >= numHistBins)
-                histBin = numHistBins-1;
-            if(histBin < 0)
-                histBin = 0;
+// The histograms shown: of all selection groups together, or of every
+// element when nothing is selected
+void PCVizWidget::sumGroupBins()
+{
+    int firstGroup = dataSet->selectionDefined() ? 1 : 0;
+    for(int i=0; i<numDimensions; i++)
+    {
+        histCounts[i].fill(0);
 
-            histVals[i][histBin] += 1;
-            histMaxVals[i] = std::max(histMaxVals[i],histVals[i][histBin]);
+        int numGroups = histGroupCounts[i].size() / numHistBins;
+        for(int g=firstGroup; g<numGroups; g++)
+        {
+            const qreal *bins = histGroupCounts[i].constData() + g*numHistBins;
+            for(int j=0; j<numHistBins; j++)
+                histCounts[i][j] += bins[j];
         }
     }
+}
+
+void PCVizWidget::scaleHistBins()
+{
+    histMaxVals.fill(0);
+
+    for(int i=0; i<numDimensions; i++)
+        histMaxVals[i] = *std::max_element(histCounts[i].begin(),histCounts[i].end());
 
     // Scale hist values to [0,1]
     for(int i=0; i<numDimensions; i++)
         for(int j=0; j<numHistBins; j++)
-            histVals[i][j] = scale(histVals[i][j],0,histMaxVals[i],0,1);
+            histVals[i][j] = scale(histCounts[i][j],0,histMaxVals[i],0,1);
 }
 
 void PCVizWidget::recalcLines(int dirtyAxis)
 {
-    QVector4D col;
-    QVector2D a, b;
-    int i, axis, nextAxis, elem;
-    QVector<double>::Iterator p;
-
     if(!processed)
         return;
 
     verts.clear();
     colors.clear();
 
-    QVector4D redVec = QVector4D(255,0,0,255);
-    QColor dataSetColor = colorMap.at(0);
-    qreal Cr,Cg,Cb;
-    dataSetColor.getRgbF(&Cr,&Cg,&Cb);
-    QVector4D dataColor = QVector4D(Cr,Cg,Cb,1);
+    addLines(0,dataSet->numElements,dirtyAxis);
+}
 
-    for(p=dataSet->begin, elem=0; p!=dataSet->end; p+=numDimensions, elem++)
+void PCVizWidget::addLines(ElemIndex first, ElemIndex last, int dirtyAxis)
+{
+    QVector4D col;
+    QVector2D a, b;
+    int i, axis, nextAxis;
+    ElemIndex elem;
+
+    QVector<QVector4D> groupCols;
+    lineColors(groupCols);
+
+    for(elem=first; elem<last; elem++)
     {
         if(!dataSet->visible(elem))
-        {
             continue;
-        }
-        else if(dataSet->selected(elem))
-        {
-            col = redVec;
-            col.setW(selOpacity);
-        }
-        else
-        {
-            col = dataColor;
-            col.setW(unselOpacity);
-        }
+
+        col = groupCols[dataSet->selected(elem)];
 
 
         for(i=0; i<numDimensions-1; i++)
@@ -433,10 +447,10 @@ void PCVizWidget::recalcLines(int dirtyAxis)
             axis = axesOrder[i];
             nextAxis = axesOrder[i+1];
 
-            float aVal = scale(*(p+axis),dimMins[axis],dimMaxes[axis],0,1);
+            float aVal = scale(dataSet->at(elem,axis),dimMins[axis],dimMaxes[axis],0,1);
             a = QVector2D(axesPositions[axis],aVal);
 
-            float bVal = scale(*(p+nextAxis),dimMins[nextAxis],dimMaxes[nextAxis],0,1);
+            float bVal = scale(dataSet->at(elem,nextAxis),dimMins[nextAxis],dimMaxes[nextAxis],0,1);
             b = QVector2D(axesPositions[nextAxis],bVal);
 
             verts.push_back(a.x());
@@ -458,6 +472,85 @@ void PCVizWidget::recalcLines(int dirtyAxis)
     }
 }
 
+// Line color of each group, 0 being unselected
+void PCVizWidget::lineColors(QVector<QVector4D> &cols)
+{
+    cols.resize(dataSet->numSelectionGroups());
+
+    qreal r,g,b;
+    colorMap.at(0).getRgbF(&r,&g,&b);
+    cols[0] = QVector4D(r,g,b,unselOpacity);
+
+    for(int i=1; i<cols.size(); i++)
+    {
+        groupColor(i).getRgbF(&r,&g,&b);
+        cols[i] = QVector4D(r,g,b,selOpacity);
+    }
+}
+
+// Moves the elements that changed group between the group histograms and
+// recolors their lines, instead of redoing both over all elements
+void PCVizWidget::applySelectionDelta(const SelectionDelta &delta)
+{
+    int numGroups = dataSet->numSelectionGroups();
+    for(int i=0; i<numDimensions; i++)
+    {
+        if(histGroupCounts[i].size() < numGroups*numHistBins)
+            histGroupCounts[i].resize(numGroups*numHistBins);
+    }
+
+    // Lines can be found by element only when every element has them
+    ElemIndex lineFloats = (numDimensions-1) * POINTS_PER_LINE * FLOATS_PER_COLOR;
+    bool recolor = !needsRecalcLines
+            && dataSet->numVisible == dataSet->numElements
+            && (ElemIndex)colors.size() == dataSet->numElements * lineFloats;
+
+    QVector<QVector4D> groupCols;
+    lineColors(groupCols);
+
+    for(unsigned int g=0; g<delta.changed.size(); g++)
+    {
+        const ElemSet &elems = delta.changed[g];
+        for(ElemSet::const_iterator it = elems.begin(); it != elems.end(); it++)
+        {
+            ElemIndex elem = *it;
+            int group = dataSet->selected(elem);
+            qreal w = dataSet->weight(elem);
+
+            for(int i=0; i<numDimensions; i++)
+            {
+                qreal range = dimMaxes[i] - dimMins[i];
+                range = (range == 0) ? 1 : range;
+
+                int bin = floor(numHistBins * ((dataSet->at(elem,i)-dimMins[i]) / range));
+                bin = std::min(std::max(bin,0),numHistBins-1);
+
+                histGroupCounts[i][g*numHistBins+bin] -= w;
+                histGroupCounts[i][group*numHistBins+bin] += w;
+            }
+
+            if(recolor)
+            {
+                const QVector4D &col = groupCols[group];
+                float *c = colors.data() + elem*lineFloats;
+                for(ElemIndex j=0; j<lineFloats; j+=FLOATS_PER_COLOR)
+                {
+                    c[j] = col.x();
+                    c[j+1] = col.y();
+                    c[j+2] = col.z();
+                    c[j+3] = col.w();
+                }
+            }
+        }
+    }
+
+    sumGroupBins();
+    scaleHistBins();
+
+    if(!recolor)
+        needsRecalcLines = true;
+}
+
 void PCVizWidget::showContextMenu(const QPoint &pos)
 {
     contextMenuMousePos = pos;
@@ -473,8 +566,16 @@ void PCVizWidget::showContextMenu(const QPoint &pos)
 
 void PCVizWidget::selectionChangedSlot()
 {
-    needsCalcHistBins = true;
-    needsRecalcLines = true;
+    const SelectionDelta &delta = dataSet->selectionDelta();
+    if(!processed || delta.full || needsCalcHistBins)
+    {
+        needsCalcHistBins = true;
+        needsRecalcLines = true;
+    }
+    else
+    {
+        applySelectionDelta(delta);
+    }
     needsRepaint = true;
 }
 
@@ -485,6 +586,60 @@ void PCVizWidget::visibilityChangedSlot()
     needsRepaint = true;
 }
 
+// Elements from first on were appended to the data set. Unless they fall
+// outside the current axis ranges, only their bins and lines are added.
+void PCVizWidget::dataAppended(ElemIndex first)
+{
+    if(!processed)
+    {
+        needsProcessData = true;
+        needsRepaint = true;
+        return;
+    }
+
+    ElemIndex last = dataSet->numElements;
+
+    bool inRange = !needsCalcMinMaxes;
+    for(int i=0; inRange && i<numDimensions; i++)
+    {
+        qreal lo = dimMins[i];
+        qreal hi = dimMaxes[i];
+        columnMinMax(dataSet->column(i),first,last,lo,hi);
+        inRange = (lo >= dimMins[i] && hi <= dimMaxes[i]);
+    }
+
+    if(!inRange)
+    {
+        needsCalcMinMaxes = true;
+        needsCalcHistBins = true;
+        needsRecalcLines = true;
+        needsRepaint = true;
+        return;
+    }
+
+    // New elements are unselected, so only count towards the bins of
+    // group 0, which come first
+    if(!needsCalcHistBins && !dataSet->selectionDefined())
+    {
+        for(int i=0; i<numDimensions; i++)
+        {
+            if(dataSet->weightDim != -1)
+                columnHistogram(dataSet->column(i),first,last,dataSet->column(dataSet->weightDim),
+                                dimMins[i],dimMaxes[i],histGroupCounts[i].data(),numHistBins);
+            else
+                columnHistogram(dataSet->column(i),first,last,
+                                dimMins[i],dimMaxes[i],histGroupCounts[i].data(),numHistBins);
+        }
+        sumGroupBins();
+        scaleHistBins();
+    }
+
+    if(!needsRecalcLines)
+        addLines(first,last);
+
+    needsRepaint = true;
+}
+
 void PCVizWidget::setSelOpacity(int val)
 {
     selOpacity = (qreal)val/1000.0;
@@ -575,7 +730,7 @@ void PCVizWidget::beginAnimation()
         selSet = dataSet->getSelectionSet();
     }
 
-    std::copy(selSet.begin(),selSet.end(),std::inserter(animSet,animSet.begin()));
+    animSet = selSet;
 
     animationAxis = getClosestAxis(contextMenuMousePos.x());
     movingAxis = -1;
@@ -731,18 +886,40 @@ void PCVizWidget::drawQtPainter(QPainter *painter)
         painter->setBrush(QColor(31,120,180));
         painter->setOpacity(0.7);
 
+        // With several groups, each bar is split by group
+        bool stacked = dataSet->selectionDefined() && dataSet->numSelectionGroups() > 2;
+
         for(int i=0; i<numDimensions; i++)
         {
             a.setX(plotBBox.left() + axesPositions[i]*plotBBox.width());
             b.setX(a.x());
 
+            int numGroups = histGroupCounts[i].size() / numHistBins;
             for(int j=0; j<numHistBins; j++)
             {
                 qreal histTop = a.y()-(j+1)*(plotBBox.height()/numHistBins);
                 qreal histLeft = a.x();//-30*histVals[i][j];
                 qreal histBottom = a.y()-(j)*(plotBBox.height()/numHistBins);
                 qreal histRight = a.x()+60*histVals[i][j];
-                painter->drawRect(QRectF(QPointF(histLeft,histTop),QPointF(histRight,histBottom)));
+
+                if(!stacked || histCounts[i][j] <= 0)
+                {
+                    painter->drawRect(QRectF(QPointF(histLeft,histTop),QPointF(histRight,histBottom)));
+                    continue;
+                }
+
+                for(int g=1; g<numGroups; g++)
+                {
+                    qreal count = histGroupCounts[i][g*numHistBins+j];
+                    if(count <= 0)
+                        continue;
+
+                    qreal segRight = histLeft + (histRight-a.x())*count/histCounts[i][j];
+                    painter->setBrush(groupColor(g));
+                    painter->drawRect(QRectF(QPointF(histLeft,histTop),QPointF(segRight,histBottom)));
+                    histLeft = segRight;
+                }
+                painter->setBrush(QColor(31,120,180));
             }
 
             painter->drawLine(a,b);
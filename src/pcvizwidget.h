@@ -62,6 +62,7 @@ public slots:
     void frameUpdate();
     void selectionChangedSlot();
     void visibilityChangedSlot();
+    void dataAppended(ElemIndex first);
 
     void showContextMenu(const QPoint &);
     void setSelOpacity(int val);
@@ -85,6 +86,11 @@ private:
     void processSelection();
     void calcMinMaxes();
     void calcHistBins();
+    void sumGroupBins();
+    void scaleHistBins();
+    void addLines(ElemIndex first, ElemIndex last, int dirtyAxis = -1);
+    void lineColors(QVector<QVector4D> &cols);
+    void applySelectionDelta(const SelectionDelta &delta);
 
 private:
     bool needsRecalcLines;
@@ -102,6 +108,8 @@ private:
     QRectF plotBBox;
     ColorMap colorMap;
 
+    QVector<QVector<qreal> > histCounts;
+    QVector<QVector<qreal> > histGroupCounts;   // numHistBins per group
     QVector<QVector<qreal> > histVals;
     QVector<qreal> histMaxVals;
 
@@ -0,0 +1,548 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "perfreader.h"
+#include "sampleparser.h"
+#include "parseUtil.h"
+
+#include <iostream>
+#include <string.h>
+
+// Only the parts of linux/perf_event.h and tools/perf/util/header.h used here
+#define PERF_MAGIC      0x32454c4946524550ULL // "PERFILE2"
+#define PERF_MAGIC_SWAP 0x50455246494c4532ULL
+
+#define PERF_HEADER_SIZE 104
+
+#define PERF_RECORD_SAMPLE     9
+#define PERF_RECORD_AUXTRACE   71
+#define PERF_RECORD_COMPRESSED 81
+
+enum perf_sample_format
+{
+    PERF_SAMPLE_IP             = 1U << 0,
+    PERF_SAMPLE_TID            = 1U << 1,
+    PERF_SAMPLE_TIME           = 1U << 2,
+    PERF_SAMPLE_ADDR           = 1U << 3,
+    PERF_SAMPLE_READ           = 1U << 4,
+    PERF_SAMPLE_CALLCHAIN      = 1U << 5,
+    PERF_SAMPLE_ID             = 1U << 6,
+    PERF_SAMPLE_CPU            = 1U << 7,
+    PERF_SAMPLE_PERIOD         = 1U << 8,
+    PERF_SAMPLE_STREAM_ID      = 1U << 9,
+    PERF_SAMPLE_RAW            = 1U << 10,
+    PERF_SAMPLE_BRANCH_STACK   = 1U << 11,
+    PERF_SAMPLE_REGS_USER      = 1U << 12,
+    PERF_SAMPLE_STACK_USER     = 1U << 13,
+    PERF_SAMPLE_WEIGHT         = 1U << 14,
+    PERF_SAMPLE_DATA_SRC       = 1U << 15,
+    PERF_SAMPLE_IDENTIFIER     = 1U << 16,
+    PERF_SAMPLE_WEIGHT_STRUCT  = 1U << 24
+};
+
+#define PERF_FORMAT_TOTAL_TIME_ENABLED (1U << 0)
+#define PERF_FORMAT_TOTAL_TIME_RUNNING (1U << 1)
+#define PERF_FORMAT_ID                 (1U << 2)
+#define PERF_FORMAT_GROUP              (1U << 3)
+#define PERF_FORMAT_LOST               (1U << 4)
+
+#define PERF_SAMPLE_BRANCH_HW_INDEX    (1U << 17)
+#define PERF_SAMPLE_BRANCH_COUNTERS    (1U << 19)
+
+// Offsets into perf_event_attr
+#define ATTR_SAMPLE_TYPE        24
+#define ATTR_READ_FORMAT        32
+#define ATTR_BRANCH_SAMPLE_TYPE 72
+#define ATTR_SAMPLE_REGS_USER   80
+#define ATTR_SAMPLE_REGS_INTR   96
+
+enum perf_dim
+{
+    PERF_DIM_VARIABLE = 0,
+    PERF_DIM_SOURCE,
+    PERF_DIM_LINE,
+    PERF_DIM_IP,
+    PERF_DIM_ADDR,
+    PERF_DIM_TIME,
+    PERF_DIM_LATENCY,
+    PERF_DIM_DATASOURCE,
+    PERF_DIM_DIRTY,
+    PERF_DIM_STLB,
+    PERF_DIM_LOCKED,
+    PERF_DIM_REMOTE,
+    PERF_DIM_CPU,
+    PERF_DIM_PID,
+    PERF_DIM_TID,
+    PERF_NUM_DIMS
+};
+
+static const char *perfDimNames[PERF_NUM_DIMS] =
+{
+    "variable", "source", "line", "ip", "addr", "time", "latency",
+    "dataSource", "dirty", "stlbMiss", "locked", "remote", "cpu", "pid", "tid"
+};
+
+// Samples per append to the sink
+#define PERF_BATCH_ELEMS 65536
+
+static inline quint64 getU64(const char *p)
+{
+    quint64 v;
+    memcpy(&v,p,sizeof(v));
+    return v;
+}
+
+static inline quint32 getU32(const char *p)
+{
+    quint32 v;
+    memcpy(&v,p,sizeof(v));
+    return v;
+}
+
+static inline quint16 getU16(const char *p)
+{
+    quint16 v;
+    memcpy(&v,p,sizeof(v));
+    return v;
+}
+
+static int popcount64(quint64 v)
+{
+    int n = 0;
+    for(/*v*/; v; v &= v-1)
+        n++;
+    return n;
+}
+
+bool isPerfDataFile(QString fileName)
+{
+    QFile f(fileName);
+    if(!f.open(QIODevice::ReadOnly))
+        return false;
+
+    char magic[8];
+    if(f.read(magic,sizeof(magic)) != sizeof(magic))
+        return false;
+
+    quint64 m = getU64(magic);
+    return m == PERF_MAGIC || m == PERF_MAGIC_SWAP;
+}
+
+PerfReader::PerfReader()
+    : data(NULL), fileSize(0), dataOffset(0), dataSize(0), numSamples(0), uniformSampleType(true)
+{
+}
+
+PerfReader::~PerfReader()
+{
+    // Closing the file also unmaps it
+    file.close();
+}
+
+int PerfReader::open(QString fileName)
+{
+    file.setFileName(fileName);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        std::cerr << "ERROR: could not open " << fileName.toStdString() << std::endl;
+        return -1;
+    }
+
+    fileSize = file.size();
+    data = fileSize >= PERF_HEADER_SIZE ? (const char*)file.map(0,fileSize) : NULL;
+    if(data == NULL)
+    {
+        std::cerr << "ERROR: " << fileName.toStdString() << " is not a perf.data file" << std::endl;
+        return -1;
+    }
+
+    quint64 magic = getU64(data);
+    if(magic == PERF_MAGIC_SWAP)
+    {
+        std::cerr << "ERROR: " << fileName.toStdString()
+                  << " was recorded on a host of the other byte order" << std::endl;
+        return -1;
+    }
+
+    // Pipe mode output has a 16 byte header and no sections
+    if(magic != PERF_MAGIC || getU64(data+8) != PERF_HEADER_SIZE)
+    {
+        std::cerr << "ERROR: " << fileName.toStdString()
+                  << " is not a perf.data file (pipe mode output is not supported)" << std::endl;
+        return -1;
+    }
+
+    quint64 attrSize = getU64(data+16);
+    quint64 attrsOffset = getU64(data+24);
+    quint64 attrsSize = getU64(data+32);
+    dataOffset = getU64(data+40);
+    dataSize = getU64(data+48);
+
+    // Each file attr is a perf_event_attr followed by the section of its
+    // IDs. Sections must lie inside the file, compared so nothing wraps.
+    quint64 size = fileSize;
+    if(attrSize < ATTR_SAMPLE_REGS_INTR+8+16 || attrsSize < attrSize ||
+       attrsOffset > size || attrsSize > size - attrsOffset ||
+       (quint64)dataOffset > size || (quint64)dataSize > size - dataOffset)
+    {
+        std::cerr << "ERROR: " << fileName.toStdString() << " has a bad header" << std::endl;
+        return -1;
+    }
+
+    attrs.clear();
+    attrIDs.clear();
+    for(quint64 a=0; a+attrSize<=attrsSize; a+=attrSize)
+    {
+        const char *p = data + attrsOffset + a;
+
+        EventAttr attr;
+        attr.sampleType = getU64(p+ATTR_SAMPLE_TYPE);
+        attr.readFormat = getU64(p+ATTR_READ_FORMAT);
+        attr.branchSampleType = getU64(p+ATTR_BRANCH_SAMPLE_TYPE);
+        attr.sampleRegsUser = getU64(p+ATTR_SAMPLE_REGS_USER);
+        attr.sampleRegsIntr = getU64(p+ATTR_SAMPLE_REGS_INTR);
+        attrs.push_back(attr);
+
+        const char *ids = p + attrSize - 16;
+        quint64 idsOffset = getU64(ids);
+        quint64 idsSize = getU64(ids+8);
+        if(idsOffset > size || idsSize > size - idsOffset)
+            continue;
+        for(quint64 i=0; i+8<=idsSize; i+=8)
+            attrIDs[getU64(data+idsOffset+i)] = attrs.size()-1;
+    }
+
+    uniformSampleType = true;
+    for(int a=1; a<attrs.size(); a++)
+        uniformSampleType = uniformSampleType && attrs[a].sampleType == attrs[0].sampleType;
+
+    if(!uniformSampleType && !(attrs[0].sampleType & (PERF_SAMPLE_IDENTIFIER | PERF_SAMPLE_ID)))
+    {
+        std::cerr << "ERROR: events of " << fileName.toStdString()
+                  << " cannot be told apart (no sample IDs)" << std::endl;
+        return -1;
+    }
+
+    if(!(attrs[0].sampleType & PERF_SAMPLE_DATA_SRC))
+        std::cerr << "WARNING: " << fileName.toStdString()
+                  << " has no data sources, was it recorded with perf mem record?" << std::endl;
+
+    return 0;
+}
+
+QStringList PerfReader::dimensions() const
+{
+    QStringList dims;
+    for(int d=0; d<PERF_NUM_DIMS; d++)
+        dims.append(perfDimNames[d]);
+    return dims;
+}
+
+// The event a sample belongs to, from the sample ID when events differ
+const PerfReader::EventAttr *PerfReader::attrOf(const char *sample, const char *end) const
+{
+    if(uniformSampleType)
+        return &attrs[0];
+
+    // The kernel puts the ID where every event agrees on it
+    quint64 type = attrs[0].sampleType;
+    const char *p = sample;
+    if(!(type & PERF_SAMPLE_IDENTIFIER))
+    {
+        if(type & PERF_SAMPLE_IP) p += 8;
+        if(type & PERF_SAMPLE_TID) p += 8;
+        if(type & PERF_SAMPLE_TIME) p += 8;
+        if(type & PERF_SAMPLE_ADDR) p += 8;
+    }
+    if(p+8 > end)
+        return NULL;
+
+    int a = attrIDs.value(getU64(p),-1);
+    return (a == -1) ? NULL : &attrs[a];
+}
+
+// Decodes the fields of one PERF_RECORD_SAMPLE body, in the order the
+// kernel writes them, up to the data source
+int PerfReader::decodeSample(const EventAttr &attr, const char *p, const char *end, qint64 *vals) const
+{
+    quint64 type = attr.sampleType;
+    quint64 ip = 0, addr = 0, time = 0, weight = 0, dataSrc = 0;
+    quint32 pid = 0, tid = 0, cpu = 0;
+
+    // Sizes come from the file, so they are checked against the bytes
+    // left before p moves, and counts before they are scaled
+#define NEED(n) if((quint64)(n) > (quint64)(end - p)) return -1
+#define NEED_ITEMS(nr, itemSize) if((quint64)(nr) > (quint64)(end - p) / (itemSize)) return -1
+
+    if(type & PERF_SAMPLE_IDENTIFIER) { NEED(8); p += 8; }
+    if(type & PERF_SAMPLE_IP) { NEED(8); ip = getU64(p); p += 8; }
+    if(type & PERF_SAMPLE_TID) { NEED(8); pid = getU32(p); tid = getU32(p+4); p += 8; }
+    if(type & PERF_SAMPLE_TIME) { NEED(8); time = getU64(p); p += 8; }
+    if(type & PERF_SAMPLE_ADDR) { NEED(8); addr = getU64(p); p += 8; }
+    if(type & PERF_SAMPLE_ID) { NEED(8); p += 8; }
+    if(type & PERF_SAMPLE_STREAM_ID) { NEED(8); p += 8; }
+    if(type & PERF_SAMPLE_CPU) { NEED(8); cpu = getU32(p); p += 8; }
+    if(type & PERF_SAMPLE_PERIOD) { NEED(8); p += 8; }
+
+    if(type & PERF_SAMPLE_READ)
+    {
+        int perValue = 1 + ((attr.readFormat & PERF_FORMAT_ID) ? 1 : 0)
+                         + ((attr.readFormat & PERF_FORMAT_LOST) ? 1 : 0);
+        int times = ((attr.readFormat & PERF_FORMAT_TOTAL_TIME_ENABLED) ? 1 : 0)
+                  + ((attr.readFormat & PERF_FORMAT_TOTAL_TIME_RUNNING) ? 1 : 0);
+        if(attr.readFormat & PERF_FORMAT_GROUP)
+        {
+            NEED(8);
+            quint64 nr = getU64(p);
+            NEED_ITEMS(nr,8*perValue);
+            NEED(8 + 8*times + 8*perValue*nr);
+            p += 8 + 8*times + 8*perValue*nr;
+        }
+        else
+        {
+            NEED(8*(times+perValue));
+            p += 8*(times+perValue);
+        }
+    }
+
+    if(type & PERF_SAMPLE_CALLCHAIN)
+    {
+        NEED(8);
+        quint64 nr = getU64(p);
+        p += 8;
+        NEED_ITEMS(nr,8);
+        p += 8*nr;
+    }
+
+    if(type & PERF_SAMPLE_RAW)
+    {
+        // The size covers the padding that keeps the record 8 byte aligned
+        NEED(4);
+        quint32 size = getU32(p);
+        p += 4;
+        NEED(size);
+        p += size;
+    }
+
+    if(type & PERF_SAMPLE_BRANCH_STACK)
+    {
+        NEED(8);
+        quint64 nr = getU64(p);
+        p += 8;
+        if(attr.branchSampleType & PERF_SAMPLE_BRANCH_HW_INDEX)
+        {
+            NEED(8);
+            p += 8;
+        }
+        quint64 entrySize = 24;
+        if(attr.branchSampleType & PERF_SAMPLE_BRANCH_COUNTERS)
+            entrySize += 8;
+        NEED_ITEMS(nr,entrySize);
+        p += entrySize*nr;
+    }
+
+    if(type & PERF_SAMPLE_REGS_USER)
+    {
+        NEED(8);
+        quint64 abi = getU64(p);
+        p += 8;
+        if(abi)
+        {
+            NEED(8*popcount64(attr.sampleRegsUser));
+            p += 8*popcount64(attr.sampleRegsUser);
+        }
+    }
+
+    if(type & PERF_SAMPLE_STACK_USER)
+    {
+        NEED(8);
+        quint64 size = getU64(p);
+        p += 8;
+        if(size)
+        {
+            NEED(size);
+            p += size;
+            NEED(8);
+            p += 8;
+        }
+    }
+
+    if(type & (PERF_SAMPLE_WEIGHT | PERF_SAMPLE_WEIGHT_STRUCT))
+    {
+        NEED(8);
+        weight = getU64(p);
+        if(type & PERF_SAMPLE_WEIGHT_STRUCT)
+            weight &= 0xFFFFFFFF;
+        p += 8;
+    }
+
+    if(type & PERF_SAMPLE_DATA_SRC) { NEED(8); dataSrc = getU64(p); p += 8; }
+
+#undef NEED
+#undef NEED_ITEMS
+
+    const DataSourceInfo &info = dataSourceDecoder(DSE_INTEL_PEBS).info(perfDataSrcToEnc(dataSrc));
+
+    // Kernel addresses come out negative, as their sign extended canonical
+    // form, but every bit is kept
+    vals[PERF_DIM_LINE] = 0;
+    vals[PERF_DIM_IP] = (qint64)ip;
+    vals[PERF_DIM_ADDR] = (qint64)addr;
+    vals[PERF_DIM_TIME] = (qint64)time;
+    vals[PERF_DIM_LATENCY] = weight;
+    vals[PERF_DIM_DATASOURCE] = info.depth;
+    vals[PERF_DIM_DIRTY] = info.dirty;
+    vals[PERF_DIM_STLB] = info.stlbMiss ? 1 : 0;
+    vals[PERF_DIM_LOCKED] = info.locked ? 1 : 0;
+    vals[PERF_DIM_REMOTE] = info.remote ? 1 : 0;
+    vals[PERF_DIM_CPU] = cpu;
+    vals[PERF_DIM_PID] = pid;
+    vals[PERF_DIM_TID] = tid;
+
+    return 0;
+}
+
+int PerfReader::read(SampleSink &sink, StringDict &varDict, StringDict &sourceDict,
+                     LoadProgress *progress)
+{
+    if(data == NULL)
+        return -1;
+
+    qint64 unknownVar = varDict.intern("[unknown]",9);
+    qint64 unknownSource = sourceDict.intern("[unknown]",9);
+
+    // Every field is an integer, appended as one so addresses and times
+    // above 2^53 stay exact
+    QVector<QVector<qint64> > batch(PERF_NUM_DIMS);
+    for(int d=0; d<PERF_NUM_DIMS; d++)
+        batch[d].resize(PERF_BATCH_ELEMS);
+
+    sink.begin(PERF_NUM_DIMS);
+    numSamples = 0;
+
+    const char *p = data + dataOffset;
+    const char *end = p + dataSize;
+    const char *reported = p;
+
+    qint64 vals[PERF_NUM_DIMS];
+    vals[PERF_DIM_VARIABLE] = unknownVar;
+    vals[PERF_DIM_SOURCE] = unknownSource;
+
+    int n = 0;
+    qint64 skipped = 0;
+    qint64 compressed = 0;
+    int err = 0;
+
+    while(end - p >= 8)
+    {
+        quint32 type = getU32(p);
+        quint16 size = getU16(p+6);
+        if(size < 8 || size > end - p)
+            break;
+
+        const char *next = p + size;
+
+        if(type == PERF_RECORD_SAMPLE)
+        {
+            const EventAttr *attr = attrOf(p+8,next);
+            if(attr == NULL || decodeSample(*attr,p+8,next,vals))
+            {
+                skipped++;
+            }
+            else
+            {
+                for(int d=0; d<PERF_NUM_DIMS; d++)
+                    batch[d][n] = vals[d];
+                n++;
+                numSamples++;
+            }
+        }
+        else if(type == PERF_RECORD_AUXTRACE && size >= 16)
+        {
+            // Trace data follows the record, a size past the end stops
+            // the read
+            quint64 auxSize = getU64(p+8);
+            if(auxSize > (quint64)(end - next))
+                break;
+            next += auxSize;
+        }
+        else if(type == PERF_RECORD_COMPRESSED)
+        {
+            compressed++;
+        }
+
+        p = next;
+
+        if(n == PERF_BATCH_ELEMS || p >= end)
+        {
+            for(int d=0; d<PERF_NUM_DIMS; d++)
+                sink.append(d,batch[d].constData(),n);
+            sink.endBatch();
+            n = 0;
+
+            if(progress)
+            {
+                progress->advance(p - reported);
+                reported = p;
+                if(progress->cancelled())
+                {
+                    err = LOAD_CANCELLED;
+                    break;
+                }
+            }
+        }
+    }
+
+    if(!err && n > 0)
+    {
+        for(int d=0; d<PERF_NUM_DIMS; d++)
+            sink.append(d,batch[d].constData(),n);
+        sink.endBatch();
+    }
+
+    if(progress && !err && end > reported)
+        progress->advance(end - reported);
+
+    if(skipped)
+        std::cerr << "WARNING: skipped " << skipped << " malformed samples" << std::endl;
+    if(compressed)
+        std::cerr << "WARNING: skipped " << compressed
+                  << " compressed records, record without -z to load them" << std::endl;
+
+    return err;
+}
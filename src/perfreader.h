@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef PERFREADER_H
+#define PERFREADER_H
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+
+#include "stringdict.h"
+#include "loadprogress.h"
+
+class SampleSink;
+
+// Starts with the perf.data magic ("PERFILE2")
+bool isPerfDataFile(QString fileName);
+
+// Sample records of a Linux perf.data file, as written by perf mem
+// record (PERF_SAMPLE_ADDR, _WEIGHT, _DATA_SRC, _CPU, ...). Each sample
+// becomes an element with the dimensions below, decoded straight from
+// the mapped file. Records other than samples are skipped.
+class PerfReader
+{
+public:
+    PerfReader();
+    ~PerfReader();
+
+    // Maps the file and reads its header and event attributes
+    int open(QString fileName);
+
+    QStringList dimensions() const;
+    qint64 size() const { return fileSize; }
+    qint64 samplesRead() const { return numSamples; }
+
+    // Appends every sample to sink. Code and data symbols are not
+    // resolved, the variable and source of all samples are "[unknown]".
+    int read(SampleSink &sink, StringDict &varDict, StringDict &sourceDict,
+             LoadProgress *progress = NULL);
+
+private:
+    struct EventAttr
+    {
+        quint64 sampleType;
+        quint64 readFormat;
+        quint64 branchSampleType;
+        quint64 sampleRegsUser;
+        quint64 sampleRegsIntr;
+    };
+
+    const EventAttr *attrOf(const char *sample, const char *end) const;
+    int decodeSample(const EventAttr &attr, const char *p, const char *end, qint64 *vals) const;
+
+private:
+    QFile file;
+    const char *data;
+    qint64 fileSize;
+
+    qint64 dataOffset;
+    qint64 dataSize;
+    qint64 numSamples;
+
+    QVector<EventAttr> attrs;
+    QMap<quint64,int> attrIDs;
+    bool uniformSampleType;
+};
+
+#endif // PERFREADER_H
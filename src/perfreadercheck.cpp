@@ -0,0 +1,215 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+// Decodes example_data/perf/mem.perf.data (written by genperfdata.py
+// there) and checks every sample against the values it was written with,
+// then reads corrupted and truncated copies, which must fail or stop
+// cleanly instead of reading outside the file.
+//
+//   perfreadercheck <mem.perf.data> [scratch file]
+
+#include <QFile>
+#include <QByteArray>
+
+#include <cstring>
+#include <iostream>
+
+#include "perfreader.h"
+#include "sampleparser.h"
+
+#define NUM_SAMPLES 7
+#define NUM_CHECKED 12
+
+// Field offsets in the fixture
+#define HEADER_DATA_SIZE  48
+#define ATTR_SAMPLE_TYPE  (104+24)
+#define DATA_OFFSET       (104+144)
+#define FIRST_WEIGHT      (DATA_OFFSET+8+48)
+
+static const char *checkedDims[] =
+{ "ip", "addr", "time", "latency", "dataSource", "dirty", "stlbMiss", "locked", "remote", "cpu", "pid", "tid" };
+
+// Times above 2^53 and a kernel ip, which must not be rounded
+#define T0 ((1LL << 53) + 1)
+#define KERNEL_IP ((qint64)0xffffffff81001060ULL)
+
+static const qint64 expected[NUM_SAMPLES][NUM_CHECKED] =
+{
+    // ip       addr            time     lat  depth dirty stlb lock rmt cpu pid  tid
+    { 0x401000,  0x7f0000001000, T0+1000, 10,  1,   -1,   0,   0,   0,  0,  100, 101 },
+    { 0x401010,  0x7f0000002000, T0+2000, 40,  3,   -1,   0,   0,   0,  1,  100, 101 },
+    { 0x401020,  0x7f0000003000, T0+3000, 300, -1,  -1,   0,   0,   0,  2,  100, 102 },
+    { 0x401030,  0x7f0000004000, T0+4000, 200, 4,   1,    0,   0,   0,  3,  100, 102 },
+    { 0x401040,  0x7f0000005000, T0+5000, 20,  2,   -1,   1,   1,   0,  0,  200, 201 },
+    { 0x401050,  0x7f0000006000, T0+6000, 15,  2,   -1,   0,   0,   0,  1,  200, 201 },
+    { KERNEL_IP, 0x7f0000007000, T0+7000, 400, 4,   0,    0,   0,   1,  2,  200, 202 }
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if(!ok)
+    {
+        std::cerr << "FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+// The stored value, without going through qreal
+static qint64 valueAt(const DataColumn &col, ElemIndex i)
+{
+    DISPATCH_COLUMN_TYPE(col, return (qint64)col.values<T>()[i]);
+    return 0;
+}
+
+static void putU64(QByteArray &bytes, int offset, quint64 v)
+{
+    memcpy(bytes.data()+offset,&v,sizeof(v));
+}
+
+// Returns the number of samples read, or -1 if the file is rejected
+static qint64 readFile(QString fileName, QVector<DataColumn> &columns, QStringList &dims)
+{
+    PerfReader reader;
+    if(reader.open(fileName) != 0)
+        return -1;
+
+    StringDict varDict;
+    StringDict sourceDict;
+    ColumnSink sink(columns);
+    if(reader.read(sink,varDict,sourceDict) != 0)
+        return -1;
+
+    dims = reader.dimensions();
+    return reader.samplesRead();
+}
+
+static qint64 readBytes(QString scratch, const QByteArray &bytes)
+{
+    QFile file(scratch);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+       file.write(bytes) != bytes.size())
+    {
+        std::cerr << "ERROR: could not write " << scratch.toStdString() << std::endl;
+        return -2;
+    }
+    file.close();
+
+    QVector<DataColumn> columns;
+    QStringList dims;
+    return readFile(scratch,columns,dims);
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 2)
+    {
+        std::cerr << "usage: perfreadercheck <mem.perf.data> [scratch file]" << std::endl;
+        return 1;
+    }
+
+    QString fileName = argv[1];
+    QString scratch = (argc > 2) ? QString(argv[2]) : QString("perfreadercheck.tmp");
+
+    QVector<DataColumn> columns;
+    QStringList dims;
+    check(readFile(fileName,columns,dims) == NUM_SAMPLES,"all samples read");
+
+    for(int d=0; d<NUM_CHECKED && failures == 0; d++)
+    {
+        int col = dims.indexOf(checkedDims[d]);
+        check(col != -1 && columns[col].size() == NUM_SAMPLES,checkedDims[d]);
+        for(int i=0; col != -1 && i<NUM_SAMPLES; i++)
+        {
+            if(valueAt(columns[col],i) != expected[i][d])
+            {
+                std::cerr << "sample " << i << " " << checkedDims[d] << ": "
+                          << valueAt(columns[col],i) << ", expected " << expected[i][d] << std::endl;
+                check(false,"decoded values");
+            }
+        }
+    }
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly))
+        return 1;
+    QByteArray orig = file.readAll();
+    file.close();
+
+    // Every truncation, with the data section cut to match once the cut
+    // is inside it so the records themselves are truncated
+    for(int size=0; size<orig.size(); size++)
+    {
+        QByteArray bytes = orig.left(size);
+        if(size >= DATA_OFFSET)
+            putU64(bytes,HEADER_DATA_SIZE,size-DATA_OFFSET);
+        qint64 n = readBytes(scratch,bytes);
+        check(n <= NUM_SAMPLES && (size < DATA_OFFSET || n >= 0),"truncated file");
+    }
+
+    // A data section past the end of the file
+    QByteArray bytes = orig;
+    putU64(bytes,HEADER_DATA_SIZE,~0ULL - 8);
+    check(readBytes(scratch,bytes) == -1,"data size past the end");
+
+    // An AUXTRACE record whose trace data would wrap the read backwards
+    bytes = orig;
+    QByteArray aux(16,'\0');
+    aux[0] = 71;    // PERF_RECORD_AUXTRACE
+    aux[6] = 16;
+    bytes.append(aux);
+    putU64(bytes,bytes.size()-8,~0ULL - 15);
+    putU64(bytes,HEADER_DATA_SIZE,orig.size()-DATA_OFFSET+16);
+    check(readBytes(scratch,bytes) == NUM_SAMPLES,"AUXTRACE size past the end");
+
+    // A callchain whose length wraps when scaled, the first weight is read
+    // as its length and every sample is too short to hold the rest
+    bytes = orig;
+    bytes[ATTR_SAMPLE_TYPE] = bytes[ATTR_SAMPLE_TYPE] | 0x20;  // PERF_SAMPLE_CALLCHAIN
+    putU64(bytes,FIRST_WEIGHT,(1ULL << 61) - 2);
+    check(readBytes(scratch,bytes) == 0,"callchain length past the end");
+
+    QFile::remove(scratch);
+
+    if(failures)
+        return 1;
+
+    std::cout << "perf.data reader checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,205 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "rangefilter.h"
+
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include <algorithm>
+#include <limits>
+
+#define FILTER_BLOCK_WORDS 64           // 4096 elements per block
+#define FILTER_PARALLEL_ELEMS (1<<20)
+#define FILTER_PROBE_RATIO 16           // look up ranges keeping under 1/16
+
+class RangeFilterTask : public QRunnable
+{
+public:
+    RangeFilterTask(const RangeFilter *f, ElemIndex first, ElemIndex last, quint64 *w)
+        : filter(f), firstWord(first), lastWord(last), words(w) {}
+
+    void run() { filter->scanWords(firstWord,lastWord,words); }
+
+private:
+    const RangeFilter *filter;
+    ElemIndex firstWord;
+    ElemIndex lastWord;
+    quint64 *words;
+};
+
+RangeFilter::RangeFilter(const DataObject *d, int threads)
+    : dataSet(d)
+{
+    numThreads = (threads <= 0) ? QThread::idealThreadCount() : threads;
+}
+
+void RangeFilter::addRange(int dim, qreal vmin, qreal vmax)
+{
+    const qreal inf = std::numeric_limits<qreal>::infinity();
+    ElemIndex n = dataSet->numElements;
+
+    Range r;
+    r.dim = dim;
+    r.lo = (vmin <= dataSet->minAt(dim)) ? -inf : vmin;
+    r.hi = (vmax >= dataSet->maxAt(dim)) ? inf : vmax;
+
+    // Keeps every element
+    if(r.lo == -inf && r.hi == inf)
+        return;
+
+    r.indexed = dataSet->sortedList(dim) != NULL;
+    if(r.indexed)
+    {
+        r.posMin = (r.lo == -inf) ? 0 : dataSet->sortedPosAbove(dim,r.lo);
+        r.posMax = (r.hi == inf) ? n : dataSet->sortedPosAbove(dim,r.hi);
+        r.hits = (r.posMax > r.posMin) ? r.posMax - r.posMin : 0;
+    }
+    else
+    {
+        qreal span = dataSet->maxAt(dim) - dataSet->minAt(dim);
+        qreal lo = std::max(r.lo,dataSet->minAt(dim));
+        qreal hi = std::min(r.hi,dataSet->maxAt(dim));
+        qreal frac = (span > 0) ? (hi - lo) / span : 1;
+        frac = std::min(std::max(frac,(qreal)0),(qreal)1);
+        r.posMin = r.posMax = 0;
+        r.hits = frac * n;
+    }
+
+    // Most selective first
+    int i = ranges.size();
+    while(i > 0 && ranges[i-1].hits > r.hits)
+        i--;
+    ranges.insert(ranges.begin() + i,r);
+}
+
+void RangeFilter::evaluate(ElemSet &out) const
+{
+    if(ranges.isEmpty())
+    {
+        out.insertRange(0,dataSet->numElements);
+        return;
+    }
+
+    const Range &driver = ranges.first();
+    if(driver.indexed && driver.hits * FILTER_PROBE_RATIO < dataSet->numElements)
+        probe(driver,out);
+    else
+        scan(out);
+}
+
+void RangeFilter::probe(const Range &driver, ElemSet &out) const
+{
+    const DataColumn &order = *dataSet->sortedList(driver.dim);
+
+    QVector<ElemIndex> kept;
+    kept.reserve(driver.hits);
+    for(ElemIndex pos=driver.posMin; pos<driver.posMax; pos++)
+    {
+        ElemIndex elem = (ElemIndex)order.at(pos);
+
+        int r;
+        for(r=1; r<ranges.size(); r++)
+        {
+            qreal val = dataSet->at(elem,ranges[r].dim);
+            if(!(val > ranges[r].lo && val <= ranges[r].hi))
+                break;
+        }
+        if(r == ranges.size())
+            kept.append(elem);
+    }
+
+    // Sorted lists give value order, the set fills fastest in index order
+    std::sort(kept.begin(),kept.end());
+    for(int i=0; i<kept.size(); i++)
+        out.insert(kept[i]);
+}
+
+void RangeFilter::scan(ElemSet &out) const
+{
+    ElemIndex numWords = (dataSet->numElements + 63) / 64;
+    QVector<quint64> words(numWords);
+
+    if(numThreads == 1 || dataSet->numElements < FILTER_PARALLEL_ELEMS)
+    {
+        scanWords(0,numWords,words.data());
+    }
+    else
+    {
+        ElemIndex numBlocks = (numWords + FILTER_BLOCK_WORDS - 1) / FILTER_BLOCK_WORDS;
+        ElemIndex blocksPerTask = (numBlocks + numThreads - 1) / numThreads;
+
+        QThreadPool pool;
+        pool.setMaxThreadCount(numThreads);
+        for(ElemIndex b=0; b<numBlocks; b+=blocksPerTask)
+        {
+            ElemIndex first = b * FILTER_BLOCK_WORDS;
+            ElemIndex last = std::min(numWords,(b + blocksPerTask) * FILTER_BLOCK_WORDS);
+            pool.start(new RangeFilterTask(this,first,last,words.data()));
+        }
+        pool.waitForDone();
+    }
+
+    out.insertWords(words.constData(),numWords);
+}
+
+void RangeFilter::scanWords(ElemIndex firstWord, ElemIndex lastWord, quint64 *words) const
+{
+    ElemIndex n = dataSet->numElements;
+
+    for(ElemIndex b=firstWord; b<lastWord; b+=FILTER_BLOCK_WORDS)
+    {
+        ElemIndex e = std::min(b + FILTER_BLOCK_WORDS,lastWord);
+        ElemIndex first = b * 64;
+        ElemIndex last = std::min(e * 64,n);
+
+        for(int r=0; r<ranges.size(); r++)
+        {
+            const Range &range = ranges[r];
+            columnIntervalMask(dataSet->column(range.dim),first,last,
+                               range.lo,range.hi,words + b,r > 0);
+
+            quint64 any = 0;
+            for(ElemIndex w=b; w<e; w++)
+                any |= words[w];
+            if(!any)
+                break;
+        }
+    }
+}
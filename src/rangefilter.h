@@ -0,0 +1,89 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef RANGEFILTER_H
+#define RANGEFILTER_H
+
+#include <QVector>
+
+#include "dataobject.h"
+
+// Conjunction of ranges vmin < value <= vmax over several dimensions of a
+// DataObject. A range starting at or below its dimension's minimum also
+// keeps the minimum, as in selectByDimRange. When the sorted lists show
+// one range is narrow, its elements are looked up there and checked
+// against the rest. Otherwise all ranges are tested in one blocked pass
+// over the columns, most selective first, skipping blocks with no
+// elements left.
+class RangeFilter
+{
+public:
+    RangeFilter(const DataObject *d, int threads = 0);
+
+    void addRange(int dim, qreal vmin, qreal vmax);
+    void clear() { ranges.clear(); }
+    bool isEmpty() const { return ranges.isEmpty(); }
+
+    // Adds the elements in every range to out
+    void evaluate(ElemSet &out) const;
+
+    // Tests words [firstWord,lastWord) of the flat result bitmap
+    void scanWords(ElemIndex firstWord, ElemIndex lastWord, quint64 *words) const;
+
+private:
+    struct Range
+    {
+        int dim;
+        qreal lo;
+        qreal hi;
+        bool indexed;
+        ElemIndex posMin;   // [posMin,posMax) of the sorted list if indexed
+        ElemIndex posMax;
+        ElemIndex hits;     // exact if indexed, else a uniform estimate
+    };
+
+    void probe(const Range &driver, ElemSet &out) const;
+    void scan(ElemSet &out) const;
+
+private:
+    const DataObject *dataSet;
+    int numThreads;
+    QVector<Range> ranges;
+};
+
+#endif // RANGEFILTER_H
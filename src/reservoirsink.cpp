@@ -0,0 +1,219 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "reservoirsink.h"
+
+#include <algorithm>
+#include <string.h>
+
+ReservoirSink::ReservoirSink(const QStringList &m, ElemIndex cap, QStringList s, quint64 seed)
+    : meta(m), capacity(cap), strataNames(s), strataA(-1), strataB(-1),
+      rng(seed ? seed : 1), numDimensions(-1), numSeen(0)
+{
+}
+
+void ReservoirSink::begin(int n)
+{
+    // Called again for every parse of a multi-file load
+    if(n == numDimensions)
+        return;
+
+    numDimensions = n;
+    pending.resize(n);
+    integer.fill(false,n);
+
+    strataA = strataNames.size() > 0 ? meta.indexOf(strataNames[0]) : -1;
+    strataB = strataNames.size() > 1 ? meta.indexOf(strataNames[1]) : -1;
+}
+
+void ReservoirSink::append(int dim, const qreal *vals, ElemIndex n)
+{
+    QVector<qint64> &p = pending[dim];
+    int size = p.size();
+    p.resize(size + n);
+    memcpy(p.data() + size,vals,n*sizeof(qreal));
+}
+
+void ReservoirSink::append(int dim, const qint64 *vals, ElemIndex n)
+{
+    QVector<qint64> &p = pending[dim];
+    int size = p.size();
+    p.resize(size + n);
+    memcpy(p.data() + size,vals,n*sizeof(qint64));
+    integer[dim] = true;
+}
+
+qreal ReservoirSink::pendingValue(int dim, ElemIndex i) const
+{
+    if(integer[dim])
+        return pending[dim][i];
+
+    qreal v;
+    memcpy(&v,&pending[dim][i],sizeof(v));
+    return v;
+}
+
+// xorshift64*
+quint64 ReservoirSink::random()
+{
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return rng * 2685821657736338717ULL;
+}
+
+int ReservoirSink::stratumOf(ElemIndex i)
+{
+    QPair<qreal,qreal> key(strataA == -1 ? 0 : pendingValue(strataA,i),
+                           strataB == -1 ? 0 : pendingValue(strataB,i));
+
+    int id = strataIDs.value(key,-1);
+    if(id == -1)
+    {
+        Stratum s;
+        s.seen = 0;
+        id = strata.size();
+        strata.push_back(s);
+        strataIDs.insert(key,id);
+    }
+    return id;
+}
+
+// Decides which elements of the batch replace kept ones (Algorithm R)
+void ReservoirSink::endBatch()
+{
+    if(numDimensions <= 0)
+        return;
+
+    ElemIndex n = pending[0].size();
+    for(int d=1; d<numDimensions; d++)
+        n = std::min(n,(ElemIndex)pending[d].size());
+
+    for(ElemIndex i=0; i<n; i++, numSeen++)
+    {
+        Stratum &s = strata[stratumOf(i)];
+        s.seen++;
+
+        ElemIndex row;
+        if((ElemIndex)s.rows.size() < capacity)
+        {
+            row = keptOrigin.size();
+            s.rows.push_back(row);
+            keptValues.resize(keptValues.size() + numDimensions);
+            keptOrigin.push_back(numSeen);
+            keptStratum.push_back(&s - strata.data());
+        }
+        else
+        {
+            ElemIndex j = random() % s.seen;
+            if(j >= capacity)
+                continue;
+            row = s.rows[j];
+            keptOrigin[row] = numSeen;
+        }
+
+        qint64 *dst = keptValues.data() + row*numDimensions;
+        for(int d=0; d<numDimensions; d++)
+            dst[d] = pending[d][i];
+    }
+
+    for(int d=0; d<numDimensions; d++)
+        pending[d].resize(0);
+}
+
+struct OriginOrder
+{
+    OriginOrder(const QVector<ElemIndex> &o) : origin(o) {}
+    bool operator()(ElemIndex a, ElemIndex b) const { return origin[a] < origin[b]; }
+    const QVector<ElemIndex> &origin;
+};
+
+QVector<ElemIndex> ReservoirSink::inputOrder() const
+{
+    QVector<ElemIndex> order(keptOrigin.size());
+    for(int r=0; r<order.size(); r++)
+        order[r] = r;
+    std::sort(order.begin(),order.end(),OriginOrder(keptOrigin));
+    return order;
+}
+
+void ReservoirSink::finish(QVector<DataColumn> &columns)
+{
+    if(numDimensions <= 0)
+        return;
+
+    QVector<ElemIndex> order = inputOrder();
+    QVector<qint64> vals(order.size());
+
+    columns.resize(numDimensions);
+    for(int d=0; d<numDimensions; d++)
+    {
+        for(int r=0; r<order.size(); r++)
+            vals[r] = keptValues[order[r]*numDimensions + d];
+
+        if(integer[d])
+            columns[d].append(vals.constData(),vals.size());
+        else
+        {
+            QVector<qreal> reals(vals.size());
+            memcpy(reals.data(),vals.constData(),vals.size()*sizeof(qreal));
+            columns[d].append(reals.constData(),reals.size());
+        }
+    }
+}
+
+QVector<qreal> ReservoirSink::weights() const
+{
+    QVector<ElemIndex> order = inputOrder();
+    QVector<qreal> w(order.size());
+    for(int r=0; r<order.size(); r++)
+    {
+        const Stratum &s = strata[keptStratum[order[r]]];
+        w[r] = (qreal)s.seen / s.rows.size();
+    }
+    return w;
+}
+
+QVector<ElemIndex> ReservoirSink::origins() const
+{
+    QVector<ElemIndex> order = inputOrder();
+    QVector<ElemIndex> o(order.size());
+    for(int r=0; r<order.size(); r++)
+        o[r] = keptOrigin[order[r]];
+    return o;
+}
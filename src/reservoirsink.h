@@ -0,0 +1,117 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef RESERVOIRSINK_H
+#define RESERVOIRSINK_H
+
+#include <QVector>
+#include <QStringList>
+#include <QMap>
+#include <QPair>
+
+#include "sampleparser.h"
+
+// Keeps a uniform random sample of at most capacity elements in one
+// pass (reservoir sampling). With strata, e.g. {"cpu","dataSource"},
+// every distinct combination of their values gets its own reservoir of
+// capacity elements. Memory stays bounded by the kept elements plus one
+// parser batch, whatever the input size.
+class ReservoirSink : public SampleSink
+{
+public:
+    // meta is read once the parser starts, strata may name one or two
+    // dimensions
+    ReservoirSink(const QStringList &meta, ElemIndex capacity,
+                  QStringList strata = QStringList(), quint64 seed = 1);
+
+    void begin(int numDimensions);
+    void append(int dim, const qreal *vals, ElemIndex n);
+    void append(int dim, const qint64 *vals, ElemIndex n);
+    void endBatch();
+
+    // Appends the kept elements to columns, in input order
+    void finish(QVector<DataColumn> &columns);
+
+    // Inverse inclusion probability of each kept element (seen/kept of
+    // its stratum), for unbiased totals
+    QVector<qreal> weights() const;
+
+    // Input index of each kept element, in the order of finish()
+    QVector<ElemIndex> origins() const;
+
+    ElemIndex seen() const { return numSeen; }
+    ElemIndex kept() const { return keptOrigin.size(); }
+
+private:
+    struct Stratum
+    {
+        ElemIndex seen;
+        QVector<ElemIndex> rows;
+    };
+
+    quint64 random();
+    qreal pendingValue(int dim, ElemIndex i) const;
+    int stratumOf(ElemIndex i);
+    QVector<ElemIndex> inputOrder() const;
+
+private:
+    const QStringList &meta;
+    ElemIndex capacity;
+    QStringList strataNames;
+    int strataA;
+    int strataB;
+    quint64 rng;
+
+    int numDimensions;
+
+    // Values are kept as their 8 bytes, qint64 in integer dimensions and
+    // qreal in the others, so neither is rounded
+    QVector< QVector<qint64> > pending;
+    QVector<bool> integer;
+
+    QMap<QPair<qreal,qreal>,int> strataIDs;
+    QVector<Stratum> strata;
+
+    // Kept elements, row by row
+    QVector<qint64> keptValues;
+    QVector<ElemIndex> keptOrigin;
+    QVector<int> keptStratum;
+    ElemIndex numSeen;
+};
+
+#endif // RESERVOIRSINK_H
@@ -0,0 +1,501 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "sampleparser.h"
+#include "parseUtil.h"
+
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include <string.h>
+#include <limits.h>
+#include <algorithm>
+
+// Chunk sizes, and how many chunks go into each batch per thread. Only
+// one batch is decoded at a time, which bounds the scratch memory.
+#define MIN_CHUNK_BYTES (1<<20)
+#define MAX_CHUNK_BYTES (1<<23)
+#define CHUNKS_PER_THREAD 2
+
+enum parse_phase
+{
+    PHASE_COUNT = 0,
+    PHASE_PARSE,
+    PHASE_REMAP,
+    PHASE_APPEND
+};
+
+// Columns that are not plain decimal integers
+static const csv_column_schema sampleSchema[] =
+{
+    {"variable",   CSV_VARIABLE},
+    {"source",     CSV_SOURCE},
+    {"dataSource", CSV_DATASOURCE},
+    {"time",       CSV_HEX}
+};
+
+csv_column_kind columnKind(const QString &name)
+{
+    int numEntries = sizeof(sampleSchema) / sizeof(sampleSchema[0]);
+    for(int i=0; i<numEntries; i++)
+    {
+        if(name == sampleSchema[i].name)
+            return sampleSchema[i].kind;
+    }
+    return CSV_DECIMAL;
+}
+
+class SampleParserTask : public QRunnable
+{
+public:
+    SampleParserTask(SampleParser *p, int ph, int i)
+        : parser(p), phase(ph), index(i) {}
+
+    void run()
+    {
+        switch(phase)
+        {
+            case(PHASE_COUNT): parser->countChunk(index); break;
+            case(PHASE_PARSE): parser->parseChunk(index); break;
+            case(PHASE_REMAP): parser->remapChunk(index); break;
+            case(PHASE_APPEND): parser->appendColumn(index); break;
+        }
+    }
+
+private:
+    SampleParser *parser;
+    int phase;
+    int index;
+};
+
+SampleParser::SampleParser(QStringList meta, int dataSourceEncoding)
+{
+    decoder = &dataSourceDecoder(dataSourceEncoding);
+    numDimensions = meta.size();
+    variableDim = -1;
+    sourceDim = -1;
+    dataSourceDim = -1;
+    numThreads = 1;
+    sink = NULL;
+    progress = NULL;
+    numParsed = 0;
+    errElem = 0;
+
+    kinds.resize(numDimensions);
+    for(int d=0; d<numDimensions; d++)
+    {
+        kinds[d] = columnKind(meta[d]);
+
+        // Only the first variable and source columns are dictionaries
+        if(kinds[d] == CSV_VARIABLE)
+        {
+            if(variableDim == -1)
+                variableDim = d;
+            else
+                kinds[d] = CSV_DECIMAL;
+        }
+        else if(kinds[d] == CSV_SOURCE)
+        {
+            if(sourceDim == -1)
+                sourceDim = d;
+            else
+                kinds[d] = CSV_DECIMAL;
+        }
+        else if(kinds[d] == CSV_DATASOURCE && dataSourceDim == -1)
+        {
+            dataSourceDim = d;
+        }
+    }
+
+    outputs = dimensions(meta);
+    fieldDims.fill(-1,DSF_NUM_FIELDS);
+    for(int f=DSF_DEPTH+1; f<DSF_NUM_FIELDS; f++)
+    {
+        if(!meta.contains(dataSourceFieldName(f)))
+            fieldDims[f] = outputs.indexOf(dataSourceFieldName(f));
+    }
+}
+
+QStringList SampleParser::dimensions(const QStringList &meta)
+{
+    QStringList dims = meta;
+    if(!meta.contains(dataSourceFieldName(DSF_DEPTH)))
+        return dims;
+
+    for(int f=DSF_DEPTH+1; f<DSF_NUM_FIELDS; f++)
+    {
+        if(!dims.contains(dataSourceFieldName(f)))
+            dims.append(dataSourceFieldName(f));
+    }
+    return dims;
+}
+
+QVector<SampleChunk> SampleParser::splitChunks(const char *begin, const char *end, int numChunks)
+{
+    QVector<SampleChunk> chunks;
+
+    qint64 size = end - begin;
+    const char *p = begin;
+    for(int c=1; c<=numChunks && p<end; c++)
+    {
+        const char *target = (c == numChunks) ? end : begin + (size*c)/numChunks;
+        if(target < p)
+            target = p;
+
+        // Chunks always end right after a newline (or at the end of the file)
+        const char *chunkEnd = nextLine(findLineEnd(target,end),end);
+        if(target == p && c < numChunks)
+            continue;
+
+        SampleChunk chunk;
+        chunk.begin = p;
+        chunk.end = chunkEnd;
+        chunk.region = 0;
+        chunk.numLines = 0;
+        chunk.firstElem = 0;
+        chunk.numElements = 0;
+        chunk.err = 0;
+        chunk.errElem = 0;
+        chunks.push_back(chunk);
+
+        p = chunkEnd;
+    }
+
+    return chunks;
+}
+
+void SampleParser::runPhase(int phase, int numTasks)
+{
+    if(numThreads == 1 || numTasks == 1)
+    {
+        for(int i=0; i<numTasks; i++)
+            SampleParserTask(this,phase,i).run();
+        return;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+    for(int i=0; i<numTasks; i++)
+        pool.start(new SampleParserTask(this,phase,i));
+    pool.waitForDone();
+}
+
+int SampleParser::parse(const char *begin, const char *end,
+                        QVector<DataColumn> &columns,
+                        StringDict &varDict,
+                        StringDict &sourceDict,
+                        int threads)
+{
+    ColumnSink columnSink(columns);
+    return parse(begin,end,columnSink,varDict,sourceDict,threads);
+}
+
+int SampleParser::parse(const char *begin, const char *end,
+                        SampleSink &out,
+                        StringDict &varDict,
+                        StringDict &sourceDict,
+                        int threads)
+{
+    QVector<SampleRegion> regions(1);
+    regions[0].begin = begin;
+    regions[0].end = end;
+    return parse(regions,out,varDict,sourceDict,threads);
+}
+
+int SampleParser::parse(const QVector<SampleRegion> &regions,
+                        SampleSink &out,
+                        StringDict &varDict,
+                        StringDict &sourceDict,
+                        int threads)
+{
+    numThreads = (threads <= 0) ? QThread::idealThreadCount() : threads;
+
+    sink = &out;
+    sink->begin(outputs.size());
+    scratch.resize(outputs.size());
+    intScratch.resize(outputs.size());
+
+    regionParsed.fill(0,regions.size());
+
+    // Enough chunks to keep every thread busy, but none too large
+    qint64 size = 0;
+    for(int r=0; r<regions.size(); r++)
+        size += regions[r].end - regions[r].begin;
+
+    qint64 numChunks = size/MAX_CHUNK_BYTES + 1;
+    if(numThreads > 1)
+        numChunks = std::max(numChunks, std::min((qint64)numThreads*CHUNKS_PER_THREAD, size/MIN_CHUNK_BYTES + 1));
+
+    // Shared out by size, chunks never span two regions
+    QVector<SampleChunk> chunks;
+    for(int r=0; r<regions.size(); r++)
+    {
+        qint64 regionSize = regions[r].end - regions[r].begin;
+        qint64 regionChunks = size ? std::max((qint64)1,numChunks*regionSize/size) : 1;
+
+        QVector<SampleChunk> regionChunkList = splitChunks(regions[r].begin,regions[r].end,regionChunks);
+        for(int c=0; c<regionChunkList.size(); c++)
+        {
+            regionChunkList[c].region = r;
+            chunks.push_back(regionChunkList[c]);
+        }
+    }
+
+    int batchSize = numThreads*CHUNKS_PER_THREAD;
+    for(int first=0; first<chunks.size(); first+=batchSize)
+    {
+        batch = chunks.mid(first,batchSize);
+
+        int err = parseBatch(varDict,sourceDict);
+        if(!err && progress)
+        {
+            qint64 bytes = 0;
+            for(int c=0; c<batch.size(); c++)
+                bytes += batch[c].end - batch[c].begin;
+
+            progress->advance(bytes);
+            if(progress->cancelled())
+                err = LOAD_CANCELLED;
+        }
+
+        if(err)
+        {
+            batch.clear();
+            scratch.clear();
+            intScratch.clear();
+            return err;
+        }
+    }
+
+    batch.clear();
+    scratch.clear();
+    intScratch.clear();
+
+    return 0;
+}
+
+int SampleParser::parseBatch(StringDict &varDict, StringDict &sourceDict)
+{
+    // Count lines so every chunk can write in place into the scratch buffers
+    runPhase(PHASE_COUNT,batch.size());
+
+    qint64 totalLines = 0;
+    for(int c=0; c<batch.size(); c++)
+    {
+        batch[c].firstElem = totalLines;
+        totalLines += batch[c].numLines;
+    }
+
+    for(int d=0; d<outputs.size(); d++)
+    {
+        if(d < numDimensions && kinds[d] == CSV_HEX)
+            intScratch[d].resize(totalLines);
+        else
+            scratch[d].resize(totalLines);
+    }
+
+    runPhase(PHASE_PARSE,batch.size());
+
+    // Merge dictionaries in chunk order, so IDs match a serial parse
+    for(int c=0; c<batch.size(); c++)
+    {
+        SampleChunk &chunk = batch[c];
+        if(chunk.err)
+        {
+            errElem = numParsed + chunk.errElem;
+            return chunk.err;
+        }
+
+        chunk.varRemap.resize(chunk.varNames.size());
+        for(int i=0; i<chunk.varNames.size(); i++)
+            chunk.varRemap[i] = createUniqueID(varDict,chunk.varNames.data(i),chunk.varNames.length(i));
+
+        chunk.sourceRemap.resize(chunk.sourceNames.size());
+        for(int i=0; i<chunk.sourceNames.size(); i++)
+            chunk.sourceRemap[i] = createUniqueID(sourceDict,chunk.sourceNames.data(i),chunk.sourceNames.length(i));
+
+        numParsed += chunk.numElements;
+        regionParsed[chunk.region] += chunk.numElements;
+    }
+
+    runPhase(PHASE_REMAP,batch.size());
+
+    // Hand the batch to the sink, one task per dimension
+    runPhase(PHASE_APPEND,outputs.size());
+    sink->endBatch();
+
+    return 0;
+}
+
+void SampleParser::countChunk(int c)
+{
+    SampleChunk *chunk = &batch[c];
+    chunk->numLines = countLines(chunk->begin,chunk->end);
+}
+
+void SampleParser::parseChunk(int c)
+{
+    SampleChunk *chunk = &batch[c];
+
+    const char *p = chunk->begin;
+    const char *end = chunk->end;
+    const char *eol;
+
+    QVector<qreal*> out(numDimensions);
+    QVector<qint64*> intOut(numDimensions);
+    for(int d=0; d<numDimensions; d++)
+    {
+        out[d] = scratch[d].data() + chunk->firstElem;
+        intOut[d] = intScratch[d].data() + chunk->firstElem;
+    }
+
+    qint64 elemid = 0;
+    for(/*p*/; p < end; p = nextLine(eol,end))
+    {
+        eol = findLineEnd(p,end);
+        const char *lineEnd = trimCR(p,eol);
+        if(lineEnd == p)
+            continue;
+
+        // Process individual dimensions differently
+        int i = 0;
+        const char *tok = p;
+        for(;;)
+        {
+            const char *sep = (const char*)memchr(tok,',',lineEnd-tok);
+            if(sep == NULL)
+                sep = lineEnd;
+
+            if(i < numDimensions)
+            {
+                switch(kinds[i])
+                {
+                    case(CSV_VARIABLE):
+                        out[i][elemid] = createUniqueID(chunk->varNames,tok,sep-tok);
+                        break;
+                    case(CSV_SOURCE):
+                        out[i][elemid] = createUniqueID(chunk->sourceNames,tok,sep-tok);
+                        break;
+                    case(CSV_DATASOURCE):
+                    {
+                        // Raw for now, remapChunk decodes the whole column
+                        qlonglong enc = parseHex(tok,sep);
+                        out[i][elemid] = (enc < INT_MIN || enc > INT_MAX) ? 0 : (int)enc;
+                        break;
+                    }
+                    case(CSV_HEX):
+                        intOut[i][elemid] = parseHex(tok,sep);
+                        break;
+                    case(CSV_DECIMAL):
+                        out[i][elemid] = parseDecimal(tok,sep);
+                        break;
+                }
+            }
+
+            i++;
+            if(sep == lineEnd)
+                break;
+            tok = sep+1;
+        }
+
+        if(i != numDimensions)
+        {
+            chunk->err = -1;
+            chunk->errElem = elemid;
+            return;
+        }
+
+        elemid++;
+    }
+
+    chunk->numElements = elemid;
+}
+
+void SampleParser::remapChunk(int c)
+{
+    SampleChunk *chunk = &batch[c];
+
+    if(variableDim != -1)
+    {
+        qreal *p = scratch[variableDim].data() + chunk->firstElem;
+        for(qint64 e=0; e<chunk->numElements; e++)
+            p[e] = chunk->varRemap[(int)p[e]];
+    }
+
+    if(sourceDim != -1)
+    {
+        qreal *p = scratch[sourceDim].data() + chunk->firstElem;
+        for(qint64 e=0; e<chunk->numElements; e++)
+            p[e] = chunk->sourceRemap[(int)p[e]];
+    }
+
+    // Flags first, from the raw encodings the depth then replaces
+    if(dataSourceDim != -1)
+    {
+        const qreal *raw = scratch[dataSourceDim].constData() + chunk->firstElem;
+        for(int f=DSF_DEPTH+1; f<DSF_NUM_FIELDS; f++)
+        {
+            if(fieldDims[f] != -1)
+                decoder->decode(f,raw,chunk->numElements,scratch[fieldDims[f]].data() + chunk->firstElem);
+        }
+    }
+
+    for(int d=0; d<numDimensions; d++)
+    {
+        if(kinds[d] == CSV_DATASOURCE)
+        {
+            qreal *p = scratch[d].data() + chunk->firstElem;
+            decoder->decode(DSF_DEPTH,p,chunk->numElements,p);
+        }
+    }
+}
+
+void SampleParser::appendColumn(int d)
+{
+    // Chunk by chunk, which also skips the slots of blank lines
+    for(int c=0; c<batch.size(); c++)
+    {
+        if(d < numDimensions && kinds[d] == CSV_HEX)
+            sink->append(d,intScratch[d].constData() + batch[c].firstElem,
+                         batch[c].numElements);
+        else
+            sink->append(d,scratch[d].constData() + batch[c].firstElem,
+                         batch[c].numElements);
+    }
+}
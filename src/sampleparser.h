@@ -0,0 +1,253 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef SAMPLEPARSER_H
+#define SAMPLEPARSER_H
+
+#include <QVector>
+#include <QByteArray>
+#include <QStringList>
+
+#include "stringdict.h"
+#include "columnkernels.h"
+#include "loadprogress.h"
+#include "datasource.h"
+
+// How the tokens of a column are parsed
+enum csv_column_kind
+{
+    CSV_DECIMAL = 0,
+    CSV_HEX,
+    CSV_VARIABLE,   // dictionary ID in varDict
+    CSV_SOURCE,     // dictionary ID in sourceDict
+    CSV_DATASOURCE  // hex data source encoding, decoded to its depth and flags
+};
+
+struct csv_column_schema
+{
+    const char *name;
+    csv_column_kind kind;
+};
+
+// Kind of the named column, decimal unless the schema says otherwise
+csv_column_kind columnKind(const QString &name);
+
+// One of several files (or parts of files) parsed as one sample stream
+struct SampleRegion
+{
+    const char *begin;
+    const char *end;
+};
+
+// A newline-aligned byte range of the sample file, parsed independently
+struct SampleChunk
+{
+    const char *begin;
+    const char *end;
+    int region;
+
+    qint64 numLines;     // upper bound on elements (newline count)
+    qint64 firstElem;    // element offset into the batch buffers
+    qint64 numElements;  // elements actually parsed
+
+    // Chunk-local dictionaries, in order of first appearance
+    StringDict varNames;
+    StringDict sourceNames;
+    QVector<qreal> varRemap;
+    QVector<qreal> sourceRemap;
+
+    int err;
+    qint64 errElem;
+};
+
+// Receives parsed values in element order, one dimension at a time.
+// Different dimensions may be appended from different threads.
+class SampleSink
+{
+public:
+    virtual ~SampleSink() {}
+    virtual void begin(int numDimensions) { Q_UNUSED(numDimensions); }
+    virtual void append(int dim, const qreal *vals, ElemIndex n) = 0;
+
+    // Integer columns (CSV_HEX), which may not fit a qreal exactly. By
+    // default they are widened to qreal.
+    virtual void append(int dim, const qint64 *vals, ElemIndex n)
+    {
+        QVector<qreal> wide(n);
+        for(ElemIndex i=0; i<n; i++)
+            wide[i] = vals[i];
+        append(dim,wide.constData(),n);
+    }
+
+    // After every dimension of a batch was appended
+    virtual void endBatch() {}
+};
+
+// Appends to in-memory typed columns
+class ColumnSink : public SampleSink
+{
+public:
+    ColumnSink(QVector<DataColumn> &c) : columns(c) {}
+    void begin(int numDimensions) { columns.resize(numDimensions); }
+    void append(int dim, const qreal *vals, ElemIndex n) { columns[dim].append(vals,n); }
+    void append(int dim, const qint64 *vals, ElemIndex n) { columns[dim].append(vals,n); }
+
+private:
+    QVector<DataColumn> &columns;
+};
+
+// Only tracks the count and range of each dimension
+class RangeSink : public SampleSink
+{
+public:
+    void begin(int numDimensions) { ranges.resize(numDimensions); }
+    void append(int dim, const qreal *vals, ElemIndex n) { ranges[dim].add(vals,n); }
+    void append(int dim, const qint64 *vals, ElemIndex n) { ranges[dim].add(vals,n); }
+
+    QVector<ColumnRange> ranges;
+};
+
+// Encodes into preallocated arrays of known physical types, dropping
+// anything past their capacity
+class EncodeSink : public SampleSink
+{
+public:
+    EncodeSink(QVector<column_type> t, QVector<char*> d, ElemIndex cap)
+        : types(t), dst(d), written(t.size(),0), capacity(cap) {}
+
+    void append(int dim, const qreal *vals, ElemIndex n) { encode(dim,vals,n); }
+    void append(int dim, const qint64 *vals, ElemIndex n) { encode(dim,vals,n); }
+
+    // Elements received, which may exceed the capacity
+    ElemIndex count() const { return written.empty() ? 0 : written[0]; }
+
+private:
+    template<typename V> void encode(int dim, const V *vals, ElemIndex n)
+    {
+        ElemIndex room = capacity - std::min(capacity,written[dim]);
+        DataColumn::encode(types[dim],vals,std::min(n,room),
+                           dst[dim] + written[dim]*DataColumn::typeSize(types[dim]));
+        written[dim] += n;
+    }
+
+private:
+    QVector<column_type> types;
+    QVector<char*> dst;
+    QVector<ElemIndex> written;
+    ElemIndex capacity;
+};
+
+class SampleParser
+{
+public:
+    SampleParser(QStringList meta, int dataSourceEncoding = DSE_INTEL_PEBS);
+
+    // Columns of files with header meta: the file's own, then the flags
+    // of the data source (dirty, stlbMiss, ...) the file does not have
+    static QStringList dimensions(const QStringList &meta);
+    QStringList dimensions() const { return outputs; }
+
+    // Parses [begin,end) and appends the elements to columns (or sink).
+    // Successive calls continue the same sample stream.
+    int parse(const char *begin, const char *end,
+              QVector<DataColumn> &columns,
+              StringDict &varDict,
+              StringDict &sourceDict,
+              int numThreads = 0);
+    int parse(const char *begin, const char *end,
+              SampleSink &sink,
+              StringDict &varDict,
+              StringDict &sourceDict,
+              int numThreads = 0);
+
+    // Parses the regions in order, with chunks of all of them in each
+    // batch, so many small files still keep every thread busy
+    int parse(const QVector<SampleRegion> &regions,
+              SampleSink &sink,
+              StringDict &varDict,
+              StringDict &sourceDict,
+              int numThreads = 0);
+
+    qint64 errorElement() const { return errElem; }
+    qint64 parsedElements() const { return numParsed; }
+
+    // Elements from each region of the last call
+    qint64 parsedElements(int region) const { return regionParsed.at(region); }
+
+    // Advanced by the bytes of each batch, a cancel stops between batches
+    void setProgress(LoadProgress *p) { progress = p; }
+
+    // Parallel phases, run on the thread pool
+    void countChunk(int c);
+    void parseChunk(int c);
+    void remapChunk(int c);
+    void appendColumn(int d);
+
+private:
+    QVector<SampleChunk> splitChunks(const char *begin, const char *end, int numChunks);
+    int parseBatch(StringDict &varDict, StringDict &sourceDict);
+    void runPhase(int phase, int numTasks);
+
+private:
+    int numDimensions;
+    int variableDim;
+    int sourceDim;
+    int dataSourceDim;
+    QVector<int> kinds;
+    const DataSourceDecoder *decoder;
+
+    QStringList outputs;
+    QVector<int> fieldDims;     // output column of each data source field
+
+    int numThreads;
+    QVector<SampleChunk> batch;
+    SampleSink *sink;
+
+    // Decoded values of the current batch, one buffer per dimension.
+    // CSV_HEX dimensions use intScratch instead, so they stay exact.
+    QVector< QVector<qreal> > scratch;
+    QVector< QVector<qint64> > intScratch;
+
+    qint64 numParsed;
+    qint64 errElem;
+    QVector<qint64> regionParsed;
+
+    LoadProgress *progress;
+};
+
+#endif // SAMPLEPARSER_H
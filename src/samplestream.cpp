@@ -0,0 +1,295 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "samplestream.h"
+
+#include <QFile>
+#include <QRunnable>
+
+#include <iostream>
+#include <algorithm>
+
+#include <string.h>
+#include <limits.h>
+
+#ifdef MEMAXES_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef MEMAXES_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef MEMAXES_HAVE_ZLIB
+class GzipStream : public SampleStream
+{
+public:
+    GzipStream(gzFile f) : file(f) {}
+    ~GzipStream() { gzclose(file); }
+
+    qint64 read(char *buf, qint64 len)
+    {
+        // gzread takes an unsigned int length
+        int n = gzread(file,buf,(unsigned int)std::min(len,(qint64)INT_MAX));
+        return (n < 0) ? -1 : n;
+    }
+
+private:
+    gzFile file;
+};
+#endif
+
+#ifdef MEMAXES_HAVE_ZSTD
+class ZstdStream : public SampleStream
+{
+public:
+    ZstdStream(QString fileName)
+        : file(fileName), in(ZSTD_DStreamInSize()), eof(false), pending(0)
+    {
+        dstream = ZSTD_createDStream();
+        ZSTD_initDStream(dstream);
+
+        input.src = in.data();
+        input.size = 0;
+        input.pos = 0;
+    }
+
+    ~ZstdStream() { ZSTD_freeDStream(dstream); }
+
+    bool open() { return dstream && file.open(QIODevice::ReadOnly); }
+
+    qint64 read(char *buf, qint64 len)
+    {
+        ZSTD_outBuffer output = { buf, (size_t)len, 0 };
+        while(output.pos < output.size)
+        {
+            if(input.pos == input.size)
+            {
+                if(eof)
+                    break;
+
+                qint64 n = file.read(in.data(),in.size());
+                if(n < 0)
+                    return -1;
+                if(n == 0)
+                {
+                    eof = true;
+                    continue;
+                }
+
+                input.size = n;
+                input.pos = 0;
+            }
+
+            pending = ZSTD_decompressStream(dstream,&output,&input);
+            if(ZSTD_isError(pending))
+                return -1;
+        }
+
+        // Input ended in the middle of a frame
+        if(eof && output.pos == 0 && input.pos == input.size && pending != 0)
+            return -1;
+
+        return output.pos;
+    }
+
+private:
+    QFile file;
+    ZSTD_DStream *dstream;
+    std::vector<char> in;
+    ZSTD_inBuffer input;
+    bool eof;
+    size_t pending;
+};
+#endif
+
+bool isCompressedSampleFile(QString fileName)
+{
+    return fileName.endsWith(".gz") || fileName.endsWith(".zst");
+}
+
+SampleStream *openSampleStream(QString fileName)
+{
+    if(fileName.endsWith(".gz"))
+    {
+#ifdef MEMAXES_HAVE_ZLIB
+        gzFile f = gzopen(fileName.toLocal8Bit().constData(),"rb");
+        if(f == NULL)
+            return NULL;
+        gzbuffer(f,1<<20);
+        return new GzipStream(f);
+#else
+        std::cerr << "ERROR: built without zlib, cannot read " << fileName.toStdString() << std::endl;
+        return NULL;
+#endif
+    }
+
+    if(fileName.endsWith(".zst"))
+    {
+#ifdef MEMAXES_HAVE_ZSTD
+        ZstdStream *s = new ZstdStream(fileName);
+        if(!s->open())
+        {
+            delete s;
+            return NULL;
+        }
+        return s;
+#else
+        std::cerr << "ERROR: built without zstd, cannot read " << fileName.toStdString() << std::endl;
+        return NULL;
+#endif
+    }
+
+    return NULL;
+}
+
+class BlockFillTask : public QRunnable
+{
+public:
+    BlockFillTask(BlockReader *r, int b) : reader(r), buffer(b) {}
+    void run() { reader->fill(buffer); }
+
+private:
+    BlockReader *reader;
+    int buffer;
+};
+
+BlockReader::BlockReader(SampleStream *s, qint64 size)
+    : stream(s), blockSize(size), current(0),
+      started(false), finished(false), err(0), totalBytes(0)
+{
+    for(int b=0; b<2; b++)
+    {
+        used[b] = 0;
+        lineEnd[b] = 0;
+        last[b] = false;
+    }
+
+    pool.setMaxThreadCount(1);
+}
+
+BlockReader::~BlockReader()
+{
+    pool.waitForDone();
+    delete stream;
+}
+
+void BlockReader::fill(int b)
+{
+    std::vector<char> &buf = buffers[b];
+
+    // Start with the partial line left over from the other buffer
+    int prev = 1-b;
+    qint64 carry = started ? used[prev] - lineEnd[prev] : 0;
+
+    buf.resize(std::max((qint64)buf.size(),carry + blockSize));
+    if(carry)
+        memcpy(buf.data(),buffers[prev].data() + lineEnd[prev],carry);
+    used[b] = carry;
+    last[b] = false;
+
+    for(;;)
+    {
+        while(used[b] < (qint64)buf.size())
+        {
+            qint64 n = stream->read(buf.data() + used[b],buf.size() - used[b]);
+            if(n < 0)
+            {
+                err = -1;
+                return;
+            }
+            if(n == 0)
+            {
+                last[b] = true;
+                break;
+            }
+            used[b] += n;
+            totalBytes += n;
+        }
+
+        if(last[b])
+        {
+            lineEnd[b] = used[b];
+            return;
+        }
+
+        // Blocks end after the last newline, grow if there is none
+        const char *p = buf.data() + used[b];
+        while(p > buf.data() && *(p-1) != '\n')
+            p--;
+
+        if(p > buf.data())
+        {
+            lineEnd[b] = p - buf.data();
+            return;
+        }
+
+        buf.resize(buf.size()*2);
+    }
+}
+
+bool BlockReader::next(const char *&begin, const char *&end)
+{
+    if(finished || err)
+        return false;
+
+    if(!started)
+    {
+        fill(0);
+        current = 0;
+        started = true;
+    }
+    else
+    {
+        pool.waitForDone();
+        current = 1-current;
+    }
+
+    if(err)
+        return false;
+
+    // Read ahead while the caller parses this block
+    if(last[current])
+        finished = true;
+    else
+        pool.start(new BlockFillTask(this,1-current));
+
+    begin = buffers[current].data();
+    end = begin + lineEnd[current];
+    return true;
+}
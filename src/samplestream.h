@@ -0,0 +1,100 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef SAMPLESTREAM_H
+#define SAMPLESTREAM_H
+
+#include <QString>
+#include <QThreadPool>
+
+#include <vector>
+
+// Sequential decompressed reads from a compressed sample file
+class SampleStream
+{
+public:
+    virtual ~SampleStream() {}
+
+    // Bytes read into buf, 0 at the end of the stream, -1 on error
+    virtual qint64 read(char *buf, qint64 len) = 0;
+};
+
+// Compressed by extension (.gz, .zst)
+bool isCompressedSampleFile(QString fileName);
+
+// Decoder for the file's extension, NULL if it cannot be opened or
+// support for that format was not built in
+SampleStream *openSampleStream(QString fileName);
+
+// Splits a stream into blocks of whole lines. The next block is read
+// and decompressed on a worker thread while the caller parses the
+// current one.
+class BlockReader
+{
+public:
+    BlockReader(SampleStream *s, qint64 blockSize = 1<<26);
+    ~BlockReader();
+
+    // Next block, valid until the following call. False at the end of
+    // the stream or on error.
+    bool next(const char *&begin, const char *&end);
+    bool failed() const { return err != 0; }
+    qint64 bytesRead() const { return totalBytes; }
+
+    void fill(int b);
+
+private:
+    SampleStream *stream;
+    qint64 blockSize;
+
+    // Double buffered, one is parsed while the other is filled
+    std::vector<char> buffers[2];
+    qint64 used[2];
+    qint64 lineEnd[2];
+    bool last[2];
+
+    int current;
+    bool started;
+    bool finished;
+    int err;
+    qint64 totalBytes;
+
+    QThreadPool pool;
+};
+
+#endif // SAMPLESTREAM_H
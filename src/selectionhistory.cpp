@@ -0,0 +1,183 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "selectionhistory.h"
+
+#include <algorithm>
+
+bool SelectionStep::empty() const
+{
+    for(unsigned int g=0; g<before.size(); g++)
+    {
+        if(!before[g].empty())
+            return false;
+    }
+    return true;
+}
+
+// The step from one state to another, from the differences of their sets
+void SelectionStep::diff(const GroupSets &from, const GroupSets &to, SelectionStep &step)
+{
+    unsigned int numGroups = std::max(from.size(),to.size());
+    step.before.assign(numGroups,ElemSet());
+    step.after.assign(numGroups,ElemSet());
+
+    ElemSet left, entered;
+    for(unsigned int g=1; g<numGroups; g++)
+    {
+        if(g < from.size())
+            step.before[g] = from[g];
+        if(g < to.size())
+        {
+            step.after[g] = to[g];
+            step.after[g].subtract(step.before[g]);
+            step.before[g].subtract(to[g]);
+        }
+
+        left.unite(step.before[g]);
+        entered.unite(step.after[g]);
+    }
+
+    // Elements moving to or from no group at all
+    if(numGroups == 0)
+        return;
+
+    step.before[0] = entered;
+    step.before[0].subtract(left);
+    step.after[0] = left;
+    step.after[0].subtract(entered);
+}
+
+SelectionHistory::SelectionHistory(int maxEntries, int maxSnapshots)
+    : current(-1),
+      useClock(0),
+      maxEntries(maxEntries),
+      maxSnapshots(maxSnapshots)
+{
+}
+
+void SelectionHistory::reset(const GroupSets &state)
+{
+    entries.clear();
+    current = -1;
+
+    record(SelectionStep(),state);
+}
+
+void SelectionHistory::record(const SelectionStep &step, const GroupSets &state)
+{
+    entries.resize(current+1);
+
+    Entry e;
+    e.step = step;
+    e.state = state;
+    e.hasState = true;
+    e.lastUse = 0;
+    entries.push_back(e);
+
+    // The oldest entry goes, the one after becomes the first
+    if((int)entries.size() > maxEntries)
+    {
+        entries.erase(entries.begin());
+        entries[0].step = SelectionStep();
+    }
+
+    current = entries.size()-1;
+    touch(current);
+    dropSnapshots();
+}
+
+const SelectionStep &SelectionHistory::undo()
+{
+    const SelectionStep &step = entries[current].step;
+    current--;
+    touch(current);
+    return step;
+}
+
+const SelectionStep &SelectionHistory::redo()
+{
+    current++;
+    touch(current);
+    return entries[current].step;
+}
+
+const GroupSets *SelectionHistory::snapshot() const
+{
+    if(current < 0 || !entries[current].hasState)
+        return NULL;
+    return &entries[current].state;
+}
+
+void SelectionHistory::setSnapshot(const GroupSets &state)
+{
+    entries[current].state = state;
+    entries[current].hasState = true;
+    dropSnapshots();
+}
+
+void SelectionHistory::touch(int entry)
+{
+    entries[entry].lastUse = ++useClock;
+}
+
+// Drops the least recently used snapshots beyond maxSnapshots, never the
+// current one, which the next step is taken from
+void SelectionHistory::dropSnapshots()
+{
+    for(;;)
+    {
+        int numSnapshots = 0;
+        int lru = -1;
+        for(int i=0; i<(int)entries.size(); i++)
+        {
+            if(!entries[i].hasState)
+                continue;
+
+            numSnapshots++;
+            if(i != current && (lru == -1 || entries[i].lastUse < entries[lru].lastUse))
+                lru = i;
+        }
+
+        if(numSnapshots <= maxSnapshots || lru == -1)
+            return;
+
+        entries[lru].state.clear();
+        entries[lru].hasState = false;
+    }
+}
@@ -0,0 +1,107 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef SELECTIONHISTORY_H
+#define SELECTIONHISTORY_H
+
+#include <vector>
+
+#include "elembitmap.h"
+
+typedef std::vector<ElemSet> GroupSets; // one set per selection group
+
+// A change of selection: the elements that changed group, by their group
+// before and by their group after
+struct SelectionStep
+{
+    GroupSets before;
+    GroupSets after;
+
+    bool empty() const;
+
+    static void diff(const GroupSets &from, const GroupSets &to, SelectionStep &step);
+};
+
+// Undo/redo history of the selection. Moving through it applies the steps
+// between entries, so it costs what changed. Entries also keep a snapshot
+// of their group sets to restore them outright, but only the current and
+// the maxSnapshots most recently visited ones do.
+class SelectionHistory
+{
+public:
+    SelectionHistory(int maxEntries = 100, int maxSnapshots = 8);
+
+    // Starts over from state
+    void reset(const GroupSets &state);
+
+    // A step to state, dropping the steps that could be redone
+    void record(const SelectionStep &step, const GroupSets &state);
+
+    bool canUndo() const { return current > 0; }
+    bool canRedo() const { return current+1 < (int)entries.size(); }
+
+    // Moves back or forward and returns the step crossed
+    const SelectionStep &undo();
+    const SelectionStep &redo();
+
+    // Snapshot of the current entry, NULL if dropped
+    const GroupSets *snapshot() const;
+    void setSnapshot(const GroupSets &state);
+
+private:
+    void touch(int entry);
+    void dropSnapshots();
+
+private:
+    struct Entry
+    {
+        SelectionStep step;     // from the entry before
+        GroupSets state;
+        bool hasState;
+        quint64 lastUse;
+    };
+
+    std::vector<Entry> entries;
+    int current;
+    quint64 useClock;
+
+    int maxEntries;
+    int maxSnapshots;
+};
+
+#endif // SELECTIONHISTORY_H
@@ -0,0 +1,825 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "selectionquery.h"
+
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#define QUERY_BLOCK_WORDS 64            // 4096 elements per block
+#define QUERY_PARALLEL_ELEMS (1<<20)
+#define QUERY_PROBE_RATIO 16            // look up terms keeping under 1/16
+
+static const qreal inf = std::numeric_limits<qreal>::infinity();
+
+class SelectionQueryTask : public QRunnable
+{
+public:
+    SelectionQueryTask(const SelectionQuery *q, ElemIndex first, ElemIndex last, quint64 *w)
+        : query(q), firstWord(first), lastWord(last), words(w) {}
+
+    void run() { query->scanWords(firstWord,lastWord,words); }
+
+private:
+    const SelectionQuery *query;
+    ElemIndex firstWord;
+    ElemIndex lastWord;
+    quint64 *words;
+};
+
+// Largest value below val, for turning closed bounds into the half-open
+// ranges of the column kernels
+static qreal below(qreal val)
+{
+    return std::nextafter(val,-inf);
+}
+
+static bool isSpecial(const QString &tok)
+{
+    return !tok.isEmpty() && QString("(),=<>:!").contains(tok[0]);
+}
+
+static bool isQuoted(const QString &tok)
+{
+    return tok.startsWith("\"");
+}
+
+static QString unquote(const QString &tok)
+{
+    return isQuoted(tok) ? tok.mid(1) : tok;
+}
+
+// Splits text into words, "quoted strings" (kept with their opening quote)
+// and the operators ( ) , = != < <= > >= : !
+static bool tokenize(const QString &text, QStringList &tokens)
+{
+    tokens.clear();
+
+    int i = 0;
+    while(i < text.size())
+    {
+        QChar c = text[i];
+        if(c.isSpace())
+        {
+            i++;
+        }
+        else if(c == '"')
+        {
+            int end = text.indexOf('"',i+1);
+            if(end == -1)
+                return false;
+            tokens.append(text.mid(i,end-i));
+            i = end+1;
+        }
+        else if(isSpecial(QString(c)))
+        {
+            bool twoChar = (c == '<' || c == '>' || c == '!')
+                    && i+1 < text.size() && text[i+1] == '=';
+            tokens.append(text.mid(i,twoChar ? 2 : 1));
+            i += twoChar ? 2 : 1;
+        }
+        else
+        {
+            int start = i;
+            while(i < text.size() && !text[i].isSpace() && text[i] != '"'
+                  && !isSpecial(QString(text[i])))
+                i++;
+            tokens.append(text.mid(start,i-start));
+        }
+    }
+    return true;
+}
+
+SelectionQuery::SelectionQuery(const DataObject *d, int threads)
+    : dataSet(d),
+      root(-1),
+      pos(0),
+      resourceTerms(false)
+{
+    numThreads = (threads <= 0) ? QThread::idealThreadCount() : threads;
+}
+
+bool SelectionQuery::compile(QString text)
+{
+    nodes.clear();
+    sets.clear();
+    root = -1;
+    pos = 0;
+    resourceTerms = false;
+    errorText.clear();
+
+    if(!tokenize(text,tokens))
+    {
+        errorText = "Unterminated quote";
+        return false;
+    }
+    if(tokens.isEmpty())
+    {
+        errorText = "Empty query";
+        return false;
+    }
+
+    root = parseOr();
+    if(root != -1 && pos < tokens.size())
+        root = fail("Unexpected '" + tokens[pos] + "'");
+    if(root == -1)
+        return false;
+
+    plan(root);
+    return true;
+}
+
+/*
+ * Parsing
+ */
+
+QString SelectionQuery::next()
+{
+    return (pos < tokens.size()) ? tokens[pos++] : QString();
+}
+
+QString SelectionQuery::peek() const
+{
+    return (pos < tokens.size()) ? tokens[pos] : QString();
+}
+
+bool SelectionQuery::isKeyword(QString tok, const char *kw) const
+{
+    return !isQuoted(tok) && tok.toLower() == kw;
+}
+
+// Any keyword of the language, which only stands for a value when quoted
+bool SelectionQuery::isKeyword(QString tok) const
+{
+    static const char *keywords[] = {"and", "or", "not", "in", "dimrange", "resource"};
+    for(unsigned int k=0; k<sizeof(keywords)/sizeof(keywords[0]); k++)
+    {
+        if(isKeyword(tok,keywords[k]))
+            return true;
+    }
+    return false;
+}
+
+int SelectionQuery::fail(QString msg)
+{
+    if(errorText.isEmpty())
+        errorText = msg;
+    return -1;
+}
+
+bool SelectionQuery::atTermStart() const
+{
+    QString tok = peek();
+    if(tok.isEmpty() || isKeyword(tok,"or") || isKeyword(tok,"and"))
+        return false;
+    return !isSpecial(tok) || tok == "(" || tok == "!";
+}
+
+int SelectionQuery::parseOr()
+{
+    int n = parseAnd();
+    if(n == -1)
+        return -1;
+
+    QVector<int> children(1,n);
+    while(isKeyword(peek(),"or"))
+    {
+        next();
+        n = parseAnd();
+        if(n == -1)
+            return -1;
+        children.append(n);
+    }
+    return (children.size() == 1) ? children[0] : addNode(NODE_OR,children);
+}
+
+// Terms side by side are ANDed, as are those joined by AND
+int SelectionQuery::parseAnd()
+{
+    int n = parseUnary();
+    if(n == -1)
+        return -1;
+
+    QVector<int> children(1,n);
+    for(;;)
+    {
+        if(isKeyword(peek(),"and"))
+            next();
+        else if(!atTermStart())
+            break;
+
+        n = parseUnary();
+        if(n == -1)
+            return -1;
+        children.append(n);
+    }
+    return (children.size() == 1) ? children[0] : addNode(NODE_AND,children);
+}
+
+int SelectionQuery::parseUnary()
+{
+    if(isKeyword(peek(),"not") || peek() == "!")
+    {
+        next();
+        int n = parseUnary();
+        if(n == -1)
+            return -1;
+        return addNode(NODE_NOT,QVector<int>(1,n));
+    }
+    return parseTerm();
+}
+
+int SelectionQuery::parseTerm()
+{
+    QString tok = next();
+    if(tok.isEmpty())
+        return fail("Expected a term at the end of the query");
+
+    if(tok == "(")
+    {
+        int n = parseOr();
+        if(n == -1)
+            return -1;
+        if(next() != ")")
+            return fail("Missing )");
+        return n;
+    }
+
+    if(isKeyword(tok,"dimrange"))
+    {
+        resourceTerms = false;
+        return parseUnary();
+    }
+    if(isKeyword(tok,"resource"))
+    {
+        resourceTerms = true;
+        return parseUnary();
+    }
+
+    if(isSpecial(tok))
+        return fail("Unexpected '" + tok + "'");
+
+    return resourceTerms ? parseResourceTerm(unquote(tok)) : parseDimTerm(unquote(tok));
+}
+
+// Reads values separated by commas
+int SelectionQuery::parseValues(QStringList &vals)
+{
+    do
+    {
+        QString tok = next();
+        if(tok.isEmpty() || (isSpecial(tok) && tok != ","))
+            return fail("Expected a value");
+        vals.append(unquote(tok));
+    } while(peek() == "," && next() == ",");
+
+    return 0;
+}
+
+int SelectionQuery::parseDimTerm(QString name)
+{
+    int dim = findDim(name);
+    if(dim == -1)
+        return fail("Unknown dimension " + name);
+
+    QString op = next();
+    QStringList vals;
+    qreal val;
+    int n;
+
+    if(isKeyword(op,"in"))
+    {
+        if(next() != "(")
+            return fail("Expected ( after IN");
+        if(parseValues(vals) == -1)
+            return -1;
+        if(next() != ")")
+            return fail("Missing )");
+    }
+    else if(op == "=" || op == "!=")
+    {
+        // lo:hi, with either end left out
+        QString lo = (peek() == ":") ? QString() : next();
+        if(peek() == ":")
+        {
+            next();
+            // lo: followed by another term has no upper bound
+            QString after = (pos+1 < tokens.size()) ? tokens[pos+1] : QString();
+            bool hasHi = atTermStart() && !isSpecial(peek()) && !isKeyword(peek())
+                    && (!isSpecial(after) || after == ")" || after == "(" || after == "!")
+                    && !isKeyword(after,"in");
+            QString hi = hasHi ? unquote(next()) : QString();
+
+            qreal vmin = -inf;
+            qreal vmax = inf;
+            if(!lo.isEmpty() && (!toValue(dim,unquote(lo),vmin) || std::isnan(vmin)))
+                return fail("Invalid lower bound " + lo);
+            if(!hi.isEmpty() && (!toValue(dim,hi,vmax) || std::isnan(vmax)))
+                return fail("Invalid upper bound " + hi);
+
+            n = addRange(dim,(vmin == -inf) ? vmin : below(vmin),vmax);
+            return (op == "!=") ? addNode(NODE_NOT,QVector<int>(1,n)) : n;
+        }
+
+        if(lo.isEmpty() || isSpecial(lo))
+            return fail("Expected a value after " + name + op);
+        vals.append(unquote(lo));
+        if(peek() == ",")
+        {
+            next();
+            if(parseValues(vals) == -1)
+                return -1;
+        }
+    }
+    else if(op == "<" || op == "<=" || op == ">" || op == ">=")
+    {
+        QString tok = next();
+        if(tok.isEmpty() || isSpecial(tok) || !toValue(dim,unquote(tok),val) || std::isnan(val))
+            return fail("Invalid value after " + name + op);
+
+        if(op == "<")
+            return addRange(dim,-inf,below(val));
+        if(op == "<=")
+            return addRange(dim,-inf,val);
+        if(op == ">")
+            return addRange(dim,val,inf);
+        return addRange(dim,below(val),inf);
+    }
+    else
+    {
+        return fail("Expected an operator after " + name);
+    }
+
+    QVector<int> children;
+    for(int i=0; i<vals.size(); i++)
+    {
+        n = addEquals(dim,vals[i]);
+        if(n == -1)
+            return -1;
+        children.append(n);
+    }
+    n = (children.size() == 1) ? children[0] : addNode(NODE_OR,children);
+    return (op == "!=") ? addNode(NODE_NOT,QVector<int>(1,n)) : n;
+}
+
+// kind=id[,id...] over the topology nodes, e.g. cpu=4 numa=0,1 cache=L3
+int SelectionQuery::parseResourceTerm(QString kind)
+{
+    hwTopo *topo = dataSet->topo;
+    if(topo == NULL)
+        return fail("No hardware topology loaded");
+
+    kind = kind.toLower();
+    if(kind == "core")
+        kind = "cpu";
+    else if(kind == "node")
+        kind = "numa";
+    else if(kind == "ram" || kind == "memory")
+        kind = "hardware";
+
+    QString op = next();
+    if(op != "=" && op != "!=")
+        return fail("Expected = after " + kind);
+
+    QStringList vals;
+    if(parseValues(vals) == -1)
+        return -1;
+
+    QVector<int> ids;
+    for(int i=0; i<vals.size(); i++)
+    {
+        QString v = vals[i].toLower();
+        if(v.startsWith("l"))
+            v = v.mid(1);
+
+        bool ok;
+        ids.append(v.toInt(&ok));
+        if(!ok)
+            return fail("Invalid " + kind + " id " + vals[i]);
+    }
+
+    DataObject *key = const_cast<DataObject*>(dataSet);
+    ElemSet s;
+    bool found = false;
+    for(int i=0; i<topo->allHardwareResourceNodes.size(); i++)
+    {
+        hwNode *node = topo->allHardwareResourceNodes[i];
+        if(node->name.toLower() != kind || !ids.contains(node->id))
+            continue;
+
+        found = true;
+        if(node->sampleSets.contains(key))
+            s.unite(node->sampleSets[key].totSamples);
+    }
+    if(!found)
+        return fail("No " + kind + " with that id in the topology");
+
+    int n = addSet(s);
+    return (op == "!=") ? addNode(NODE_NOT,QVector<int>(1,n)) : n;
+}
+
+// A dimension by name, ignoring case, or by index
+int SelectionQuery::findDim(QString name) const
+{
+    bool isIndex;
+    int dim = name.toInt(&isIndex);
+    if(isIndex)
+        return (dim >= 0 && dim < (int)dataSet->numDimensions) ? dim : -1;
+
+    for(int d=0; d<dataSet->meta.size(); d++)
+    {
+        if(dataSet->meta[d].toLower() == name.toLower())
+            return d;
+    }
+    return -1;
+}
+
+// Numbers, or names in the source and variable dimensions. Names that are
+// not in the data give NaN.
+bool SelectionQuery::toValue(int dim, QString tok, qreal &val) const
+{
+    bool ok;
+    val = tok.toDouble(&ok);
+    if(ok)
+        return true;
+
+    int id;
+    if(dim == dataSet->sourceDim)
+        id = dataSet->sourceDict.find(tok);
+    else if(dim == dataSet->variableDim)
+        id = dataSet->varDict.find(tok);
+    else
+        return false;
+
+    val = (id == -1) ? std::numeric_limits<qreal>::quiet_NaN() : id;
+    return true;
+}
+
+int SelectionQuery::addNode(node_type type, QVector<int> children)
+{
+    Node n;
+    n.type = type;
+    n.dim = -1;
+    n.lo = -inf;
+    n.hi = inf;
+    n.set = -1;
+    n.children = children;
+    n.indexed = false;
+    n.posMin = n.posMax = 0;
+    n.hits = 0;
+
+    nodes.append(n);
+    return nodes.size()-1;
+}
+
+int SelectionQuery::addRange(int dim, qreal lo, qreal hi)
+{
+    int n = addNode(NODE_RANGE);
+    nodes[n].dim = dim;
+    nodes[n].lo = lo;
+    nodes[n].hi = hi;
+    return n;
+}
+
+int SelectionQuery::addSet(const ElemSet &s)
+{
+    sets.append(s);
+
+    int n = addNode(NODE_SET);
+    nodes[n].set = sets.size()-1;
+    return n;
+}
+
+// dim == tok, from the category index when dim has one
+int SelectionQuery::addEquals(int dim, QString tok)
+{
+    qreal val;
+    if(!toValue(dim,tok,val))
+        return fail("Invalid value " + tok);
+
+    if(std::isnan(val))
+        return addSet(ElemSet());
+
+    if(dataSet->hasCategoryIndex(dim))
+    {
+        const ElemSet *s = dataSet->categorySet(dim,val);
+        return addSet(s ? *s : ElemSet());
+    }
+    return addRange(dim,below(val),val);
+}
+
+/*
+ * Planning and evaluation
+ */
+
+// Counts or estimates the elements of each node, and orders conjunctions
+// most selective first and disjunctions least selective first
+void SelectionQuery::plan(int n)
+{
+    ElemIndex numElements = dataSet->numElements;
+    Node &node = nodes[n];
+
+    if(node.type == NODE_RANGE)
+    {
+        int dim = node.dim;
+        node.indexed = dataSet->sortedList(dim) != NULL;
+        if(node.indexed)
+        {
+            node.posMin = (node.lo == -inf) ? 0 : dataSet->sortedPosAbove(dim,node.lo);
+            node.posMax = (node.hi == inf) ? numElements : dataSet->sortedPosAbove(dim,node.hi);
+            node.hits = (node.posMax > node.posMin) ? node.posMax - node.posMin : 0;
+        }
+        else
+        {
+            qreal span = dataSet->maxAt(dim) - dataSet->minAt(dim);
+            qreal lo = std::max(node.lo,dataSet->minAt(dim));
+            qreal hi = std::min(node.hi,dataSet->maxAt(dim));
+            qreal frac = (span > 0) ? (hi - lo) / span : 1;
+            frac = std::min(std::max(frac,(qreal)0),(qreal)1);
+            node.hits = frac * numElements;
+        }
+        return;
+    }
+
+    if(node.type == NODE_SET)
+    {
+        node.hits = sets[node.set].size();
+        return;
+    }
+
+    for(int i=0; i<node.children.size(); i++)
+        plan(node.children[i]);
+
+    if(node.type == NODE_NOT)
+    {
+        node.hits = numElements - nodes[node.children[0]].hits;
+        return;
+    }
+
+    // Insertion sort, there are only a few
+    bool ascending = (node.type == NODE_AND);
+    for(int i=1; i<node.children.size(); i++)
+    {
+        int c = node.children[i];
+        int j = i;
+        while(j > 0 && (ascending ? nodes[node.children[j-1]].hits > nodes[c].hits
+                                  : nodes[node.children[j-1]].hits < nodes[c].hits))
+        {
+            node.children[j] = node.children[j-1];
+            j--;
+        }
+        node.children[j] = c;
+    }
+
+    node.hits = (node.type == NODE_AND) ? numElements : 0;
+    for(int i=0; i<node.children.size(); i++)
+    {
+        ElemIndex hits = nodes[node.children[i]].hits;
+        if(node.type == NODE_AND)
+            node.hits = std::min(node.hits,hits);
+        else
+            node.hits = std::min(numElements,node.hits + hits);
+    }
+}
+
+bool SelectionQuery::matches(int n, ElemIndex elem) const
+{
+    const Node &node = nodes[n];
+    switch(node.type)
+    {
+    case(NODE_RANGE):
+    {
+        qreal val = dataSet->at(elem,node.dim);
+        return val > node.lo && val <= node.hi;
+    }
+    case(NODE_SET):
+        return sets[node.set].contains(elem);
+    case(NODE_NOT):
+        return !matches(node.children[0],elem);
+    case(NODE_AND):
+        for(int i=0; i<node.children.size(); i++)
+        {
+            if(!matches(node.children[i],elem))
+                return false;
+        }
+        return true;
+    case(NODE_OR):
+        for(int i=0; i<node.children.size(); i++)
+        {
+            if(matches(node.children[i],elem))
+                return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+void SelectionQuery::evaluate(ElemSet &out) const
+{
+    if(root == -1 || dataSet->numElements == 0)
+        return;
+
+    // A narrow set or indexed range, alone or in a conjunction, is looked up
+    const Node &top = nodes[root];
+    const Node &driver = (top.type == NODE_AND) ? nodes[top.children.first()] : top;
+    bool lookup = driver.type == NODE_SET || (driver.type == NODE_RANGE && driver.indexed);
+
+    if(lookup && driver.hits * QUERY_PROBE_RATIO < dataSet->numElements)
+        probe(driver,out);
+    else
+        scan(out);
+}
+
+void SelectionQuery::probe(const Node &driver, ElemSet &out) const
+{
+    if(driver.type == NODE_SET)
+    {
+        const ElemSet &s = sets[driver.set];
+        for(ElemSet::const_iterator it = s.begin(); it != s.end(); it++)
+        {
+            if(matches(root,*it))
+                out.insert(*it);
+        }
+        return;
+    }
+
+    const DataColumn &order = *dataSet->sortedList(driver.dim);
+
+    QVector<ElemIndex> kept;
+    kept.reserve(driver.hits);
+    for(ElemIndex pos=driver.posMin; pos<driver.posMax; pos++)
+    {
+        ElemIndex elem = (ElemIndex)order.at(pos);
+        if(matches(root,elem))
+            kept.append(elem);
+    }
+
+    // Sorted lists give value order, the set fills fastest in index order
+    std::sort(kept.begin(),kept.end());
+    for(int i=0; i<kept.size(); i++)
+        out.insert(kept[i]);
+}
+
+void SelectionQuery::scan(ElemSet &out) const
+{
+    ElemIndex numWords = (dataSet->numElements + 63) / 64;
+    QVector<quint64> words(numWords);
+
+    if(numThreads == 1 || dataSet->numElements < QUERY_PARALLEL_ELEMS)
+    {
+        scanWords(0,numWords,words.data());
+    }
+    else
+    {
+        ElemIndex numBlocks = (numWords + QUERY_BLOCK_WORDS - 1) / QUERY_BLOCK_WORDS;
+        ElemIndex blocksPerTask = (numBlocks + numThreads - 1) / numThreads;
+
+        QThreadPool pool;
+        pool.setMaxThreadCount(numThreads);
+        for(ElemIndex b=0; b<numBlocks; b+=blocksPerTask)
+        {
+            ElemIndex first = b * QUERY_BLOCK_WORDS;
+            ElemIndex last = std::min(numWords,(b + blocksPerTask) * QUERY_BLOCK_WORDS);
+            pool.start(new SelectionQueryTask(this,first,last,words.data()));
+        }
+        pool.waitForDone();
+    }
+
+    out.insertWords(words.constData(),numWords);
+}
+
+// Levels of scratch blocks the node's evaluation needs
+int SelectionQuery::depth(int n) const
+{
+    const Node &node = nodes[n];
+    if(node.type == NODE_RANGE || node.type == NODE_SET)
+        return 0;
+    if(node.type == NODE_NOT)
+        return depth(node.children[0]);
+
+    int d = 0;
+    for(int i=0; i<node.children.size(); i++)
+        d = std::max(d,depth(node.children[i]));
+    return d + 1;
+}
+
+void SelectionQuery::scanWords(ElemIndex firstWord, ElemIndex lastWord, quint64 *words) const
+{
+    if(root == -1)
+        return;
+
+    QVector<quint64> scratch((depth(root) + 1) * QUERY_BLOCK_WORDS);
+
+    for(ElemIndex b=firstWord; b<lastWord; b+=QUERY_BLOCK_WORDS)
+    {
+        ElemIndex e = std::min(b + QUERY_BLOCK_WORDS,lastWord);
+        maskBlock(root,b,e,words + b,scratch.data());
+    }
+}
+
+// Writes the node's bits for words [firstWord,lastWord) to out. Children
+// of conjunctions and disjunctions go to scratch, which has a block for
+// each level below.
+void SelectionQuery::maskBlock(int n, ElemIndex firstWord, ElemIndex lastWord,
+                               quint64 *out, quint64 *scratch) const
+{
+    const Node &node = nodes[n];
+    ElemIndex numWords = lastWord - firstWord;
+    ElemIndex first = firstWord * 64;
+    ElemIndex last = std::min(lastWord * 64,dataSet->numElements);
+
+    switch(node.type)
+    {
+    case(NODE_RANGE):
+        columnIntervalMask(dataSet->column(node.dim),first,last,node.lo,node.hi,out,false);
+        break;
+    case(NODE_SET):
+        sets[node.set].toWords(firstWord,numWords,out);
+        break;
+    case(NODE_NOT):
+    {
+        maskBlock(node.children[0],firstWord,lastWord,out,scratch);
+        for(ElemIndex w=0; w<numWords; w++)
+            out[w] = ~out[w];
+
+        // No bits past the last element
+        ElemIndex tail = last - (lastWord - 1) * 64;
+        if(tail < 64)
+            out[numWords-1] &= (1ULL << tail) - 1;
+        break;
+    }
+    case(NODE_AND):
+    case(NODE_OR):
+    {
+        bool conj = (node.type == NODE_AND);
+        maskBlock(node.children[0],firstWord,lastWord,out,scratch);
+
+        for(int i=1; i<node.children.size(); i++)
+        {
+            // Stop once the result can no longer change
+            quint64 any = 0;
+            quint64 all = ~0ULL;
+            for(ElemIndex w=0; w<numWords; w++)
+            {
+                any |= out[w];
+                all &= out[w];
+            }
+            if(conj ? !any : all == ~0ULL)
+                break;
+
+            // Ranges are ANDed in place, skipping words already zero
+            const Node &child = nodes[node.children[i]];
+            if(conj && child.type == NODE_RANGE)
+            {
+                columnIntervalMask(dataSet->column(child.dim),first,last,child.lo,child.hi,out,true);
+                continue;
+            }
+
+            maskBlock(node.children[i],firstWord,lastWord,scratch,scratch + QUERY_BLOCK_WORDS);
+            for(ElemIndex w=0; w<numWords; w++)
+                out[w] = conj ? (out[w] & scratch[w]) : (out[w] | scratch[w]);
+        }
+        break;
+    }
+    }
+}
@@ -0,0 +1,150 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef SELECTIONQUERY_H
+#define SELECTIONQUERY_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "dataobject.h"
+
+// Predicate over the elements of a DataObject, written as a query:
+//
+//   latency>=100 AND (source="lulesh.cc" OR variable IN (x,y)) NOT cpu=0:3
+//   RESOURCE numa=1
+//
+// Terms compare a dimension, by name or index, with = != < <= > >=,
+// a closed range lo:hi (either end may be left out) or a list of values.
+// Names in the source and variable dimensions stand for their IDs.
+// RESOURCE switches the terms after it to hardware resources, matching
+// the samples served by the topology nodes of that kind and id;
+// DIMRANGE switches back. Terms side by side are ANDed.
+//
+// The query is compiled once into a tree of bitmask operations, with
+// equality on categorical dimensions taken from their indexes, and run
+// in one blocked pass over the columns with the most selective terms
+// first. When one term of a conjunction is narrow, its elements are
+// looked up instead and only they are tested.
+class SelectionQuery
+{
+public:
+    SelectionQuery(const DataObject *d, int threads = 0);
+
+    // False if text is not a valid query, see error()
+    bool compile(QString text);
+    QString error() const { return errorText; }
+
+    // Adds the matching elements to out
+    void evaluate(ElemSet &out) const;
+
+    // Evaluates words [firstWord,lastWord) of the flat result bitmap
+    void scanWords(ElemIndex firstWord, ElemIndex lastWord, quint64 *words) const;
+
+private:
+    enum node_type
+    {
+        NODE_AND = 0,
+        NODE_OR,
+        NODE_NOT,
+        NODE_RANGE,     // lo < value <= hi
+        NODE_SET        // elements of sets[set]
+    };
+
+    struct Node
+    {
+        node_type type;
+        int dim;
+        qreal lo;
+        qreal hi;
+        int set;
+        QVector<int> children;
+
+        bool indexed;       // RANGE found in the sorted list at [posMin,posMax)
+        ElemIndex posMin;
+        ElemIndex posMax;
+        ElemIndex hits;     // exact for sets and indexed ranges, else estimated
+    };
+
+    // Parsing, -1 on errors
+    int parseOr();
+    int parseAnd();
+    int parseUnary();
+    int parseTerm();
+    int parseDimTerm(QString name);
+    int parseResourceTerm(QString kind);
+    int parseValues(QStringList &vals);
+    bool atTermStart() const;
+    QString next();
+    QString peek() const;
+    bool isKeyword(QString tok, const char *kw) const;
+    bool isKeyword(QString tok) const;
+    int fail(QString msg);
+
+    int findDim(QString name) const;
+    bool toValue(int dim, QString tok, qreal &val) const;
+    int addNode(node_type type, QVector<int> children = QVector<int>());
+    int addRange(int dim, qreal lo, qreal hi);
+    int addSet(const ElemSet &s);
+    int addEquals(int dim, QString tok);
+
+    // Planning and evaluation
+    void plan(int node);
+    bool matches(int node, ElemIndex elem) const;
+    void maskBlock(int node, ElemIndex firstWord, ElemIndex lastWord,
+                   quint64 *out, quint64 *scratch) const;
+    int depth(int node) const;
+    void probe(const Node &driver, ElemSet &out) const;
+    void scan(ElemSet &out) const;
+
+private:
+    const DataObject *dataSet;
+    int numThreads;
+
+    QVector<Node> nodes;
+    QVector<ElemSet> sets;
+    int root;
+
+    QStringList tokens;
+    int pos;
+    bool resourceTerms;
+    QString errorText;
+};
+
+#endif // SELECTIONQUERY_H
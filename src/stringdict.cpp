@@ -0,0 +1,151 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#include "stringdict.h"
+
+#include <string.h>
+
+#define EMPTY_SLOT -1
+#define INITIAL_SLOTS 64
+
+StringDict::StringDict()
+{
+    clear();
+}
+
+void StringDict::clear()
+{
+    arena.clear();
+    offsets.clear();
+    offsets.push_back(0);
+    hashes.clear();
+    names.clear();
+
+    table.resize(INITIAL_SLOTS);
+    table.fill(EMPTY_SLOT);
+}
+
+// FNV-1a
+quint32 StringDict::hash(const char *str, int len)
+{
+    quint32 h = 2166136261u;
+    for(int i=0; i<len; i++)
+    {
+        h ^= (unsigned char)str[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Returns the slot holding str, or the empty slot where it would go
+int StringDict::probe(const char *str, int len, quint32 h) const
+{
+    int mask = table.size()-1;
+    int slot = h & mask;
+    for(;;)
+    {
+        int id = table[slot];
+        if(id == EMPTY_SLOT)
+            return slot;
+        if(hashes[id] == h && length(id) == len && memcmp(data(id),str,len) == 0)
+            return slot;
+        slot = (slot+1) & mask;
+    }
+}
+
+void StringDict::grow()
+{
+    table.resize(table.size()*2);
+    table.fill(EMPTY_SLOT);
+
+    int mask = table.size()-1;
+    for(int id=0; id<size(); id++)
+    {
+        int slot = hashes[id] & mask;
+        while(table[slot] != EMPTY_SLOT)
+            slot = (slot+1) & mask;
+        table[slot] = id;
+    }
+}
+
+int StringDict::intern(const char *str, int len)
+{
+    quint32 h = hash(str,len);
+    int slot = probe(str,len,h);
+    if(table[slot] != EMPTY_SLOT)
+        return table[slot];
+
+    // First time we see this string, new entry
+    int id = size();
+    arena.append(str,len);
+    offsets.push_back(arena.size());
+    hashes.push_back(h);
+    names.push_back(QString::fromUtf8(str,len));
+    table[slot] = id;
+
+    // Keep the load factor under 1/2
+    if(2*size() > table.size())
+        grow();
+
+    return id;
+}
+
+int StringDict::intern(const QString &str)
+{
+    QByteArray utf8 = str.toUtf8();
+    return intern(utf8.constData(),utf8.size());
+}
+
+int StringDict::find(const char *str, int len) const
+{
+    int slot = probe(str,len,hash(str,len));
+    return table[slot];
+}
+
+int StringDict::find(const QString &str) const
+{
+    QByteArray utf8 = str.toUtf8();
+    return find(utf8.constData(),utf8.size());
+}
+
+// Names are decoded as they are interned, so lookups only read and can
+// come from any thread once loading is done
+QString StringDict::name(int id) const
+{
+    return names[id];
+}
@@ -0,0 +1,80 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security, LLC. Produced
+// at the Lawrence Livermore National Laboratory. Written by Alfredo
+// Gimenez (alfredo.gimenez@gmail.com). LLNL-CODE-663358. All rights
+// reserved.
+//
+// This file is part of MemAxes. For details, see
+// https://github.com/scalability-tools/MemAxes
+//
+// Please also read this link – Our Notice and GNU Lesser General Public
+// License. This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License (as
+// published by the Free Software Foundation) version 2.1 dated February
+// 1999.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms and
+// conditions of the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// OUR NOTICE AND TERMS AND CONDITIONS OF THE GNU GENERAL PUBLIC LICENSE
+// Our Preamble Notice
+// A. This notice is required to be provided under our contract with the
+// U.S. Department of Energy (DOE). This work was produced at the Lawrence
+// Livermore National Laboratory under Contract No. DE-AC52-07NA27344 with
+// the DOE.
+// B. Neither the United States Government nor Lawrence Livermore National
+// Security, LLC nor any of their employees, makes any warranty, express or
+// implied, or assumes any liability or responsibility for the accuracy,
+// completeness, or usefulness of any information, apparatus, product, or
+// process disclosed, or represents that its use would not infringe
+// privately-owned rights.
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef STRINGDICT_H
+#define STRINGDICT_H
+
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+
+// Interning table mapping strings to dense IDs (0,1,2,...) in order of
+// first appearance. Strings live back to back in a single arena, and
+// lookups go through an open-addressed hash table of IDs.
+class StringDict
+{
+public:
+    StringDict();
+
+    int intern(const char *str, int len);
+    int intern(const QString &str);
+    int find(const char *str, int len) const;
+    int find(const QString &str) const;
+
+    int size() const { return offsets.size()-1; }
+    bool empty() const { return size() == 0; }
+    void clear();
+
+    const char *data(int id) const { return arena.constData() + offsets[id]; }
+    int length(int id) const { return offsets[id+1] - offsets[id]; }
+    QString name(int id) const;
+
+private:
+    static quint32 hash(const char *str, int len);
+    int probe(const char *str, int len, quint32 h) const;
+    void grow();
+
+private:
+    QByteArray arena;
+    QVector<int> offsets;
+    QVector<quint32> hashes;
+    QVector<int> table;
+    QVector<QString> names;
+};
+
+#endif // STRINGDICT_H
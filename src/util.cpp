@@ -145,6 +145,24 @@ QColor valToColor(qreal val, ColorMap colorMap)
     return colorMap.at(colIdx);
 }
 
+// Selection group colors, group 1 being the red of a single selection
+QColor groupColor(int group)
+{
+    static const QColor colors[] = {
+        QColor(255,0,0),
+        QColor(31,120,180),
+        QColor(51,160,44),
+        QColor(255,127,0),
+        QColor(106,61,154),
+        QColor(177,89,40),
+        QColor(227,119,194),
+        QColor(23,190,207)
+    };
+    int numColors = sizeof(colors)/sizeof(colors[0]);
+
+    return colors[qMax(group-1,0) % numColors];
+}
+
 QPointF radialTransform(QPointF point, QRectF rectSpace)
 {
     // Get radius
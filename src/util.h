@@ -70,5 +70,6 @@ QVector<QPointF> rectToRadialSegment(QRectF rect, QRectF rectSpace);
 
 ColorMap gradientColorMap(QColor col0, QColor col1, int steps);
 QColor valToColor(qreal val, ColorMap colorMap);
+QColor groupColor(int group);
 
 #endif // UTIL_H
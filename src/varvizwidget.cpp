@@ -65,54 +65,123 @@ VarViz::~VarViz()
 {
 }
 
-int VarViz::getVariableID(QString name)
+int VarViz::getVariableID(int varID)
 {
-    for(int i=0; i<varBlocks.size(); i++)
-    {
-        if(varBlocks[i].name == name)
-            return i;
-    }
+    if(varBlockIDs[varID] != -1)
+        return varBlockIDs[varID];
 
     // First time we see this name, new entry
-    varBlock newBlock = {name, 0, QRect()};
-    varBlocks.push_back(newBlock);
+    varBlock newBlock = {dataSet->varDict.name(varID), 0, QRect(), QVector<qint64>()};
+    allVarBlocks.push_back(newBlock);
 
-    return varBlocks.size()-1;
+    varBlockIDs[varID] = allVarBlocks.size()-1;
+    return allVarBlocks.size()-1;
 }
 
+// Every element counts towards its group's total of its variable, so
+// selection changes only move totals between groups
 void VarViz::processData()
 {
     processed = false;
 
-    varMaxVal = 0;
-    varBlocks.clear();
+    allVarBlocks.clear();
+    varOrder.clear();
+
+    varBlockIDs.resize(dataSet->varDict.size());
+    varBlockIDs.fill(-1);
 
     // Get metric values
-    int elem = 0;
-    QVector<qreal>::Iterator p;
-    for(elem=0, p=dataSet->begin; p!=dataSet->end; elem++, p+=dataSet->numDimensions)
+    const DataColumn &vars = dataSet->column(dataSet->variableDim);
+    const DataColumn &latencies = dataSet->column(dataSet->latencyDim);
+
+    for(ElemIndex elem=0; elem<dataSet->numElements; elem++)
     {
-        if(dataSet->selectionDefined() && !dataSet->selected(elem))
+        int varIdx = this->getVariableID(vars.at(elem));
+        qint64 cycles = latencies.at(elem) * dataSet->weight(elem) + 0.5;
+        addGroupValue(allVarBlocks[varIdx].groupVals,dataSet->selected(elem),cycles);
+    }
+
+    sortBlocks();
+
+    processed = true;
+}
+
+// The variables with a share of the selection, by value. Only their
+// indices are sorted, the blocks stay where they are.
+void VarViz::sortBlocks()
+{
+    varMaxVal = 0;
+    varOrder.clear();
+
+    for(int i=0; i<allVarBlocks.size(); i++)
+    {
+        allVarBlocks[i].val = shownGroupValue(allVarBlocks[i].groupVals);
+        if(allVarBlocks[i].val <= 0)
             continue;
 
-        int varIdx = this->getVariableID(dataSet->varNames[elem]);
-        varBlocks[varIdx].val += *(p+dataSet->latencyDim);
-        varMaxVal = std::max(varMaxVal,varBlocks[varIdx].val);
+        varOrder.push_back(i);
+        varMaxVal = std::max(varMaxVal,allVarBlocks[i].val);
     }
 
     // Sort based on value
-    qSort(varBlocks.begin(),varBlocks.end());
-
-    processed = true;
+    std::sort(varOrder.begin(),varOrder.end(),BlockOrder<varBlock>(allVarBlocks));
 }
 
 void VarViz::selectionChangedSlot()
 {
-    if(processed)
+    if(!processed)
+        return;
+
+    const SelectionDelta &delta = dataSet->selectionDelta();
+    if(delta.full)
     {
         processData();
         repaint();
+        return;
     }
+
+    const DataColumn &vars = dataSet->column(dataSet->variableDim);
+    const DataColumn &latencies = dataSet->column(dataSet->latencyDim);
+
+    for(unsigned int g=0; g<delta.changed.size(); g++)
+    {
+        for(ElemSet::const_iterator it = delta.changed[g].begin(); it != delta.changed[g].end(); it++)
+        {
+            int varIdx = varBlockIDs[vars.at(*it)];
+            qint64 cycles = latencies.at(*it) * dataSet->weight(*it) + 0.5;
+            addGroupValue(allVarBlocks[varIdx].groupVals,g,-cycles);
+            addGroupValue(allVarBlocks[varIdx].groupVals,dataSet->selected(*it),cycles);
+        }
+    }
+
+    sortBlocks();
+    repaint();
+}
+
+// Only the new elements are added, under the group they are in
+void VarViz::dataAppended(ElemIndex first)
+{
+    if(!processed)
+        return;
+
+    // Names first seen in the new elements
+    int numIDs = varBlockIDs.size();
+    varBlockIDs.resize(dataSet->varDict.size());
+    for(int i=numIDs; i<varBlockIDs.size(); i++)
+        varBlockIDs[i] = -1;
+
+    const DataColumn &vars = dataSet->column(dataSet->variableDim);
+    const DataColumn &latencies = dataSet->column(dataSet->latencyDim);
+
+    for(ElemIndex elem=first; elem<dataSet->numElements; elem++)
+    {
+        int varIdx = this->getVariableID(vars.at(elem));
+        qint64 cycles = latencies.at(elem) * dataSet->weight(elem) + 0.5;
+        addGroupValue(allVarBlocks[varIdx].groupVals,dataSet->selected(elem),cycles);
+    }
+
+    sortBlocks();
+    repaint();
 }
 
 void VarViz::drawQtPainter(QPainter *painter)
@@ -124,35 +193,40 @@ void VarViz::drawQtPainter(QPainter *painter)
     if(!processed)
         return;
 
-    int numBlocks = std::min(numVariableBlocks, varBlocks.size());
+    int numBlocks = std::min(numVariableBlocks, varOrder.size());
     if(numBlocks == 0)
         return;
 
     int blockheight = drawSpace.height() / numBlocks;
     for(int i=0; i<numBlocks; i++)
     {
-        varBlocks[i].block.setLeft(drawSpace.left());
-        varBlocks[i].block.setTop(drawSpace.top()+i*blockheight);
-        varBlocks[i].block.setWidth(varBlocks[i].val/varMaxVal*drawSpace.width());
-        varBlocks[i].block.setHeight(blockheight);
-
-        painter->fillRect(varBlocks[i].block,Qt::lightGray);
+        varBlock &var = allVarBlocks[varOrder[i]];
+        var.block.setLeft(drawSpace.left());
+        var.block.setTop(drawSpace.top()+i*blockheight);
+        var.block.setWidth(var.val/varMaxVal*drawSpace.width());
+        var.block.setHeight(blockheight);
+
+        painter->fillRect(var.block,Qt::lightGray);
+        drawGroupBar(painter,var.block,var.groupVals);
         painter->setPen(Qt::black);
-        painter->drawText(varBlocks[i].block.topLeft()+QPoint(0,16),varBlocks[i].name);
+        painter->drawText(var.block.topLeft()+QPoint(0,16),var.name);
     }
 }
 
 void VarViz::mouseReleaseEvent(QMouseEvent *e)
 {
-    for(int i=0; i<varBlocks.size(); i++)
+    // Only the drawn blocks, the others keep the rects of older layouts
+    int numBlocks = std::min(numVariableBlocks, varOrder.size());
+    for(int i=0; i<numBlocks; i++)
     {
+        const varBlock &var = allVarBlocks[varOrder[i]];
         QRect varSelectionBox(drawSpace.left(),
-                              varBlocks[i].block.top(),
+                              var.block.top(),
                               drawSpace.width(),
-                              varBlocks[i].block.height());
+                              var.block.height());
         if(varSelectionBox.contains(e->pos()))
         {
-            dataSet->selectByVarName(varBlocks[i].name);
+            dataSet->selectByVarName(var.name);
 
             emit variableSelected(i);
             emit selectionChangedSig();
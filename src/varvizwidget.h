@@ -46,6 +46,7 @@ struct varBlock
     QString name;
     qreal val;
     QRect block;
+    QVector<qint64> groupVals;
 };
 
 class VarViz : public VizWidget
@@ -61,12 +62,14 @@ signals:
 protected:
     void processData();
     void selectionChangedSlot();
+    void dataAppended(ElemIndex first);
     void drawQtPainter(QPainter *painter);
 
     void mouseReleaseEvent(QMouseEvent *e);
 
 private:
-    int getVariableID(QString name);
+    int getVariableID(int varID);
+    void sortBlocks();
 
 private:
     int margin;
@@ -74,7 +77,9 @@ private:
 
     int numVariableBlocks;
 
-    QVector<varBlock> varBlocks;
+    QVector<int> varOrder; // shown allVarBlocks indices, by value
+    QVector<varBlock> allVarBlocks;
+    QVector<int> varBlockIDs; // dictionary ID -> allVarBlocks index
     qreal varMaxVal;
 };
 
@@ -44,6 +44,8 @@ using namespace std;
 #include <QPaintEvent>
 #include <QElapsedTimer>
 
+#include "util.h"
+
 VizWidget::VizWidget(QWidget *parent) :
     QGLWidget(QGLFormat(QGL::SampleBuffers), parent)
 {
@@ -87,6 +89,14 @@ void VizWidget::visibilityChangedSlot()
     needsRepaint = true;
 }
 
+// Elements from first on were appended to the data set. By default they
+// are picked up like a selection change, which redoes the aggregates.
+void VizWidget::dataAppended(ElemIndex first)
+{
+    Q_UNUSED(first);
+    selectionChangedSlot();
+}
+
 void VizWidget::initializeGL()
 {
     glEnable(GL_MULTISAMPLE);
@@ -161,6 +171,45 @@ void VizWidget::drawQtPainter(QPainter *painter)
     Q_UNUSED(painter);
 }
 
+// Split a bar by the share of each selection group in its value,
+// as long as there is more than one group to tell apart
+void VizWidget::drawGroupBar(QPainter *painter, QRect bar, const QVector<qint64> &groupVals)
+{
+    if(dataSet->numSelectionGroups() <= 2 || groupVals.size() <= 1)
+        return;
+
+    qint64 total = 0;
+    for(int g=1; g<groupVals.size(); g++)
+        total += groupVals[g];
+    if(total <= 0)
+        return;
+
+    qreal left = bar.left();
+    for(int g=1; g<groupVals.size(); g++)
+    {
+        qreal right = left + bar.width()*(qreal)groupVals[g]/total;
+        painter->fillRect(QRectF(QPointF(left,bar.top()),QPointF(right,bar.bottom()+1)),
+                          groupColor(g).lighter(140));
+        left = right;
+    }
+}
+
+void VizWidget::addGroupValue(QVector<qint64> &groupVals, int group, qint64 val)
+{
+    if(group >= groupVals.size())
+        groupVals.resize(group+1);
+    groupVals[group] += val;
+}
+
+// Total of the selected groups, or of all elements with nothing selected
+qint64 VizWidget::shownGroupValue(const QVector<qint64> &groupVals) const
+{
+    qint64 total = 0;
+    for(int g=dataSet->selectionDefined() ? 1 : 0; g<groupVals.size(); g++)
+        total += groupVals[g];
+    return total;
+}
+
 void VizWidget::beginNativeGL()
 {
     makeCurrent();
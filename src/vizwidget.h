@@ -43,6 +43,15 @@
 
 #include "dataobject.h"
 
+// Orders indices into a vector of blocks like the blocks themselves
+template<typename Block>
+struct BlockOrder
+{
+    BlockOrder(const QVector<Block> &b) : blocks(b) {}
+    bool operator()(int a, int b) const { return blocks[a] < blocks[b]; }
+    const QVector<Block> &blocks;
+};
+
 class VizWidget : public QGLWidget
 {
     Q_OBJECT
@@ -60,6 +69,7 @@ public slots:
     virtual void frameUpdate();
     virtual void selectionChangedSlot();
     virtual void visibilityChangedSlot();
+    virtual void dataAppended(ElemIndex first);
 
 public:
     void setDataSet(DataObject *iDataSet);
@@ -74,6 +84,12 @@ protected:
     virtual void drawNativeGL();
     virtual void drawQtPainter(QPainter *painter);
 
+    // Group totals are whole cycles, so moving elements between groups
+    // always takes back exactly what was added
+    void drawGroupBar(QPainter *painter, QRect bar, const QVector<qint64> &groupVals);
+    static void addGroupValue(QVector<qint64> &groupVals, int group, qint64 val);
+    qint64 shownGroupValue(const QVector<qint64> &groupVals) const;
+
 private:
     void beginNativeGL();
     void endNativeGL();